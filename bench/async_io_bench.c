@@ -0,0 +1,85 @@
+/*
+ * Random page read throughput of one thread doing synchronous read_page calls, compared to the same thread keeping
+ * QUEUE_DEPTH reads in flight through AsyncIo. The table file is dropped from the page cache before each run so the
+ * reads actually reach the device (where the filesystem honors POSIX_FADV_DONTNEED)
+ */
+#include "../include/disk/async_io.h"
+#include "../include/disk/disk_manager.h"
+#include "bench.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_TABLE "async_io_bench"
+#define BENCH_PAGES 8192
+#define BENCH_READS 8192
+#define QUEUE_DEPTH 32
+
+static void drop_cache(DiskManager *disk_mgr) {
+    fsync(disk_mgr->fd);
+    posix_fadvise(disk_mgr->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+static void async_reads(DiskManager *disk_mgr, const page_id_t *pids, bool use_uring, const char *label) {
+    AsyncIo *aio = async_io_init(QUEUE_DEPTH, use_uring);
+    u8 *frames = (u8 *)malloc((size_t)QUEUE_DEPTH * PAGE_SIZE);
+    IoCompletion completions[QUEUE_DEPTH];
+    u32 next = 0, done = 0;
+
+    drop_cache(disk_mgr);
+    uint64_t start = bench_now_ns();
+    // Frame i is reused once the read tagged with i completes
+    for (u32 i = 0; i < QUEUE_DEPTH; i++)
+        async_io_read_page(aio, disk_mgr, pids[next++], frames + (size_t)i * PAGE_SIZE, i);
+    while (done < BENCH_READS) {
+        u32 n = async_io_complete(aio, completions, QUEUE_DEPTH, 1);
+        done += n;
+        for (u32 i = 0; i < n && next < BENCH_READS; i++) {
+            u64 frame = completions[i].user_data;
+            async_io_read_page(aio, disk_mgr, pids[next++], frames + frame * PAGE_SIZE, frame);
+        }
+    }
+    bench_report(label, BENCH_READS, bench_now_ns() - start, "pages");
+
+    async_io_destroy(&aio);
+    free(frames);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = new_disk_manager(BENCH_TABLE);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    u8 page[PAGE_SIZE];
+    memset(page, 0xCD, PAGE_SIZE);
+    for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+        write_page(pid, disk_mgr, page);
+
+    page_id_t *pids = (page_id_t *)malloc(sizeof(page_id_t) * BENCH_READS);
+    srand(42);
+    for (u32 i = 0; i < BENCH_READS; i++)
+        pids[i] = rand() % BENCH_PAGES;
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+
+    drop_cache(disk_mgr);
+    uint64_t start = bench_now_ns();
+    for (u32 i = 0; i < BENCH_READS; i++)
+        free(read_page(pids[i], disk_mgr));
+    bench_report("random reads, read_page (QD 1)", BENCH_READS, bench_now_ns() - start, "pages");
+
+    async_reads(disk_mgr, pids, false, "random reads, blocking backend (QD 32)");
+
+    AsyncIo *probe = async_io_init(1, true);
+    bool has_uring = probe->backend == IO_BACKEND_URING;
+    async_io_destroy(&probe);
+    if (has_uring)
+        async_reads(disk_mgr, pids, true, "random reads, io_uring backend (QD 32)");
+    else
+        printf("io_uring not available, skipping its run\n");
+
+    free(pids);
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * Small helpers shared by the microbenchmarks in this directory.
+ * Benchmarks are plain executables built and ran with `make bench`, each printing its own results table
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Prints one result row: NAME, number of operations OPS done in ELAPSED_NS and the resulting throughput in UNIT/sec
+static inline void bench_report(const char *name, uint64_t ops, uint64_t elapsed_ns, const char *unit) {
+    double secs = elapsed_ns / 1e9;
+    printf("%-40s %10lu %-6s %10.3f ms %14.0f %s/sec\n", name, (unsigned long)ops, unit, elapsed_ns / 1e6, ops / secs,
+           unit);
+}
@@ -0,0 +1,59 @@
+/*
+ * Random read-modify-write of pages of a table four times larger than the buffer pool, so most fetches miss and evict
+ * a dirty page. Without the background writer every such fetch first writes its victim, with it the victims were
+ * mostly written ahead of the clock hand already. Reports the fetches that still had to write, the writer's rate and
+ * the share of clean frames at the end
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
+#include "bench.h"
+
+#define BENCH_TABLE "bpm_bg_writer_bench"
+#define POOL_PAGES 256
+#define TABLE_PAGES (4 * POOL_PAGES)
+#define FETCHES 50000
+
+static void modify_pages_randomly(DiskManager *disk_mgr, u32 clean_target_pct) {
+    BufferPoolManager *bpm = new_bpm(POOL_PAGES, disk_mgr);
+    set_bg_writer(bpm, clean_target_pct, 1);
+
+    u32 x = 2463534242u;
+    uint64_t start = bench_now_ns();
+    for (u32 i = 0; i < FETCHES; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        page_id_t pid = x % TABLE_PAGES;
+        BpmPage *page = fetch_bpm_page(pid, bpm, NULL);
+        page->data[PAGE_SIZE - 1]++;
+        unpin_page(pid, true, bpm);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    BgWriterStats stats = bg_writer_stats(bpm);
+    set_bg_writer(bpm, 0, 0);
+
+    char label[64];
+    snprintf(label, sizeof(label), "clean target %3u%%", clean_target_pct);
+    bench_report(label, FETCHES, elapsed, "fetch");
+    printf("    dirty evictions %lu, writer %.0f pages/sec, %.0f%% clean frames\n",
+           (unsigned long)stats.dirty_evictions, stats.pages_per_sec, stats.clean_ratio * 100);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    while (disk_mgr->page_directory->num_pages < TABLE_PAGES)
+        extend_table(disk_mgr);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    modify_pages_randomly(disk_mgr, 0);
+    modify_pages_randomly(disk_mgr, 10);
+    modify_pages_randomly(disk_mgr, 25);
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Foreground fetches during a checkpoint of DIRTY_PAGES dirty pages: a thread keeps fetching cached pages while the
+ * pages are written with flush_all, which holds every shard latch until all are written, with checkpoint, which lets
+ * fetches in between batches, and with checkpoint paced to a write rate. Reports the time to write the pages and the
+ * slowest foreground fetch meanwhile
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+#include <pthread.h>
+
+#define BENCH_TABLE "bpm_checkpoint_bench"
+#define DIRTY_PAGES 8192
+#define SHARDS 8
+#define PACED_PAGES_PER_SEC 40000
+
+typedef struct {
+    BufferPoolManager *bpm;
+    page_id_t first_pid;
+    bool stop;
+    u64 fetches;
+    u64 max_fetch_ns;
+} Foreground;
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static void *fetch_loop(void *arg) {
+    Foreground *fg = (Foreground *)arg;
+    u32 x = 2463534242u;
+    while (!__atomic_load_n(&fg->stop, __ATOMIC_ACQUIRE)) {
+        page_id_t pid = fg->first_pid + next_random(&x) % DIRTY_PAGES;
+        uint64_t start = bench_now_ns();
+        fetch_bpm_page(pid, fg->bpm, NULL);
+        unpin_page(pid, false, fg->bpm);
+        uint64_t elapsed = bench_now_ns() - start;
+        if (elapsed > fg->max_fetch_ns)
+            fg->max_fetch_ns = elapsed;
+        fg->fetches++;
+    }
+    return NULL;
+}
+
+static void run(DiskManager *disk_mgr, page_id_t first_pid, int mode, const char *label) {
+    BufferPoolManager *bpm = new_sharded_bpm(DIRTY_PAGES, SHARDS, disk_mgr);
+    for (page_id_t pid = first_pid; pid < first_pid + DIRTY_PAGES; pid++) {
+        fetch_bpm_page(pid, bpm, NULL)->data[PAGE_SIZE - 1] = pid;
+        unpin_page(pid, true, bpm);
+    }
+
+    Foreground fg = {.bpm = bpm, .first_pid = first_pid, .stop = false, .fetches = 0, .max_fetch_ns = 0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, fetch_loop, &fg);
+    uint64_t start = bench_now_ns();
+    if (mode == 0)
+        flush_all(bpm);
+    else
+        checkpoint(bpm, mode == 1 ? 0 : PACED_PAGES_PER_SEC);
+    uint64_t elapsed = bench_now_ns() - start;
+    __atomic_store_n(&fg.stop, true, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    bench_report(label, DIRTY_PAGES, elapsed, "page");
+    printf("    %llu foreground fetches meanwhile, slowest %.3f ms\n", (unsigned long long)fg.fetches,
+           fg.max_fetch_ns / 1e6);
+    detach_bpm(bpm);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    page_id_t first_pid = table_num_pages(disk_mgr);
+    allocate_table_pages(disk_mgr, first_pid, DIRTY_PAGES);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    run(disk_mgr, first_pid, 0, "flush_all");
+    run(disk_mgr, first_pid, 1, "checkpoint");
+    run(disk_mgr, first_pid, 2, "checkpoint, 40K pages/s");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * fetch_bpm_page + unpin_page latency with every page already in the buffer pool (100% hit rate), in sequential and
+ * random page order. Every page stays pinned once, so the pairs never hand frames to the replacer and time the page
+ * table lookups and pin counting only. For comparison, also times the lookups the string-keyed HashTable page table
+ * used to do for each of those calls: formatting the page id and finding it with strcmp
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
+#include "../include/utils/hash.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define BENCH_TABLE "bpm_fetch_bench"
+#define POOL_PAGES 1000
+#define ROUNDS 2000
+
+static page_id_t order[POOL_PAGES];
+
+static void fetch_unpin(BufferPoolManager *bpm, const char *label) {
+    uint64_t start = bench_now_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < POOL_PAGES; i++) {
+            fetch_bpm_page(order[i], bpm, NULL);
+            unpin_page(order[i], false, bpm);
+        }
+    }
+    bench_report(label, (u64)ROUNDS * POOL_PAGES, bench_now_ns() - start, "pairs");
+}
+
+// The two lookups of a fetch/unpin pair through the HashTable page table
+static void string_keyed_lookups(HashTable *ht, const char *label) {
+    volatile frame_id_t sink = 0;
+    uint64_t start = bench_now_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < POOL_PAGES; i++) {
+            for (int lookup = 0; lookup < 2; lookup++) {
+                char pid_str[11];
+                sprintf(pid_str, "%d", order[i]);
+                sink = *(frame_id_t *)hash_find(pid_str, ht)->data;
+            }
+        }
+    }
+    bench_report(label, (u64)ROUNDS * POOL_PAGES, bench_now_ns() - start, "pairs");
+    (void)sink;
+}
+
+static void shuffle(void) {
+    srand(1);
+    for (u32 i = POOL_PAGES - 1; i > 0; i--) {
+        u32 j = rand() % (i + 1);
+        page_id_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    while (disk_mgr->page_directory->num_pages < POOL_PAGES)
+        extend_table(disk_mgr);
+
+    BufferPoolManager *bpm = new_bpm(POOL_PAGES, disk_mgr);
+    HashTable *ht = init_hash(POOL_PAGES);
+    for (page_id_t pid = 0; pid < POOL_PAGES; pid++) {
+        order[pid] = pid;
+        BpmPage *page = fetch_bpm_page(pid, bpm, NULL);
+
+        char *key = (char *)malloc(11);
+        frame_id_t *fid = (frame_id_t *)malloc(sizeof(frame_id_t));
+        sprintf(key, "%u", pid);
+        *fid = page - bpm->pool->pages;
+        HashInsertArgs in_args = {.key = key, .data = fid, .ht = ht};
+        hash_insert(&in_args);
+    }
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    fetch_unpin(bpm, "fetch+unpin, sequential");
+    string_keyed_lookups(ht, "string-keyed lookups only, sequential");
+    shuffle();
+    fetch_unpin(bpm, "fetch+unpin, random");
+    string_keyed_lookups(ht, "string-keyed lookups only, random");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
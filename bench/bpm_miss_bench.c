@@ -0,0 +1,36 @@
+/*
+ * Cost of buffer pool misses as the pool grows: fills pools of 1K to 32K frames by fetching that many distinct pages,
+ * so every fetch misses and takes a free frame. The pages are allocated but never written, so their reads are served
+ * from the OS page cache and the time left is mostly finding a frame for each page
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+
+#define BENCH_TABLE "bpm_miss_bench"
+#define MAX_POOL_PAGES (32 * 1024)
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    page_id_t first_pid = table_num_pages(disk_mgr);
+    allocate_table_pages(disk_mgr, first_pid, MAX_POOL_PAGES);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    for (size_t pool_pages = 1024; pool_pages <= MAX_POOL_PAGES; pool_pages *= 2) {
+        BufferPoolManager *bpm = new_bpm(pool_pages, disk_mgr);
+
+        uint64_t start = bench_now_ns();
+        for (page_id_t pid = first_pid; pid < first_pid + pool_pages; pid++)
+            fetch_bpm_page(pid, bpm, NULL);
+        char label[64];
+        snprintf(label, sizeof(label), "fill %5zu frame pool", pool_pages);
+        bench_report(label, pool_pages, bench_now_ns() - start, "miss");
+    }
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
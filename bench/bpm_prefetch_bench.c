@@ -0,0 +1,75 @@
+/*
+ * Batched lookups of cold pages: batches of BATCH random pages are fetched one after the other, either each read on
+ * its miss, or prefetched with prefetch_bpm_pages at the start of the batch so that the reads overlap. The table file
+ * is dropped from the page cache before each run so the reads actually reach the device (where the filesystem honors
+ * POSIX_FADV_DONTNEED)
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BENCH_TABLE "bpm_prefetch_bench"
+#define BENCH_PAGES 8192
+#define BENCH_LOOKUPS 8192
+#define BATCH 32
+
+static void drop_cache(DiskManager *disk_mgr) {
+    fsync(disk_mgr->fd);
+    posix_fadvise(disk_mgr->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+static void run(DiskManager *disk_mgr, const page_id_t *pids, bool use_prefetch) {
+    BufferPoolManager *bpm = new_bpm(BENCH_PAGES, disk_mgr);
+    u64 checksum = 0;
+
+    drop_cache(disk_mgr);
+    uint64_t start = bench_now_ns();
+    for (u32 batch = 0; batch < BENCH_LOOKUPS; batch += BATCH) {
+        if (use_prefetch)
+            prefetch_bpm_pages(pids + batch, BATCH, bpm);
+        for (u32 i = batch; i < batch + BATCH; i++) {
+            BpmPage *page = fetch_bpm_page(pids[i], bpm, NULL);
+            checksum += page->data[PAGE_SIZE - 1];
+            unpin_page(pids[i], false, bpm);
+        }
+    }
+    bench_report(use_prefetch ? "batched lookups, prefetch" : "batched lookups, read on miss", BENCH_LOOKUPS,
+                 bench_now_ns() - start, "fetch");
+    BufferPool *pool = bpm->pool;
+    printf("    %llu misses, %llu prefetched, %llu waits (checksum %llu)\n", (unsigned long long)pool->fetch_misses,
+           (unsigned long long)pool->prefetch_reads, (unsigned long long)pool->prefetch_waits,
+           (unsigned long long)checksum);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    page_id_t first_pid = table_num_pages(disk_mgr);
+    allocate_table_pages(disk_mgr, first_pid, BENCH_PAGES);
+
+    // Distinct pages, so that every lookup is cold
+    page_id_t *pids = (page_id_t *)malloc(sizeof(page_id_t) * BENCH_PAGES);
+    for (u32 i = 0; i < BENCH_PAGES; i++)
+        pids[i] = first_pid + i;
+    srand(42);
+    for (u32 i = BENCH_PAGES - 1; i > 0; i--) {
+        u32 j = rand() % (i + 1);
+        page_id_t tmp = pids[i];
+        pids[i] = pids[j];
+        pids[j] = tmp;
+    }
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    run(disk_mgr, pids, false);
+    run(disk_mgr, pids, true);
+
+    free(pids);
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Shrinking a warm buffer pool to give memory back, then growing it again: the pool caches POOL_PAGES pages, is shrunk
+ * to a quarter and grown back, with lookups of a hot set of HOT_PAGES pages (which fits in the smallest size) after
+ * each step. Reports the time of each resize, the hot lookups' hit ratio after it, and the resident memory of the
+ * process, compared to dropping the pool and starting a smaller one cold
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+#include <unistd.h>
+
+#define BENCH_TABLE "bpm_resize_bench"
+#define POOL_PAGES 16384
+#define SMALL_POOL_PAGES (POOL_PAGES / 4)
+#define HOT_PAGES 2048
+#define LOOKUPS 65536
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static double resident_mb(void) {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    if (statm != NULL) {
+        if (fscanf(statm, "%lu %lu", &size, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+static void hot_lookups(BufferPoolManager *bpm, page_id_t first_pid, const char *after) {
+    u32 x = 2463534242u;
+    u64 hits = 0;
+    for (u32 i = 0; i < LOOKUPS; i++) {
+        page_id_t pid = first_pid + next_random(&x) % HOT_PAGES;
+        u64 misses = bpm->pool->fetch_misses;
+        fetch_bpm_page(pid, bpm, NULL);
+        unpin_page(pid, false, bpm);
+        hits += bpm->pool->fetch_misses == misses;
+    }
+    printf("    after %-32s hot hit ratio %6.2f%%, resident %7.1f MiB\n", after, 100.0 * hits / LOOKUPS,
+           resident_mb());
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    page_id_t first_pid = table_num_pages(disk_mgr);
+    allocate_table_pages(disk_mgr, first_pid, POOL_PAGES);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    BufferPool *pool = new_resizable_buffer_pool(POOL_PAGES, POOL_PAGES, 8, REPLACER_CLOCK);
+    BufferPoolManager *bpm = attach_bpm(pool, disk_mgr);
+    // Cold pages first, so that the hot ones are the last the clock would evict
+    for (page_id_t pid = first_pid + POOL_PAGES; pid-- > first_pid;) {
+        fetch_bpm_page(pid, bpm, NULL);
+        unpin_page(pid, false, bpm);
+    }
+    hot_lookups(bpm, first_pid, "warm up");
+
+    uint64_t start = bench_now_ns();
+    resize_buffer_pool(pool, SMALL_POOL_PAGES);
+    bench_report("shrink to a quarter", POOL_PAGES - SMALL_POOL_PAGES, bench_now_ns() - start, "frame");
+    hot_lookups(bpm, first_pid, "shrink");
+
+    start = bench_now_ns();
+    resize_buffer_pool(pool, POOL_PAGES);
+    bench_report("grow back", POOL_PAGES - SMALL_POOL_PAGES, bench_now_ns() - start, "frame");
+    hot_lookups(bpm, first_pid, "grow");
+    detach_bpm(bpm);
+    free_buffer_pool(pool);
+
+    BufferPoolManager *cold = new_sharded_bpm(SMALL_POOL_PAGES, 8, disk_mgr);
+    hot_lookups(cold, first_pid, "restart with a smaller pool");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Fetches per second of 1 to 64 reader threads doing fetch_bpm_page + unpin_page pairs on random resident pages, with
+ * a single shard (one latch for the whole buffer pool) and with as many shards as the largest number of threads.
+ * Every page stays pinned once, so the readers only contend on the shard latches and never evict
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define BENCH_TABLE "bpm_scaling_bench"
+#define POOL_PAGES 1024
+#define MAX_THREADS 64
+#define FETCHES_PER_THREAD 200000
+
+typedef struct {
+    BufferPoolManager *bpm;
+    u32 seed;
+} Reader;
+
+static void *read_pages_randomly(void *arg) {
+    Reader *reader = (Reader *)arg;
+    u32 x = reader->seed;
+    for (u32 i = 0; i < FETCHES_PER_THREAD; i++) {
+        // xorshift, cheaper than rand() and without its lock
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        page_id_t pid = x % POOL_PAGES;
+        fetch_bpm_page(pid, reader->bpm, NULL);
+        unpin_page(pid, false, reader->bpm);
+    }
+    return NULL;
+}
+
+static void run_readers(BufferPoolManager *bpm, u32 num_threads) {
+    pthread_t threads[MAX_THREADS];
+    Reader readers[MAX_THREADS];
+    uint64_t start = bench_now_ns();
+    for (u32 i = 0; i < num_threads; i++) {
+        readers[i] = (Reader){.bpm = bpm, .seed = 2463534242u + i};
+        pthread_create(threads + i, NULL, read_pages_randomly, readers + i);
+    }
+    for (u32 i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%2u threads, %2u shard(s)", num_threads, bpm->pool->num_shards);
+    bench_report(label, (u64)num_threads * FETCHES_PER_THREAD, bench_now_ns() - start, "fetch");
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    while (disk_mgr->page_directory->num_pages < POOL_PAGES)
+        extend_table(disk_mgr);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    u32 shard_counts[] = {1, MAX_THREADS};
+    for (u32 s = 0; s < sizeof(shard_counts) / sizeof(shard_counts[0]); s++) {
+        BufferPoolManager *bpm = new_sharded_bpm(POOL_PAGES, shard_counts[s], disk_mgr);
+        for (page_id_t pid = 0; pid < POOL_PAGES; pid++)
+            fetch_bpm_page(pid, bpm, NULL);
+        for (u32 threads = 1; threads <= MAX_THREADS; threads *= 2)
+            run_readers(bpm, threads);
+    }
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
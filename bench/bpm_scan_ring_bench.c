@@ -0,0 +1,74 @@
+/*
+ * OLTP lookups sharing a buffer pool with full table scans: 4 lookups of a hot set of HOT_PAGES pages, which fits in
+ * the pool, alternate with every page a scan of SCAN_PAGES pages reads. Reports the hot lookups' hit ratio with the
+ * scans reading through the replacer like the lookups, and through a ring of BULK_SCAN_RING_FRAMES frames
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+
+#define BENCH_TABLE "bpm_scan_ring_bench"
+#define POOL_PAGES 512
+#define HOT_PAGES 384
+#define SCAN_PAGES 8192
+#define SCANS 4
+#define LOOKUPS_PER_SCAN_PAGE 4
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static void run(DiskManager *disk_mgr, page_id_t first_pid, bool use_ring) {
+    BufferPoolManager *bpm = new_bpm(POOL_PAGES, disk_mgr);
+    AccessStrategy *strategy = use_ring ? new_bulk_scan_strategy(bpm, BULK_SCAN_RING_FRAMES) : NULL;
+    page_id_t first_scan_pid = first_pid + HOT_PAGES;
+    for (page_id_t pid = first_pid; pid < first_scan_pid; pid++) {
+        fetch_bpm_page(pid, bpm, NULL);
+        unpin_page(pid, false, bpm);
+    }
+
+    u32 x = 2463534242u;
+    u64 lookups = 0;
+    u64 hot_hits = 0;
+    uint64_t start = bench_now_ns();
+    for (int scan = 0; scan < SCANS; scan++) {
+        for (page_id_t scan_pid = first_scan_pid; scan_pid < first_scan_pid + SCAN_PAGES; scan_pid++) {
+            for (int i = 0; i < LOOKUPS_PER_SCAN_PAGE; i++) {
+                page_id_t pid = first_pid + next_random(&x) % HOT_PAGES;
+                u64 misses = bpm->pool->fetch_misses;
+                fetch_bpm_page(pid, bpm, NULL);
+                unpin_page(pid, false, bpm);
+                hot_hits += bpm->pool->fetch_misses == misses;
+                lookups++;
+            }
+            fetch_bpm_page(scan_pid, bpm, strategy);
+            unpin_page(scan_pid, false, bpm);
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_report(use_ring ? "lookups + scans, scan ring" : "lookups + scans, no ring",
+                 lookups + (u64)SCANS * SCAN_PAGES, elapsed, "fetch");
+    printf("    hot lookup hit ratio %.2f%%\n", 100.0 * hot_hits / lookups);
+    free_access_strategy(strategy);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 1);
+    page_id_t first_pid = table_num_pages(disk_mgr);
+    allocate_table_pages(disk_mgr, first_pid, HOT_PAGES + SCAN_PAGES);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    run(disk_mgr, first_pid, false);
+    run(disk_mgr, first_pid, true);
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Many tables behind the same amount of buffer pool memory: TABLES tables of TABLE_PAGES pages each, where HOT_PCT
+ * percent of the fetches go to HOT_PAGES pages of the first table and the rest spread over all tables. Compares giving every table its
+ * own pool of POOL_PAGES / TABLES frames with attaching them all to a single shared pool of POOL_PAGES frames, and
+ * reports the hit ratio of each
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+
+#define TABLES 16
+#define TABLE_PAGES 1024
+#define POOL_PAGES 1024
+#define HOT_PCT 90
+#define HOT_PAGES 768
+#define FETCHES 400000
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static void run(DiskManager **tables, page_id_t *first_pids, bool shared) {
+    BufferPoolManager *bpms[TABLES];
+    BufferPool *shared_pool = shared ? new_buffer_pool(POOL_PAGES, 1, REPLACER_CLOCK) : NULL;
+    for (int t = 0; t < TABLES; t++)
+        bpms[t] = shared ? attach_bpm(shared_pool, tables[t]) : new_bpm(POOL_PAGES / TABLES, tables[t]);
+
+    u32 x = 88675123u;
+    u64 hits = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < FETCHES; i++) {
+        int t = 0;
+        page_id_t pid;
+        if (next_random(&x) % 100 < HOT_PCT) {
+            pid = first_pids[0] + next_random(&x) % HOT_PAGES;
+        } else {
+            t = next_random(&x) % TABLES;
+            pid = first_pids[t] + next_random(&x) % TABLE_PAGES;
+        }
+        u64 misses = bpms[t]->pool->fetch_misses;
+        fetch_bpm_page(pid, bpms[t], NULL);
+        unpin_page(pid, false, bpms[t]);
+        hits += bpms[t]->pool->fetch_misses == misses;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_report(shared ? "16 tables, one shared pool" : "16 tables, a pool each", FETCHES, elapsed, "fetch");
+    printf("    hit ratio %.2f%%\n", 100.0 * hits / FETCHES);
+}
+
+int main(void) {
+    char col_n[4] = "col";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *tables[TABLES];
+    page_id_t first_pids[TABLES];
+    char names[TABLES][32];
+    for (int t = 0; t < TABLES; t++) {
+        snprintf(names[t], sizeof(names[t]), "bpm_shared_pool_bench_%d", t);
+        remove_table(names[t]);
+        tables[t] = create_table(names[t], cols, 1);
+        first_pids[t] = table_num_pages(tables[t]);
+        allocate_table_pages(tables[t], first_pids[t], TABLE_PAGES);
+    }
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    run(tables, first_pids, false);
+    run(tables, first_pids, true);
+
+    for (int t = 0; t < TABLES; t++) {
+        close_table_file(tables[t]);
+        remove_table(names[t]);
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Cost of CRC-32C page checksums: stamping and verifying a 4KiB page with the hardware crc32 instructions (if the CPU
+ * has them) against the table-driven fallback
+ */
+#include "../include/disk/disk_manager.h"
+#include "../include/disk/heapfile.h"
+#include "../include/utils/crc32c.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_PAGES 256 // 1MB, stays in the CPU caches like a page that was just read or written
+#define ROUNDS 2000
+
+static volatile u32 sink;
+
+static void report_per_page(const char *name, u64 num_pages, uint64_t elapsed_ns) {
+    bench_report(name, num_pages, elapsed_ns, "pages");
+    printf("%-40s %10.1f ns/page\n", "", (double)elapsed_ns / num_pages);
+}
+
+int main(void) {
+    static u8 pages[NUM_PAGES][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+    srand(7);
+    for (u32 p = 0; p < NUM_PAGES; p++)
+        for (u32 i = 0; i < PAGE_SIZE; i++)
+            pages[p][i] = rand();
+    // Checksums only need the page type, no file is involved
+    DiskManager disk_mgr;
+    memset(&disk_mgr, 0, sizeof(disk_mgr));
+    disk_mgr.page_type = HEAP_PAGE;
+
+    printf("crc32 instructions available: %s\n", crc32c_hw_available() ? "yes" : "no");
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+
+    uint64_t start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (u32 p = 0; p < NUM_PAGES; p++)
+            set_page_checksum(&disk_mgr, START_USER_PAGE + p, pages[p]);
+    report_per_page("stamp page checksum", (u64)NUM_PAGES * ROUNDS, bench_now_ns() - start);
+
+    u32 failures = 0;
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (u32 p = 0; p < NUM_PAGES; p++)
+            failures += !verify_page_checksum(&disk_mgr, START_USER_PAGE + p, pages[p]);
+    report_per_page("verify page checksum", (u64)NUM_PAGES * ROUNDS, bench_now_ns() - start);
+    if (failures > 0)
+        printf("unexpected checksum failures: %u\n", failures);
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS / 10; r++)
+        for (u32 p = 0; p < NUM_PAGES; p++)
+            sink = crc32c_update_sw(0, pages[p], PAGE_SIZE);
+    report_per_page("table-driven crc32c of a page", (u64)NUM_PAGES * ROUNDS / 10, bench_now_ns() - start);
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Throughput of the clock replacer's operations on a 1024 frame replacer: unpin + pin pairs of random frames (a page
+ * being fetched and given back while others stay evictable), and unpin + evict cycles that keep the replacer full and
+ * make the hand sweep
+ */
+#include "../include/disk/clock_replacer.h"
+#include "bench.h"
+
+#define FRAMES 1024
+#define OPS 1000000
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+int main(void) {
+    ClockReplacer *replacer = clock_replacer_init(FRAMES);
+    for (frame_id_t fid = 0; fid < FRAMES; fid++)
+        clock_replacer_unpin(&fid, replacer);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    u32 x = 2463534242u;
+    uint64_t start = bench_now_ns();
+    for (u32 i = 0; i < OPS; i++) {
+        frame_id_t fid = next_random(&x) % FRAMES;
+        clock_replacer_pin(&fid, replacer);
+        clock_replacer_unpin(&fid, replacer);
+    }
+    bench_report("pin + unpin", OPS, bench_now_ns() - start, "pairs");
+
+    start = bench_now_ns();
+    for (u32 i = 0; i < OPS; i++) {
+        frame_id_t fid = evict(replacer);
+        // Referencing a few frames again gives the hand something to skip
+        if (i % 4 == 0) {
+            frame_id_t referenced = next_random(&x) % FRAMES;
+            clock_replacer_unpin(&referenced, replacer);
+        }
+        clock_replacer_unpin(&fid, replacer);
+    }
+    bench_report("evict + unpin", OPS, bench_now_ns() - start, "pairs");
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Loads a table into a buffer pool big enough to hold all of it, once with buffered I/O and once with O_DIRECT, and
+ * reports how much of the table file the OS page cache keeps on top of the buffer pool's own copy
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/disk_manager.h"
+#include "bench.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define BENCH_TABLE "direct_io_bench"
+#define BENCH_PAGES 4096
+
+// KiB of the table file currently resident in the page cache
+static long page_cache_kb(int fd) {
+    size_t len = (size_t)BENCH_PAGES * PAGE_SIZE;
+    void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return -1;
+    long sys_page = sysconf(_SC_PAGESIZE);
+    size_t num_sys_pages = (len + sys_page - 1) / sys_page;
+    unsigned char *residency = (unsigned char *)malloc(num_sys_pages);
+    long resident = 0;
+    if (mincore(map, len, residency) == 0)
+        for (size_t i = 0; i < num_sys_pages; i++)
+            resident += residency[i] & 1;
+    free(residency);
+    munmap(map, len);
+    return resident * (sys_page / 1024);
+}
+
+static void load_table(DiskManager *disk_mgr, const char *label) {
+    fsync(disk_mgr->fd);
+    posix_fadvise(disk_mgr->fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    BufferPoolManager *bpm = new_bpm(BENCH_PAGES, disk_mgr);
+    uint64_t start = bench_now_ns();
+    for (page_id_t pid = 0; pid < BENCH_PAGES; pid++) {
+        fetch_bpm_page(pid, bpm, NULL);
+        unpin_page(pid, false, bpm);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_report(label, BENCH_PAGES, elapsed, "pages");
+    printf("  buffer pool %ld KiB, page cache %ld KiB\n", (long)BENCH_PAGES * PAGE_SIZE / 1024,
+           page_cache_kb(disk_mgr->fd));
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = new_disk_manager(BENCH_TABLE);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    u8 page[PAGE_SIZE];
+    memset(page, 0x42, PAGE_SIZE);
+    for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+        write_page(pid, disk_mgr, page);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    load_table(disk_mgr, "cold table load, buffered");
+    if (set_direct_io(disk_mgr, true))
+        load_table(disk_mgr, "cold table load, O_DIRECT");
+    else
+        printf("O_DIRECT not supported by the filesystem, skipping its run\n");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Page I/O throughput of the disk manager's persistent descriptor compared to reopening the table file for every page
+ * (which is what each read_page/write_page call used to do through table_file)
+ */
+#include "../include/disk/disk_manager.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_TABLE "disk_manager_bench"
+#define BENCH_PAGES 256
+#define READ_ROUNDS 40
+#define WRITE_ROUNDS 2
+
+// Old access path: open the table file, do the I/O, close it again (the old code did not even close it)
+static void reopen_read_page(page_id_t pid, u8 *buf) {
+    int fd = table_file(BENCH_TABLE);
+    pread(fd, buf, PAGE_SIZE, (off_t)pid * PAGE_SIZE);
+    close(fd);
+}
+
+static void reopen_write_page(page_id_t pid, u8 *buf) {
+    int fd = table_file(BENCH_TABLE);
+    pwrite(fd, buf, PAGE_SIZE, (off_t)pid * PAGE_SIZE);
+    fsync(fd);
+    close(fd);
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = new_disk_manager(BENCH_TABLE);
+    u8 page[PAGE_SIZE];
+    memset(page, 0xAB, PAGE_SIZE);
+    for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+        write_page(pid, disk_mgr, page);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+
+    uint64_t start = bench_now_ns();
+    for (int r = 0; r < READ_ROUNDS; r++)
+        for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+            reopen_read_page(pid, page);
+    bench_report("read-heavy, reopen per page", READ_ROUNDS * BENCH_PAGES, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < READ_ROUNDS; r++) {
+        for (page_id_t pid = 0; pid < BENCH_PAGES; pid++) {
+            u8 *read = read_page(pid, disk_mgr);
+            free(read);
+        }
+    }
+    bench_report("read-heavy, persistent fd", READ_ROUNDS * BENCH_PAGES, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < WRITE_ROUNDS; r++)
+        for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+            reopen_write_page(pid, page);
+    bench_report("write-heavy, reopen per page", WRITE_ROUNDS * BENCH_PAGES, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < WRITE_ROUNDS; r++)
+        for (page_id_t pid = 0; pid < BENCH_PAGES; pid++)
+            write_page(pid, disk_mgr, page);
+    bench_report("write-heavy, persistent fd", WRITE_ROUNDS * BENCH_PAGES, bench_now_ns() - start, "pages");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Heap allocations and resident memory growth per operation of the heapfile and buffer pool read paths, using the
+ * operations of the heapfile tests at a larger scale. malloc/calloc/realloc are interposed to count allocations
+ */
+#include "../include/disk/bpm.h"
+#include "../include/disk/disk_manager.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_TABLE "heapfile_alloc_bench"
+#define BENCH_HEAP_PAGES 200
+#define TUPLES_PER_PAGE 145 // 24 byte tuples (see sync_policy_bench)
+#define TUPLE_NAME "abcdefghijklmnopqr"
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static u64 num_allocs = 0;
+
+extern "C" void *malloc(size_t size) {
+    num_allocs++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    num_allocs++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    num_allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+static long resident_kb(void) {
+    long size = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+typedef struct {
+    u64 allocs;
+    long rss_kb;
+    uint64_t start_ns;
+} Probe;
+
+static Probe probe_start(void) { return (Probe){.allocs = num_allocs, .rss_kb = resident_kb(), .start_ns = bench_now_ns()}; }
+
+static void probe_report(const char *label, Probe probe, u64 ops) {
+    uint64_t elapsed = bench_now_ns() - probe.start_ns;
+    u64 allocs = num_allocs - probe.allocs;
+    long rss = resident_kb() - probe.rss_kb;
+    printf("%-32s %8lu ops %10.2f allocs/op %8ld KiB RSS growth %10.0f ns/op\n", label, (unsigned long)ops,
+           (double)allocs / ops, rss, (double)elapsed / ops);
+}
+
+int main(void) {
+    char cname1[5] = "name";
+    char cname2[4] = "age";
+    Column cols[2] = {{.name_len = 4, .name = cname1, .type = STRING}, {.name_len = 3, .name = cname2, .type = INTEGER}};
+    const char *col_names[2] = {"name", "age"};
+    ColumnType col_types[2] = {STRING, INTEGER};
+    TuplePtr tup_ptr;
+    const u64 num_tuples = BENCH_HEAP_PAGES * TUPLES_PER_PAGE;
+
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 2);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    page_id_t first_pid = 0;
+
+    // Pages are filled up one at a time, since new_heap_page hands out the first page of the directory with no tuples
+    Probe probe = probe_start();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++) {
+        page_id_t pid = new_heap_page(disk_mgr);
+        if (p == 0)
+            first_pid = pid;
+        for (int t = 0; t < TUPLES_PER_PAGE; t++) {
+            ColumnValue col_vals[2] = {{.string = TUPLE_NAME}, {.integer = p * TUPLES_PER_PAGE + t}};
+            AddTupleArgs args = {.disk_manager = disk_mgr,
+                                 .column_names = col_names,
+                                 .column_values = col_vals,
+                                 .column_types = col_types,
+                                 .num_columns = 2,
+                                 .tup_ptr_out = &tup_ptr};
+            add_tuple(&args);
+        }
+    }
+    probe_report("new_heap_page + add_tuple", probe, num_tuples);
+
+    u8 tuple_page[PAGE_SIZE];
+    probe = probe_start();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++)
+        for (u16 slot = 0; slot < TUPLES_PER_PAGE; slot++)
+            get_tuple((RID){.pid = (page_id_t)(first_pid + p), .slot_num = slot}, disk_mgr, tuple_page);
+    probe_report("get_tuple", probe, num_tuples);
+
+    probe = probe_start();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++)
+        for (u16 slot = 0; slot < TUPLES_PER_PAGE; slot += 2)
+            remove_tuple(disk_mgr, (RID){.pid = (page_id_t)(first_pid + p), .slot_num = slot});
+    probe_report("remove_tuple", probe, num_tuples / 2);
+
+    probe = probe_start();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++)
+        defragment(first_pid + p, disk_mgr);
+    probe_report("defragment", probe, BENCH_HEAP_PAGES);
+
+    // The pool has a frame for every page, so each fetch is a miss that doesn't need to evict
+    BufferPoolManager *bpm = new_bpm(BENCH_HEAP_PAGES, disk_mgr);
+    probe = probe_start();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++) {
+        fetch_bpm_page(first_pid + p, bpm, NULL);
+        unpin_page(first_pid + p, false, bpm);
+    }
+    probe_report("fetch_bpm_page (miss)", probe, BENCH_HEAP_PAGES);
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
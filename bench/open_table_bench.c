@@ -0,0 +1,97 @@
+/*
+ * Cost of opening existing tables with open_table, which reads the page directory and the schema page in one read,
+ * and of inserting through a disk manager with and without the cached schema page
+ */
+#include "../include/disk/disk_manager.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TABLES 200
+#define OPEN_ROUNDS 10
+#define BIG_TABLE "open_table_bench_big"
+#define BIG_TABLE_GROUPS 8
+#define INSERT_TUPLES 200000
+
+static void table_name(int i, char *name) { snprintf(name, 32, "open_table_bench_%d", i); }
+
+int main(void) {
+    char cname1[5] = "name";
+    char cname2[4] = "age";
+    Column cols[2] = {{.name_len = 4, .name = cname1, .type = STRING}, {.name_len = 3, .name = cname2, .type = INTEGER}};
+    const char *col_names[2] = {"name", "age"};
+    ColumnType col_types[2] = {STRING, INTEGER};
+    ColumnValue col_vals[2] = {{.string = "abcdefghijklmnopqr"}, {.integer = 0}};
+    TuplePtr tup_ptr;
+    char name[32];
+
+    for (int i = 0; i < NUM_TABLES; i++) {
+        table_name(i, name);
+        remove_table(name);
+        close_table_file(create_table(name, cols, 2));
+    }
+    remove_table(BIG_TABLE);
+    DiskManager *disk_mgr = create_table(BIG_TABLE, cols, 2);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    while (disk_mgr->page_directory->num_groups < BIG_TABLE_GROUPS)
+        extend_table(disk_mgr);
+    close_table_file(disk_mgr);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    DiskManager *opened[NUM_TABLES];
+    uint64_t elapsed = 0;
+    for (int round = 0; round < OPEN_ROUNDS; round++) {
+        uint64_t start = bench_now_ns();
+        for (int i = 0; i < NUM_TABLES; i++) {
+            table_name(i, name);
+            opened[i] = open_table(name);
+        }
+        elapsed += bench_now_ns() - start;
+        for (int i = 0; i < NUM_TABLES; i++)
+            close_table_file(opened[i]);
+    }
+    bench_report("open_table, 1 directory group", NUM_TABLES * OPEN_ROUNDS, elapsed, "tables");
+
+    elapsed = 0;
+    for (int round = 0; round < OPEN_ROUNDS; round++) {
+        uint64_t start = bench_now_ns();
+        disk_mgr = open_table(BIG_TABLE);
+        elapsed += bench_now_ns() - start;
+        close_table_file(disk_mgr);
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "open_table, %d directory groups", BIG_TABLE_GROUPS);
+    bench_report(label, OPEN_ROUNDS, elapsed, "tables");
+
+    // Schema lookups on insert: cached copy from open_table versus reading the schema page every time
+    disk_mgr = open_table(BIG_TABLE);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    AddTupleArgs args = {.disk_manager = disk_mgr,
+                         .column_names = col_names,
+                         .column_values = col_vals,
+                         .column_types = col_types,
+                         .num_columns = 2,
+                         .tup_ptr_out = &tup_ptr};
+    uint64_t start = bench_now_ns();
+    for (int t = 0; t < INSERT_TUPLES; t++)
+        add_tuple(&args);
+    bench_report("insert, cached schema", INSERT_TUPLES, bench_now_ns() - start, "tuples");
+
+    u8 *schema_page = disk_mgr->schema_page;
+    disk_mgr->schema_page = NULL;
+    start = bench_now_ns();
+    for (int t = 0; t < INSERT_TUPLES; t++)
+        add_tuple(&args);
+    bench_report("insert, schema page read per tuple", INSERT_TUPLES, bench_now_ns() - start, "tuples");
+    disk_mgr->schema_page = schema_page;
+    close_table_file(disk_mgr);
+
+    for (int i = 0; i < NUM_TABLES; i++) {
+        table_name(i, name);
+        remove_table(name);
+    }
+    remove_table(BIG_TABLE);
+    return 0;
+}
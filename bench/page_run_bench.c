@@ -0,0 +1,60 @@
+/*
+ * Cost of transferring runs of consecutive pages one read_page/write_page call at a time compared to a single
+ * read_pages/write_pages call per run. Writes use SYNC_ON_CHECKPOINT so the numbers show syscall overhead, not fsync
+ */
+#include "../include/disk/disk_manager.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_TABLE "page_run_bench"
+#define RUN_PAGES 64
+#define RUNS 64
+#define ROUNDS 20
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = new_disk_manager(BENCH_TABLE);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+
+    u8 *pages = (u8 *)malloc((size_t)RUN_PAGES * PAGE_SIZE);
+    memset(pages, 0xEF, (size_t)RUN_PAGES * PAGE_SIZE);
+    struct iovec iovecs[RUN_PAGES];
+    for (u32 i = 0; i < RUN_PAGES; i++)
+        iovecs[i] = (struct iovec){.iov_base = pages + (size_t)i * PAGE_SIZE, .iov_len = PAGE_SIZE};
+    const u32 total_pages = ROUNDS * RUNS * RUN_PAGES;
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+
+    uint64_t start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (page_id_t pid = 0; pid < RUNS * RUN_PAGES; pid++)
+            write_page(pid, disk_mgr, pages + (size_t)(pid % RUN_PAGES) * PAGE_SIZE);
+    bench_report("64-page runs, write_page per page", total_pages, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (page_id_t run = 0; run < RUNS; run++)
+            write_pages(run * RUN_PAGES, RUN_PAGES, disk_mgr, iovecs);
+    bench_report("64-page runs, write_pages", total_pages, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (page_id_t pid = 0; pid < RUNS * RUN_PAGES; pid++) {
+            u8 *read = read_page(pid, disk_mgr);
+            free(read);
+        }
+    }
+    bench_report("64-page runs, read_page per page", total_pages, bench_now_ns() - start, "pages");
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (page_id_t run = 0; run < RUNS; run++)
+            read_pages(run * RUN_PAGES, RUN_PAGES, disk_mgr, iovecs);
+    bench_report("64-page runs, read_pages", total_pages, bench_now_ns() - start, "pages");
+
+    free(pages);
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Sequential page reads from a table file that is not in the page cache, with and without sequential read detection.
+ * Covers a single scan with some work per page and two scans of different halves of the table interleaved through two
+ * disk managers, which share one descriptor (and with it the kernel's own readahead state)
+ */
+#include "../include/disk/disk_manager.h"
+#include "bench.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_TABLE "readahead_bench"
+#define TABLE_PAGES 16384 // 64MB
+#define WRITE_RUN 256
+#define WORK_ROUNDS 2000 // per page work of a scan, a few microseconds
+
+static volatile u64 sink;
+
+static void evict_from_page_cache(DiskManager *disk_mgr) {
+    sync_table_file(disk_mgr);
+    posix_fadvise(disk_mgr->fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+static void process_page(const u8 *page) {
+    u64 h = 0;
+    for (int i = 0; i < WORK_ROUNDS; i++)
+        h = h * 31 + page[i % PAGE_SIZE];
+    sink = h;
+}
+
+static void single_scan(DiskManager *disk_mgr, u32 readahead_max_pages, const char *label) {
+    u8 page[PAGE_SIZE];
+    disk_mgr->readahead_max_pages = readahead_max_pages;
+    evict_from_page_cache(disk_mgr);
+    uint64_t start = bench_now_ns();
+    for (page_id_t pid = 0; pid < TABLE_PAGES; pid++) {
+        read_page_into(pid, disk_mgr, page);
+        process_page(page);
+    }
+    bench_report(label, TABLE_PAGES, bench_now_ns() - start, "pages");
+}
+
+static void interleaved_scans(DiskManager *first, DiskManager *second, u32 readahead_max_pages, const char *label) {
+    u8 page[PAGE_SIZE];
+    first->readahead_max_pages = second->readahead_max_pages = readahead_max_pages;
+    evict_from_page_cache(first);
+    uint64_t start = bench_now_ns();
+    for (page_id_t pid = 0; pid < TABLE_PAGES / 2; pid++) {
+        read_page_into(pid, first, page);
+        process_page(page);
+        read_page_into(TABLE_PAGES / 2 + pid, second, page);
+        process_page(page);
+    }
+    bench_report(label, TABLE_PAGES, bench_now_ns() - start, "pages");
+}
+
+int main(void) {
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = new_disk_manager(BENCH_TABLE);
+    DiskManager *second_mgr = new_disk_manager(BENCH_TABLE);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+
+    static u8 pages[WRITE_RUN][PAGE_SIZE];
+    struct iovec iovecs[WRITE_RUN];
+    for (u32 i = 0; i < WRITE_RUN; i++) {
+        memset(pages[i], i, PAGE_SIZE);
+        iovecs[i] = (struct iovec){.iov_base = pages[i], .iov_len = PAGE_SIZE};
+    }
+    for (page_id_t pid = 0; pid < TABLE_PAGES; pid += WRITE_RUN)
+        write_pages(pid, WRITE_RUN, disk_mgr, iovecs);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    single_scan(disk_mgr, 0, "cold scan, no readahead hints");
+    single_scan(disk_mgr, READAHEAD_MAX_PAGES, "cold scan, readahead hints");
+    interleaved_scans(disk_mgr, second_mgr, 0, "2 interleaved scans, no hints");
+    interleaved_scans(disk_mgr, second_mgr, READAHEAD_MAX_PAGES, "2 interleaved scans, readahead hints");
+
+    close_table_file(second_mgr);
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
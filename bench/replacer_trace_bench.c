@@ -0,0 +1,147 @@
+/*
+ * Trace-driven simulation of the replacement policies: replays page access traces against each policy in front of a
+ * simulated buffer pool of POOL_PAGES frames (no I/O, every access pins and unpins its page) and reports hit ratios.
+ * Replays the page ids in the file given as the first argument, one per line, or else these synthetic traces:
+ *  - index + scan: B+tree lookups (root, one of 16 inner nodes, one of 2048 leaves, skewed towards the first leaves)
+ *    interleaved with a sequential scan of 8192 heap pages, the case that flushes a clock pool of its inner nodes
+ *  - zipf: accesses to 8192 pages with Zipf-like skew
+ *  - loop: repeated sequential passes over 1.5 times more pages than fit in the pool
+ */
+#include "../include/disk/page_table.h"
+#include "../include/disk/replacer.h"
+#include "bench.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define POOL_PAGES 256
+#define TRACE_LENGTH 1000000
+#define SCAN_FIRST_PID 100000
+
+typedef struct {
+    const char *name;
+    page_id_t *pids;
+    size_t length;
+} Trace;
+
+static u32 next_random(u32 *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+// Page number in [0, n) with P(i) roughly proportional to 1 / (i + 1)
+static u32 skewed(u32 *x, u32 n) {
+    double u = (next_random(x) & 0xFFFFFF) / (double)0x1000000;
+    return (u32)(exp(u * log((double)n + 1)) - 1) % n;
+}
+
+static Trace index_scan_trace(void) {
+    Trace trace = {.name = "index + scan", .pids = (page_id_t *)malloc(sizeof(page_id_t) * TRACE_LENGTH), .length = 0};
+    u32 x = 2463534242u;
+    page_id_t scan_pid = SCAN_FIRST_PID;
+    while (trace.length + 4 <= TRACE_LENGTH) {
+        trace.pids[trace.length++] = 0;
+        trace.pids[trace.length++] = 1 + next_random(&x) % 16;
+        trace.pids[trace.length++] = 17 + skewed(&x, 2048);
+        trace.pids[trace.length++] = scan_pid;
+        scan_pid = scan_pid + 1 < SCAN_FIRST_PID + 8192 ? scan_pid + 1 : SCAN_FIRST_PID;
+    }
+    return trace;
+}
+
+static Trace zipf_trace(void) {
+    Trace trace = {.name = "zipf", .pids = (page_id_t *)malloc(sizeof(page_id_t) * TRACE_LENGTH), .length = 0};
+    u32 x = 88675123u;
+    while (trace.length < TRACE_LENGTH)
+        trace.pids[trace.length++] = skewed(&x, 8192);
+    return trace;
+}
+
+static Trace loop_trace(void) {
+    Trace trace = {.name = "loop", .pids = (page_id_t *)malloc(sizeof(page_id_t) * TRACE_LENGTH), .length = 0};
+    while (trace.length < TRACE_LENGTH)
+        trace.pids[trace.length] = trace.length % (POOL_PAGES * 3 / 2), trace.length++;
+    return trace;
+}
+
+static Trace file_trace(const char *path) {
+    Trace trace = {.name = path, .pids = NULL, .length = 0};
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    size_t capacity = 1024;
+    trace.pids = (page_id_t *)malloc(sizeof(page_id_t) * capacity);
+    unsigned long pid;
+    while (fscanf(file, "%lu", &pid) == 1) {
+        if (trace.length == capacity) {
+            capacity *= 2;
+            trace.pids = (page_id_t *)realloc(trace.pids, sizeof(page_id_t) * capacity);
+        }
+        trace.pids[trace.length++] = (page_id_t)pid;
+    }
+    fclose(file);
+    return trace;
+}
+
+static void replay(const Trace *trace, ReplacerPolicy policy, const char *policy_name) {
+    Replacer replacer;
+    PageTable page_table;
+    page_id_t frame_pages[POOL_PAGES];
+    replacer_init(&replacer, policy, 0, POOL_PAGES);
+    page_table_init(&page_table, POOL_PAGES);
+    frame_id_t used_frames = 0;
+    u64 hits = 0;
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < trace->length; i++) {
+        page_id_t pid = trace->pids[i];
+        frame_id_t fid = page_table_find(&page_table, pid);
+        if (fid != NO_FRAME) {
+            hits++;
+        } else {
+            if (used_frames < POOL_PAGES) {
+                fid = used_frames++;
+            } else {
+                fid = replacer_evict(&replacer);
+                page_table_remove(&page_table, frame_pages[fid]);
+            }
+            frame_pages[fid] = pid;
+            page_table_insert(&page_table, pid, fid);
+        }
+        replacer_pin(&replacer, fid, pid);
+        replacer_unpin(&replacer, fid);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %s", trace->name, policy_name);
+    bench_report(label, trace->length, elapsed, "access");
+    printf("    hit ratio %.2f%%\n", 100.0 * hits / trace->length);
+
+    replacer_destroy(&replacer);
+    page_table_destroy(&page_table);
+}
+
+int main(int argc, char **argv) {
+    Trace traces[3];
+    size_t num_traces = 0;
+    if (argc > 1) {
+        traces[num_traces++] = file_trace(argv[1]);
+    } else {
+        traces[num_traces++] = index_scan_trace();
+        traces[num_traces++] = zipf_trace();
+        traces[num_traces++] = loop_trace();
+    }
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    for (size_t i = 0; i < num_traces; i++) {
+        replay(traces + i, REPLACER_CLOCK, "clock");
+        replay(traces + i, REPLACER_LRU_K, "LRU-2");
+        replay(traces + i, REPLACER_2Q, "2Q");
+        free(traces[i].pids);
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Bulk insert throughput of add_tuple under each of the disk manager's sync policies.
+ * Time includes the final sync making all inserted tuples durable
+ */
+#include "../include/disk/disk_manager.h"
+#include "../include/disk/heapfile.h"
+#include "bench.h"
+#include <string.h>
+
+#define BENCH_TABLE "sync_policy_bench"
+#define BENCH_HEAP_PAGES 20
+#define SYNC_INTERVAL_MS 10
+
+// 18 characters long name gives 24 byte tuples, so 145 of them (with their tuple pointers) fill up a page
+#define TUPLE_NAME "abcdefghijklmnopqr"
+#define TUPLES_PER_PAGE 145
+
+static void bulk_insert(SyncPolicy policy, const char *label) {
+    char cname1[5] = "name";
+    char cname2[4] = "age";
+    Column cols[2] = {{.name_len = 4, .name = cname1, .type = STRING}, {.name_len = 3, .name = cname2, .type = INTEGER}};
+    const char *col_names[2] = {"name", "age"};
+    ColumnType col_types[2] = {STRING, INTEGER};
+    TuplePtr tup_ptr;
+
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 2);
+    set_sync_policy(disk_mgr, policy, SYNC_INTERVAL_MS);
+
+    uint64_t start = bench_now_ns();
+    for (int p = 0; p < BENCH_HEAP_PAGES; p++) {
+        new_heap_page(disk_mgr);
+        for (int t = 0; t < TUPLES_PER_PAGE; t++) {
+            ColumnValue col_vals[2] = {{.string = TUPLE_NAME}, {.integer = p * TUPLES_PER_PAGE + t}};
+            AddTupleArgs args = {.disk_manager = disk_mgr,
+                                 .column_names = col_names,
+                                 .column_values = col_vals,
+                                 .column_types = col_types,
+                                 .num_columns = 2,
+                                 .tup_ptr_out = &tup_ptr};
+            add_tuple(&args);
+        }
+    }
+    sync_table_file(disk_mgr);
+    bench_report(label, BENCH_HEAP_PAGES * TUPLES_PER_PAGE, bench_now_ns() - start, "tuples");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+}
+
+int main(void) {
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    bulk_insert(SYNC_ALWAYS, "bulk insert, SYNC_ALWAYS");
+    bulk_insert(SYNC_PERIODIC, "bulk insert, SYNC_PERIODIC (10ms)");
+    bulk_insert(SYNC_ON_CHECKPOINT, "bulk insert, SYNC_ON_CHECKPOINT");
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Insert cost while a table grows well past the old 500 page limit. With extent-based growth and free space map
+ * lookups the cost per insert should stay flat as the table gets bigger. Afterwards space is freed all over the table,
+ * which following inserts should reuse instead of growing the table
+ */
+#include "../include/disk/disk_manager.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
+#include "bench.h"
+#include <string.h>
+
+#define BENCH_TABLE "table_growth_bench"
+#define TUPLE_NAME "abcdefghijklmnopqr" // 24 byte tuples (see sync_policy_bench)
+#define CHUNK_TUPLES 200000
+#define NUM_CHUNKS 5
+#define TUPLES_PER_PAGE 145
+#define HOLE_PAGES 1000 // pages that get half of their tuples removed
+
+int main(void) {
+    char cname1[5] = "name";
+    char cname2[4] = "age";
+    Column cols[2] = {{.name_len = 4, .name = cname1, .type = STRING}, {.name_len = 3, .name = cname2, .type = INTEGER}};
+    const char *col_names[2] = {"name", "age"};
+    ColumnType col_types[2] = {STRING, INTEGER};
+    TuplePtr tup_ptr;
+
+    remove_table(BENCH_TABLE);
+    DiskManager *disk_mgr = create_table(BENCH_TABLE, cols, 2);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+
+    printf("%-40s %10s %-6s %13s %20s\n", "benchmark", "ops", "", "time", "throughput");
+    ColumnValue col_vals[2] = {{.string = TUPLE_NAME}, {.integer = 0}};
+    AddTupleArgs args = {.disk_manager = disk_mgr,
+                         .column_names = col_names,
+                         .column_values = col_vals,
+                         .column_types = col_types,
+                         .num_columns = 2,
+                         .tup_ptr_out = &tup_ptr};
+    char label[64];
+    for (int chunk = 0; chunk < NUM_CHUNKS; chunk++) {
+        uint64_t start = bench_now_ns();
+        for (int t = 0; t < CHUNK_TUPLES; t++)
+            add_tuple(&args);
+        snprintf(label, sizeof(label), "insert, table at %u pages", disk_mgr->page_directory->num_pages);
+        bench_report(label, CHUNK_TUPLES, bench_now_ns() - start, "tuples");
+    }
+
+    for (page_id_t pid = START_USER_PAGE; pid < START_USER_PAGE + HOLE_PAGES; pid++) {
+        for (u32 slot = 0; slot < TUPLES_PER_PAGE; slot += 2)
+            remove_tuple(disk_mgr, (RID){.pid = pid, .slot_num = slot});
+        defragment(pid, disk_mgr);
+    }
+    u32 pages_before = disk_mgr->page_directory->num_pages;
+    const u32 refill_tuples = HOLE_PAGES * TUPLES_PER_PAGE / 2;
+    uint64_t start = bench_now_ns();
+    for (u32 t = 0; t < refill_tuples; t++)
+        add_tuple(&args);
+    snprintf(label, sizeof(label), "refill freed space, %u -> %u pages", pages_before,
+             disk_mgr->page_directory->num_pages);
+    bench_report(label, refill_tuples, bench_now_ns() - start, "tuples");
+
+    close_table_file(disk_mgr);
+    remove_table(BENCH_TABLE);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../utils/shared.h"
+#include "disk_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Asynchronous page I/O. Page reads and writes are queued, submitted in batches and reaped as completions, which lets
+ * a single thread keep many page misses in flight:
+ *
+ *  async_io_read_page(aio, dm, pid, frame_data, tag);   // repeat for each page to load
+ *  async_io_submit(aio);                                 // one syscall for the whole batch
+ *  ... useful work ...
+ *  async_io_complete(aio, completions, n, 1);            // wait for at least one to finish
+ *
+ * IO_BACKEND_URING submits through io_uring (raw syscalls, no liburing needed). When io_uring is not available (old
+ * kernel, seccomp filter...) IO_BACKEND_BLOCKING is used instead, which does the I/O right away with pread/pwrite and
+ * hands out the completions on the next async_io_complete, so callers don't need to care which backend they got.
+ */
+enum IoBackend { IO_BACKEND_BLOCKING = 0, IO_BACKEND_URING = 1 };
+
+typedef struct {
+    u64 user_data; // tag the request was queued with
+    int result;    // number of bytes transferred, or -errno if the request failed
+} IoCompletion;
+
+typedef struct {
+    u64 user_data;
+    DiskManager *disk_manager;
+    page_id_t page_id;
+    bool is_write;
+} IoRequest;
+
+typedef struct UringQueues UringQueues;
+
+typedef struct {
+    IoBackend backend;
+    u32 depth;            // max number of requests in flight
+    u32 in_flight;        // number of queued requests that were not reaped yet
+    IoRequest *requests;  // in flight requests, indexed by slot
+    u32 *free_slots;      // stack of unused request slots
+    u32 num_free_slots;
+    IoCompletion *ready;  // completions of the blocking backend waiting to be reaped
+    u32 num_ready;
+    UringQueues *uring;   // io_uring mappings, null for the blocking backend
+} AsyncIo;
+
+/*
+ * Creates an asynchronous I/O context able to keep DEPTH requests in flight. Tries io_uring if USE_URING is set,
+ * falling back to the blocking backend if it can't be set up or doesn't support plain reads and writes (before 5.6).
+ * The chosen backend is stored in the returned context
+ */
+AsyncIo *async_io_init(u32 depth, bool use_uring);
+
+/*
+ * Queues a read of page PAGE_ID of DISK_MANAGER's table into BUF (PAGE_SIZE bytes), tagged with USER_DATA.
+ * Returns false if DEPTH requests are already in flight
+ */
+bool async_io_read_page(AsyncIo *aio, DiskManager *disk_manager, page_id_t page_id, u8 *buf, u64 user_data);
+
+/*
+ * Queues a write of BUF (PAGE_SIZE bytes) to page PAGE_ID of DISK_MANAGER's table, tagged with USER_DATA.
+ * The page checksum is stamped into BUF right away (see page_checksum in disk_manager.h) and the write follows the disk
+ * manager's sync policy once it completes. Returns false if the queue is full
+ */
+bool async_io_write_page(AsyncIo *aio, DiskManager *disk_manager, page_id_t page_id, u8 *buf, u64 user_data);
+
+/*
+ * Submits all queued requests to the kernel and returns their number, without waiting for any of them
+ */
+u32 async_io_submit(AsyncIo *aio);
+
+/*
+ * Submits queued requests, waits until at least MIN_COMPLETE requests are done (0 doesn't wait) and writes up to
+ * MAX finished requests into OUT. Returns the number of completions written
+ */
+u32 async_io_complete(AsyncIo *aio, IoCompletion *out, u32 max, u32 min_complete);
+
+/*
+ * Waits for all requests in flight and frees the context. If waiting fails, the requests left are canceled instead
+ */
+void async_io_destroy(AsyncIo **aio);
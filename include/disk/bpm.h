@@ -1,50 +1,277 @@
 #pragma once
 
-#include "../utils/hash.h"
 #include "../utils/shared.h"
-#include "clock_replacer.h"
+#include "async_io.h"
 #include "disk_manager.h"
+#include "page_table.h"
+#include "replacer.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+// Whether the contents of a frame are in, see prefetch_bpm_pages and fetch_bpm_page
+enum PageIoState { PAGE_LOADED = 0, PAGE_LOADING, PAGE_READING, PAGE_LOAD_FAILED };
+
 typedef struct {
-    uint8_t data[PAGE_SIZE];
+    uint8_t *data; // PAGE_SIZE bytes of the frame inside the buffer pool's aligned frame arena
     page_id_t id;  // (p)id of page on disk (not frame)
+    u32 file_id;   // file the page belongs to among those sharing the buffer pool, see BufferPool
+    DiskManager *disk_manager; // disk manager of that file, which the page is read and written back through
     int pin_count; // number of threads using this bpm page
     bool is_dirty; // shows if the page has been modified after being read from
                    // disk
+    RWLOCK latch;  // protects the frame's data while the page is pinned, see page_guard.hpp
+    frame_id_t next_free; // frame below this free one on its shard's free frame stack, NO_FRAME at the bottom
+    PageIoState io_state; // PAGE_LOADING while a prefetch is reading the page into the frame, PAGE_READING while a
+                          // fetch is
 } BpmPage;
 
+typedef struct WriteBack WriteBack;
+
+/*
+ * Independent partition of a buffer pool. A shard caches the pages whose ids map to it (see BPM_SHARD) in its own
+ * range of frames, and its latch serializes everything done to those pages and frames. The range is reserved for as
+ * many frames as the shard can grow to (see resize_buffer_pool), only the first num_frames of which are in use
+ */
+typedef struct {
+    frame_id_t first_frame; // the shard's frames are [first_frame, first_frame + num_frames) of the buffer pool
+    size_t num_frames;
+    size_t capacity;        // frames reserved for the shard, [first_frame, first_frame + capacity)
+    PageTable page_table;   // map keys (see PAGE_KEY) of the pages in the shard to its frames
+    Replacer replacer;      // finding unpinned frames of the shard to replace
+    frame_id_t free_top;    // top of the stack of free frames linked through BpmPage.next_free, NO_FRAME if empty
+    size_t num_free;        // number of frames on the free frame stack
+    pthread_mutex_t latch;
+    pthread_cond_t io_cond; // broadcast when a read or write back done by a fetch without the latch completes
+    WriteBack *write_backs; // dirty victims fetches are writing back without the latch, see fetch_bpm_page
+    u64 write_back_seq;     // number of write backs queued so far
+} BpmShard;
+
+typedef struct BgWriter BgWriter;
+
+/*
+ * Frames caching the pages of any number of files (tables and indexes), so that memory goes to whichever file is used
+ * the most instead of being split up front. Files are attached to the pool with attach_bpm, which gives each disk
+ * manager a file id, and pages are keyed by their file id and page id (see PAGE_KEY). A page evicted from the pool is
+ * written back through the disk manager of its own file.
+ * Frames are reserved for max_pool_size frames, of which pool_size are in use: the address space of the frame arena
+ * is reserved up front, but the memory of a frame is only taken once a page is read into it, and given back to the
+ * system when the frame is retired by a shrink
+ */
 typedef struct {
-    size_t pool_size;       // number of frames in the buffer pool
-    BpmPage *pages;         // array of pages in the buffer pool
-    HashTable *page_table;  // map pages in the buffer pool to its frames
-    bool *free_list;        // array of frame statuses (true=free/false=taken)
-    ClockReplacer replacer; // finding unpinned frames to replace
+    size_t pool_size;     // number of frames in use
+    size_t max_pool_size; // number of frames reserved, which the pool can grow to
+    BpmPage *pages;       // array of the reserved frames' pages
+    bool *free_list;      // array of frame statuses (true=free or retired/false=taken), the free frames themselves are
+                          // on the shards' free frame stacks
+    uint8_t *frame_arena; // PAGE_SIZE aligned memory of all frames, so they can be targets of O_DIRECT transfers
+    BpmShard *shards;
+    u32 num_shards;
+    u64 checksum_failures; // pages read from disk whose checksum did not match their contents
+    u64 fetch_hits;        // fetches of pages that were already in the buffer pool
+    u64 fetch_misses;      // fetches that had to read their page from disk
+    u64 dirty_evictions;   // dirty victims a fetch or allocation had to write before it could reuse their frame
+    u64 prefetch_reads;    // pages prefetch_bpm_pages started reading
+    u64 prefetch_waits;    // fetches of prefetched pages that had to wait for their read to complete
+    u64 prefetch_failures; // prefetch reads that failed, as opposed to pages that arrived with a bad checksum
+    BgWriter *bg_writer;   // background writer thread, only present while started with set_bg_writer
+    DiskManager **files;   // disk manager of each file id given out so far, NULL for the ids of detached files
+    u32 *file_refs;        // number of buffer pool managers attached for each file id
+    u32 num_files;
+    u32 files_capacity;
+    pthread_mutex_t files_mutex; // serializes attaching files
+    AsyncIo *prefetch_io;  // reads started by prefetch_bpm_pages, created by the first prefetch
+    pthread_mutex_t prefetch_mutex; // serializes use of prefetch_io, taken before any shard latch
+    RWLOCK sync_latch; // held shared while pages written under shard latches are synced after releasing them, so that
+                       // detach_bpm can wait until no one uses the disk manager of the file it detaches
+} BufferPool;
+
+/*
+ * Access to the pages of a single file through a buffer pool, which may be shared with other files. Every function
+ * taking a BufferPoolManager works on the pages of its file, except for the background writer, which covers the
+ * whole pool
+ */
+typedef struct {
+    BufferPool *pool;
     DiskManager *disk_manager;
+    u32 file_id; // id of the file's pages in the pool
 } BufferPoolManager;
 
+typedef struct {
+    u64 pages_written;    // pages the background writer wrote since it was (last) started
+    double pages_per_sec; // its average write rate since then
+    u64 dirty_evictions;  // see BufferPoolManager
+    double clean_ratio;   // share of the buffer pool's frames that are free, or unpinned and clean
+} BgWriterStats;
+
+// Number of frames new_bulk_scan_strategy is usually asked for, enough for the readahead of a sequential scan
+#define BULK_SCAN_RING_FRAMES 32
+
+/*
+ * How a series of fetches uses the buffer pool (see fetch_bpm_page). A null strategy is normal access: pages read from
+ * disk take a free frame or the replacer's victim. A bulk scan strategy, for scans reading many more pages than other
+ * users of the pool keep using, recycles a small ring of frames instead, like PostgreSQL's buffer rings. Once the ring
+ * is full, a page read under the strategy replaces the one the ring read into the frame it got a lap before, provided
+ * that page is still there and unpinned, so the scan does not push the working set out of the pool. Pages that are
+ * already in the buffer pool are fetched as usual.
+ * A strategy belongs to a single scan, and is not to be used by several threads at once
+ */
+typedef struct {
+    u32 frames_per_shard; // the ring has as many frames in each shard, as pages only go to the frames of their shard
+    frame_id_t *frames;   // ring slots of shard 0, then those of shard 1 etc: frame taken for the ring, or NO_FRAME
+    page_key_t *pages;    // page the ring read into the frame of each slot
+    u32 *next;            // per shard, slot whose frame is recycled next
+} AccessStrategy;
+
+// Shard of buffer pool POOL caching page PID of file FILE_ID. Consecutive pages go to different shards, so that
+// concurrent scans spread over all
+#define BPM_SHARD(pool, file_id, pid) ((pool)->shards + ((pid) + (file_id)) % (pool)->num_shards)
+
+/*
+ * Initiates a buffer pool of POOL_SIZE frames split evenly into NUM_SHARDS shards (at most POOL_SIZE), which replace
+ * pages with POLICY, and returns a pointer to it, or a null pointer if memory for its frames could not be allocated.
+ * Files are attached to it with attach_bpm
+ */
+BufferPool *new_buffer_pool(size_t pool_size, u32 num_shards, ReplacerPolicy policy);
+
 /*
- * Initiates a new buffer pool manager for a specified disk manager and returns a pointer to it
+ * Initiates a buffer pool like new_buffer_pool, which resize_buffer_pool can grow up to MAX_POOL_SIZE frames (at least
+ * POOL_SIZE). A buffer pool from new_buffer_pool can only shrink, and grow back to its initial size
+ */
+BufferPool *new_resizable_buffer_pool(size_t pool_size, size_t max_pool_size, u32 num_shards, ReplacerPolicy policy);
+
+/*
+ * Grows or shrinks POOL to POOL_SIZE frames, split over its shards like the initial ones, while it keeps serving
+ * fetches, e.g. to give memory back to other processes on the machine and take it again later without losing the
+ * cached pages. Growing puts the shards' next reserved frames on their free frame stacks, never moving the frames in
+ * use. Shrinking retires the shards' last frames. Their unpinned pages move to the frames kept, which are free or hold
+ * pages the replacer would evict before them, or are evicted (written back if dirty) if they are the ones it would
+ * evict first, so the warmest pages stay cached. Pinned pages stay in their frames until their last unpin_page, and
+ * the memory of retired frames goes back to the system. The replacers start over with the pages still cached, in the
+ * order they would have evicted them.
+ * Returns false, leaving the pool as it is, if POOL_SIZE is below the number of shards or above max_pool_size
+ */
+bool resize_buffer_pool(BufferPool *pool, size_t pool_size);
+
+/*
+ * Returns a buffer pool manager for the pages of DISK_MANAGER's file in POOL, sharing the pool's frames with the other
+ * files attached to it. A disk manager attached again gets the file id it got the first time, so its pages are cached
+ * only once
+ */
+BufferPoolManager *attach_bpm(BufferPool *pool, DiskManager *disk_manager);
+
+/*
+ * Writes the dirty pages of BPM's file to disk and removes its pages from the buffer pool, so that the file can be
+ * closed while the pool keeps serving other files, then frees BPM and returns true. The file id is given back once the
+ * last buffer pool manager of the file is detached. Waits for the prefetch reads in flight first. Returns false,
+ * leaving the pool and BPM as they are, if a page of the file is pinned
+ */
+bool detach_bpm(BufferPoolManager *bpm);
+
+/*
+ * Frees POOL once every file was detached from it: waits for the prefetch reads in flight, stops the background writer
+ * and gives the frames' memory back. Pages still dirty are not written
+ */
+void free_buffer_pool(BufferPool *pool);
+
+/*
+ * Initiates a new buffer pool manager for a specified disk manager and returns a pointer to it, or a null pointer if
+ * memory for its frames could not be allocated. The buffer pool has a single shard and is not shared with other files,
+ * unless they are attached to bpm->pool
  */
 BufferPoolManager *new_bpm(size_t pool_size, DiskManager *disk_manager);
 
+/*
+ * Initiates a buffer pool manager whose POOL_SIZE frames are split evenly into NUM_SHARDS shards (at most POOL_SIZE),
+ * each with its own page table, replacer and latch, so that threads working on pages of different shards do not
+ * contend. A page can only be cached in the frames of its own shard. Returns a null pointer if memory for the frames
+ * could not be allocated
+ */
+BufferPoolManager *new_sharded_bpm(size_t pool_size, u32 num_shards, DiskManager *disk_manager);
+
+/*
+ * Initiates a buffer pool manager like new_sharded_bpm, whose shards replace pages with POLICY instead of the clock
+ */
+BufferPoolManager *new_bpm_with_policy(size_t pool_size, u32 num_shards, ReplacerPolicy policy,
+                                       DiskManager *disk_manager);
+
+/*
+ * Returns a bulk scan strategy (see AccessStrategy) for BPM whose ring has about RING_FRAMES frames, spread over the
+ * shards but at least one in each, or a null pointer if memory could not be allocated
+ */
+AccessStrategy *new_bulk_scan_strategy(BufferPoolManager *bpm, u32 ring_frames);
+
+/*
+ * Frees STRATEGY. The pages the ring read stay in the buffer pool, as victims for the replacers like any other page
+ */
+void free_access_strategy(AccessStrategy *strategy);
+
+/*
+ * Returns the frame page PAGE_ID is cached in, or NO_FRAME if it is not in the buffer pool
+ */
+frame_id_t find_frame(page_id_t page_id, BufferPoolManager *bpm);
+
 /**
  * Unpins page of provided id from the buffer pool and returns true. If the
  * page does not exist or it's pin count is already 0, returns false. Sets
- * page's dirty bit to value provided in is_dirty
+ * page's dirty bit if is_dirty is true, a dirty page stays dirty otherwise
  */
 bool unpin_page(page_id_t id, bool is_dirty, BufferPoolManager *bpm);
 
 /**
  * Flush provided page to disk, regardless of its dirty bit
- * Unsets the provided page's dirty bit afterwards
+ * Unsets the provided page's dirty bit afterwards, the page stays in the buffer pool
  * Returns false if the page could not be found in the page table, true
  * otherwise
+ * The page is written with its frame latched shared, so a WritePageGuard on it is waited for: the caller must not
+ * hold one
  */
 bool flush_page(page_id_t id, BufferPoolManager *bpm);
 
+/*
+ * Removes page ID from the buffer pool and frees its frame, writing the page to disk first if it is dirty.
+ * Returns false if the page is not in the buffer pool or still pinned, true otherwise
+ */
+bool evict_page(page_id_t id, BufferPoolManager *bpm);
+
+/*
+ * Writes every dirty page of BPM's file in the buffer pool to disk and unsets their dirty bits, then syncs the table
+ * file regardless of the disk manager's sync policy. Pages stay in the buffer pool. A page is written with its frame
+ * latched shared, so a page a WritePageGuard holds is waited for: the caller must not hold one on a page of the file
+ */
+void flush_all(BufferPoolManager *bpm);
+
+// Most pages a checkpoint writes while holding the shard latches, before letting fetches in again
+#define CHECKPOINT_BATCH_PAGES 64
+
+/*
+ * Writes the pages of BPM's file that are dirty when it is called to disk, then syncs the table file once, regardless
+ * of the disk manager's sync policy, and returns the number of pages written. Pages stay in the buffer pool, clean.
+ * Unlike flush_all, the dirty pages are only snapshotted up front, and written in page id order in batches of at most
+ * CHECKPOINT_BATCH_PAGES pages, consecutive pages with a single vectored write, the shards being latched for one batch
+ * at a time. A page evicted (so written back) or written by the background writer since the snapshot is skipped. Like
+ * with flush_all, pages are written with their frames latched shared, those a writer holds being waited for after the
+ * others of their batch, so the caller must not hold a WritePageGuard on a page of the file.
+ * A MAX_PAGES_PER_SEC above 0 paces the batches so that the checkpoint writes at most that many pages per second,
+ * spreading its I/O out instead of competing with foreground fetches for the disk
+ */
+size_t checkpoint(BufferPoolManager *bpm, u32 max_pages_per_sec);
+
+/*
+ * Starts (or restarts with new settings) a background thread writing dirty pages of the buffer pool of BPM, whatever
+ * their file, ahead of the replacers, so that victims are clean and fetches rarely have to write before they can read.
+ * Every INTERVAL_MS, and whenever a fetch had to evict a dirty page, it makes each shard have at least
+ * CLEAN_TARGET_PCT percent of its frames free or clean and unpinned, writing the unpinned dirty pages to be evicted
+ * first in page id order, consecutive pages of a file with a single vectored write. The sync policy of their files is
+ * applied once the shard's latch is released. A CLEAN_TARGET_PCT of 0 stops the writer
+ */
+void set_bg_writer(BufferPoolManager *bpm, u32 clean_target_pct, u32 interval_ms);
+
+/*
+ * Returns the background writer's write rate and how clean the buffer pool currently is
+ */
+BgWriterStats bg_writer_stats(BufferPoolManager *bpm);
+
 /*
  * Allocates a new page of suitable TYPE on disk, places it in buffer pool BPM and returns a pointer to it.
  * Writes a possible replacement frame back to disk if it contains a dirty page.
@@ -54,9 +281,33 @@ BpmPage *allocate_new_page(BufferPoolManager *bpm, PageType type);
 /*
  * Returns the requested page from the buffer pool, or returns a null pointer if
  * page needs to be fetched from disk but no frames are available or evictable.
- * Writes a possible replacement frame back to disk if it contains a dirty page
+ * A page prefetch_bpm_pages is still reading is waited for, a prefetched page that already arrived is a plain hit. A
+ * null pointer is returned if its read failed, or waiting for it did.
+ * A page is read from disk, and a dirty victim written back, without the shard latched, so that hits on the shard do
+ * not wait for the I/O: the frame is published before the page's contents are in, and fetches of it wait for them.
+ * A page read from disk goes to a frame of STRATEGY's ring if there is one to recycle, see AccessStrategy, or to a
+ * free or evicted frame if STRATEGY is a null pointer or there is not.
+ * Writes a possible replacement frame back to disk if it contains a dirty page.
+ * Pages read from disk have their checksum verified: a corrupted (e.g. torn) page is not cached, counted in
+ * checksum_failures and a null pointer is returned instead
+ */
+BpmPage *fetch_bpm_page(page_id_t page_id, BufferPoolManager *bpm, AccessStrategy *strategy);
+
+// Most page reads prefetch_bpm_pages keeps in flight for a buffer pool
+#define PREFETCH_DEPTH 64
+
+/*
+ * Starts reading those of the N pages PIDS of BPM's file that are not in the buffer pool into frames, and returns
+ * without waiting for them, so that the caller can do useful work meanwhile, e.g. a batched lookup prefetching all the
+ * children it will visit of a B+tree level, or a range scan prefetching the next leaf. The caller pins nothing: the
+ * prefetch holds a pin of its own on each page until its read completes, and a fetch_bpm_page of the page only waits
+ * if the read is still in flight by then. A page whose read fails is counted in prefetch_failures, one with a bad
+ * checksum in checksum_failures, and either is dropped, the fetch then returning a null pointer like for a page it
+ * read itself.
+ * Stops early when PREFETCH_DEPTH reads are in flight or no frame can be taken without evicting a pinned page.
+ * Returns the number of reads started
  */
-BpmPage *fetch_bpm_page(page_id_t page_id, BufferPoolManager *bpm);
+u32 prefetch_bpm_pages(const page_id_t *pids, u32 n, BufferPoolManager *bpm);
 
 /*
  * Writes provided data to a page contained in the provided frame id and marks it as dirty.
@@ -1,22 +1,36 @@
 #pragma once
 
-#include "../utils/circular_list.h"
-#include "../utils/hash.h"
 #include "../utils/shared.h"
 
+// Bits of ClockReplacer.frames
+#define CLOCK_EVICTABLE 1  // the frame is unpinned, so it may be evicted
+#define CLOCK_REFERENCED 2 // reference bit: the frame was used since the hand last passed it
+
 typedef struct {
+    frame_id_t first_frame; // the replacer tracks frames [first_frame, first_frame + num_pages)
     size_t num_pages;       // max number of pages ClockReplacer is required to store
-    CircularList *frames;   // frames tracked by ClockReplacer
-    HashTable *frame_table; // to map each frame to its reference bit
-    CircularListNode *hand; // current position of the clock hand
+    u8 *frames;             // CLOCK_* bits of each tracked frame
+    size_t size;            // number of evictable frames
+    size_t hand;            // current position of the clock hand, an index into frames
     RWLOCK latch;
 } ClockReplacer;
 
 /**
- * Initializes and returns a clock replacer of the specified capacity
+ * Initializes and returns a clock replacer of the specified capacity, tracking frames 0 to capacity - 1
  */
 ClockReplacer *clock_replacer_init(size_t capacity);
 
+/*
+ * Initializes REPLACER in place to track the CAPACITY frames starting at FIRST_FRAME, e.g. those of a buffer pool shard.
+ * Returns false if memory for the frames could not be allocated
+ */
+bool clock_replacer_init_frames(ClockReplacer *replacer, frame_id_t first_frame, size_t capacity);
+
+/*
+ * Frees the memory of the frames of REPLACER, initialized with clock_replacer_init_frames
+ */
+void clock_replacer_destroy(ClockReplacer *replacer);
+
 /**
  * Removes and returns the frame(id) closest to the clock hand that is both in
  * the ClockReplacer and with its ref flag set to false. If its ref flag is set
@@ -32,11 +46,18 @@ frame_id_t evict(ClockReplacer *replacer);
 void clock_replacer_pin(frame_id_t *frame_id, ClockReplacer *replacer);
 
 /**
- * Unpins a frame of specified id, which makes it evictable
+ * Unpins a frame of specified id, which makes it evictable. Unpinning a frame that is already evictable sets its ref
+ * flag again
  */
 void clock_replacer_unpin(frame_id_t *frame_id, ClockReplacer *replacer);
 
+/*
+ * Stores up to MAX frames of the replacer into OUT in the order the clock hand will reach them, starting with the one
+ * under the hand, and returns how many were stored. Reference bits and the hand are left as they are
+ */
+size_t clock_replacer_frames_ahead(ClockReplacer *replacer, frame_id_t *out, size_t max);
+
 /**
  * Returns the number of frames currently in the ClockReplacer
  */
-size_t size();
+size_t clock_replacer_size(ClockReplacer *replacer);
@@ -3,41 +3,245 @@
 #include "../utils/hash.h"
 #include "../utils/shared.h"
 #include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 #define PAGE_SIZE 4096
-#define MAX_PAGES 500 // max number of pages in a file
 #define DBFILES_DIR "db_files"
+#define IS_PAGE_ALIGNED(ptr) (((uintptr_t)(ptr) & (PAGE_SIZE - 1)) == 0)
+
+/*
+ * When written pages are made durable:
+ * SYNC_ALWAYS - fsync after every write (default)
+ * SYNC_PERIODIC - fdatasync from a background thread every sync_interval_ms, if anything was written since the last one
+ * SYNC_ON_CHECKPOINT - only on explicit sync_table_file calls (e.g. through flush_all of the buffer pool)
+ */
+enum SyncPolicy { SYNC_ALWAYS = 0, SYNC_PERIODIC = 1, SYNC_ON_CHECKPOINT = 2 };
+
+/*
+ * Tables are stored in segment files of TABLE_SEGMENT_PAGES pages (1GiB) each, so that they can grow past the file
+ * sizes some filesystems and tools handle well. Page PAGE_ID lives in segment PAGE_SEGMENT(PAGE_ID) at byte offset
+ * PAGE_SEGMENT_OFFSET(PAGE_ID). Segment 0 is db_files/<name>.db and segment N is db_files/<name>.db.N. Segments past
+ * the first are opened (and created) on first access, so a table below 1GiB is a single file just like before.
+ * Every segment is preallocated, synced and fadvised through its own descriptor
+ */
+#define TABLE_SEGMENT_PAGES (1u << 18)
+#define MAX_TABLE_SEGMENTS (u32)(((u64)UINT32_MAX + 1) / TABLE_SEGMENT_PAGES) // enough for every page id
+#define PAGE_SEGMENT(pid) ((pid) / TABLE_SEGMENT_PAGES)
+#define PAGE_SEGMENT_OFFSET(pid) ((off_t)((pid) % TABLE_SEGMENT_PAGES) * PAGE_SIZE)
+
+typedef struct {
+    int fd;        // descriptor of the segment file shared through the descriptor registry, -1 if not opened yet
+    int direct_fd; // O_DIRECT descriptor of the segment file owned by the disk manager, -1 if not opened
+} Segment;
+
+/*
+ * Sequential read detection. Once READAHEAD_TRIGGER pages have been read in increasing page id order without gaps, the
+ * OS is asked (posix_fadvise WILLNEED) to start reading the pages ahead of the reader in the background, in windows
+ * growing from READAHEAD_MIN_PAGES up to the disk manager's readahead_max_pages. Runs longer than READAHEAD_SCAN_PAGES
+ * are treated as full scans and switch the table file to POSIX_FADV_SEQUENTIAL (a larger kernel readahead) until the
+ * run breaks. Hints only apply to buffered reads, pages read with direct I/O bypass the page cache they would fill
+ */
+#define READAHEAD_TRIGGER 4
+#define READAHEAD_MIN_PAGES 8
+#define READAHEAD_MAX_PAGES 256
+#define READAHEAD_SCAN_PAGES 1024
 
 typedef struct {
-    HashTable *page_directory; // table's page directory in memory representation, for saving some file seek expenses
+    pthread_mutex_t mutex;
+    page_id_t next_pid;   // page id read next if the access pattern is sequential
+    u32 run_length;       // number of pages read in increasing order without gaps so far
+    page_id_t window_end; // first page past the ones already hinted to the OS
+    u32 window;           // number of pages the next hint covers
+    bool sequential;      // table file is advised POSIX_FADV_SEQUENTIAL
+} ReadAhead;
+
+typedef struct SyncWorker SyncWorker;
+typedef struct PageDirectory PageDirectory;
+
+typedef struct {
+    PageDirectory *page_directory; // heap table's page directory in memory representation (see page_directory.h)
+    u8 *schema_page;               // cached copy of a heap table's schema page, null if not loaded
     PageType page_type;        // (usually optional) type of page present in a file handled by disk manager instance.
     char *table_name;
+    int fd; // descriptor of the table file (segment 0), opened once and shared by all disk managers of the same table
+    Segment *segments;              // segments past the first (index 0 is segment 1), allocated on first access
+    u32 num_segments;               // one more than the highest segment opened so far
+    pthread_mutex_t segments_mutex; // serializes opening segments
+    SyncPolicy sync_policy;
+    u32 sync_interval_ms;
+    bool has_unsynced_writes; // set by writes not yet followed by a sync
+    SyncWorker *sync_worker;  // background syncing thread, only present with SYNC_PERIODIC
+    bool direct_io;           // page transfers bypass the OS page cache through direct_fd
+    int direct_fd;            // O_DIRECT descriptor of segment 0 owned by this disk manager, -1 if not opened
+    u32 readahead_max_pages;  // largest readahead window in pages, 0 disables sequential read detection
+    ReadAhead readahead;
     RWLOCK latch;
 } DiskManager;
 
 /*
- * Returns a file descriptor of a database file of given TABLE_NAME
+ * Opens (creating it if necessary) a database file of given TABLE_NAME and returns a new file descriptor for it.
+ * Prefer acquire_table_fd, which shares a single descriptor per table across the process
  */
 int table_file(const char *table_name);
 
 /*
- * Writes raw DATA to the offset of PAGE_ID to a database table file of DISK_MANAGER's table
+ * Returns true if a database file of given TABLE_NAME exists, without creating it
+ */
+bool table_exists(const char *table_name);
+
+/*
+ * Returns the process-wide file descriptor of TABLE_NAME's database file, opening it on first use.
+ * Each call takes a reference that must be given back with release_table_fd
+ */
+int acquire_table_fd(const char *table_name);
+
+/*
+ * Same as acquire_table_fd, for segment SEGMENT of TABLE_NAME (see TABLE_SEGMENT_PAGES). The segment file is only
+ * created with CREATE, otherwise -1 is returned if it doesn't exist
+ */
+int acquire_segment_fd(const char *table_name, u32 segment, bool create);
+
+/*
+ * Returns the number of pages DISK_MANAGER's table files have room for, counting all segments up to the last existing
+ * one. Returns 0 if the size can not be determined
+ */
+u64 table_num_pages(DiskManager *disk_manager);
+
+/*
+ * Allocates file space for pages [FIRST_PAGE_ID, FIRST_PAGE_ID + COUNT) in their segment files with fallocate, falling
+ * back to growing the files with ftruncate where fallocate is not supported. This is the only call creating segment
+ * files past the first, reads and writes of pages in a missing segment fail. Returns false if space could not be
+ * allocated
+ */
+bool allocate_table_pages(DiskManager *disk_manager, page_id_t first_page_id, u32 count);
+
+/*
+ * Drops a reference to a shared file descriptor FD, closing it once no disk manager uses it anymore
+ */
+void release_table_fd(int fd);
+
+/*
+ * Allocates a disk manager for TABLE_NAME with the table file opened through the shared descriptor registry.
+ * Does not write anything to the file
+ */
+DiskManager *new_disk_manager(const char *table_name);
+
+/*
+ * Enables or disables O_DIRECT page transfers for DISK_MANAGER, so that pages are cached only once (e.g. in the buffer
+ * pool) instead of also in the OS page cache. Returns whether direct I/O is active afterwards, which is false if the
+ * filesystem does not support it (e.g. tmpfs), in which case buffered I/O keeps being used.
+ * Buffers that are not PAGE_SIZE aligned still work, but cost an extra copy. Writes smaller than a page (write_bytes)
+ * always stay buffered
+ */
+bool set_direct_io(DiskManager *disk_manager, bool enable);
+
+/*
+ * Returns the descriptor a page-sized transfer of BUF to or from PAGE_ID should use and stores the page's offset in
+ * that file in OFFSET. That is the O_DIRECT descriptor of the page's segment if direct I/O is enabled and BUF is
+ * PAGE_SIZE aligned, the buffered one otherwise. Returns -1 if the segment file can not be opened
+ */
+int page_fd(DiskManager *disk_manager, page_id_t page_id, const void *buf, off_t *offset);
+
+/*
+ * Page checksums. Heap and B+tree pages carry a CRC-32C of their contents in their header (see heapfile.h and
+ * index_page.hpp), computed as if the checksum field itself was zero. The disk manager stamps it into every page it
+ * writes, so code building pages never has to maintain it. System pages (page directories, the table schema page and
+ * the B+tree metadata page) and pages of files without a page type have no checksum.
+ *
+ * Returns the byte offset of the checksum field of PAGE_ID in a file of PAGE_TYPE, or -1 if the page has none
+ */
+#define PAGE_CHECKSUM_SIZE 4
+int page_checksum_offset(PageType page_type, page_id_t page_id);
+
+/*
+ * Returns the checksum of PAGE with the checksum field at CHECKSUM_OFFSET taken as zero
+ */
+u32 page_checksum(const u8 *page, u16 checksum_offset);
+
+/*
+ * Stores the checksum of PAGE (page PAGE_ID of DISK_MANAGER's file) in its header, if the page has a checksum field
+ */
+void set_page_checksum(DiskManager *disk_manager, page_id_t page_id, u8 *page);
+
+/*
+ * Returns false if PAGE (page PAGE_ID of DISK_MANAGER's file) has a checksum field that does not match its contents.
+ * Pages without a checksum field and pages that were never written (all zeroes) always pass
+ */
+bool verify_page_checksum(DiskManager *disk_manager, page_id_t page_id, const u8 *page);
+
+/*
+ * Writes raw DATA to the offset of PAGE_ID to a database table file of DISK_MANAGER's table, stamping its checksum
  */
 void write_page(page_id_t page_id, DiskManager *disk_manager, void *data);
 
+/*
+ * Writes SIZE raw bytes of DATA at byte OFFSET of DISK_MANAGER's table (as if all segments were a single file), which
+ * must not span pages. Used for updates smaller than a page of pages without a checksum, since the checksum of the
+ * page is not updated
+ */
+void write_bytes(off_t offset, DiskManager *disk_manager, const void *data, size_t size);
+
+/*
+ * Writes COUNT consecutive pages starting at FIRST_PAGE_ID from the PAGE_SIZE buffers of IOVECS (one per page) with as
+ * few pwritev calls as possible, stamping their checksums. The sync policy is applied once for the whole run
+ */
+void write_pages(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs);
+
+/*
+ * Same as write_pages without applying the sync policy, for callers writing many runs in a row, e.g. with latches held,
+ * which then apply it with apply_sync_policy or sync the whole table with sync_table_file
+ */
+void write_pages_nosync(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs);
+
+/*
+ * Sets the policy for making DISK_MANAGER's writes durable, starting or stopping the background syncing thread as
+ * needed. INTERVAL_MS is only used by SYNC_PERIODIC
+ */
+void set_sync_policy(DiskManager *disk_manager, SyncPolicy policy, u32 interval_ms);
+
+/*
+ * Makes a write of COUNT pages starting at FIRST_PAGE_ID that just finished durable according to DISK_MANAGER's sync
+ * policy (for writes done outside of write_page, e.g. asynchronously), syncing only the segments holding those pages.
+ * Returns -1 if syncing failed
+ */
+int apply_sync_policy(DiskManager *disk_manager, page_id_t first_page_id, u32 count);
+
+/*
+ * Flushes all writes of DISK_MANAGER's table files (every opened segment) to the device, regardless of the sync policy
+ */
+void sync_table_file(DiskManager *disk_manager);
+
 /*
  * Reads serialized contents of the page of specified page_id of a table inside disk_manager into
- * memory and returns a pointer to its beginning.
+ * memory and returns a pointer to its beginning, which the caller has to free.
  * Serialization policy can be found in seriailze.h
  */
 uint8_t *read_page(page_id_t page_id, DiskManager *disk_manager);
 
 /*
- * Currently only used for testing. It just removes the database file of the particular table
+ * Same as read_page, but reads the page into BUF (at least PAGE_SIZE bytes, e.g. a buffer pool frame) instead of
+ * allocating memory for it
+ */
+void read_page_into(page_id_t page_id, DiskManager *disk_manager, uint8_t *buf);
+
+/*
+ * Reads COUNT consecutive pages starting at FIRST_PAGE_ID into the PAGE_SIZE buffers of IOVECS (one per page) with as
+ * few preadv calls as possible. Returns the number of whole pages read, which is less than COUNT if the run goes past
+ * the end of the file
+ */
+u32 read_pages(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs);
+
+/*
+ * Currently only used for testing. It just removes the database files (all segments) of the particular table
  */
 void remove_table(const char *table_name);
 
-void close_table_file(char *table_name);
+/*
+ * Syncs outstanding writes, stops the background syncing thread, frees the cached page directory and schema and
+ * releases DISK_MANAGER's reference to the table file. The disk manager can not be used for I/O afterwards
+ */
+void close_table_file(DiskManager *disk_manager);
 
 /* See comment in source file about these btree methods */
 page_id_t new_btree_index_page(DiskManager *disk_manager, bool is_leaf);
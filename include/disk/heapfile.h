@@ -28,7 +28,6 @@
 #define TUPLE_INDEX_TO_TUPLE_POINTER_OFFSET(idx) PAGE_HEADER_SIZE + (idx * TUPLE_PTR_SIZE)
 #define PAGE_NO_HEADER(page) page + sizeof(Header) // Pointer to the page memory after it's header
 #define PAGE_HEADER(page) (Header *)page           // Pointer to the start of page header
-#define PID_TO_PAGE_DIRECTORY_OFFSET(pid) pid * 2
 #define SCHEMA_COLUMN_SIZE(col_name_len)                                                                               \
     (1 + col_name_len + 1) // column_name_length + column_name_string + column_data_type
 
@@ -37,6 +36,7 @@ typedef struct {
     uint16_t free_start; // offset to beginning of available page memory
     uint16_t free_end;   // offset to end of available page memory
     uint8_t flags;
+    uint32_t checksum; // as of the last time the page was written, see page_checksum in disk_manager.h
 } Header;
 
 typedef struct {
@@ -49,8 +49,6 @@ typedef struct {
     uint16_t length; // number of tuple pointers in a page
 } TuplePtrList;
 
-enum TupleAction { TUPLE_ADD = 1, TUPLE_REMOVE = 2 };
-
 typedef union {
     u8 boolean;
     i32 integer;
@@ -82,13 +80,15 @@ typedef struct {
  *  -16 bit unsigned integer containing page offset to the beginning of available space
  *  -16 bit unsigned integer containing page offset to the end of available space
  *  -8 bit unsigned integer containing special page header flags
+ *  -32 bit unsigned integer containing the CRC-32C checksum of the page, stamped by the disk manager on every write
  * 2.Tuple pointer list consisting of 32 bit pairs (2x16) of the following layout:
  *  -16 bit unsigned integer representing the page offset to the corresponding tuple
  *  -16 bit unsigned integer representing the tuple size
  * 3.Tuple list containing stored data
  * All data is serialized as described in serialize.h
  */
-#define PAGE_HEADER_SIZE 5
+#define PAGE_HEADER_SIZE 9
+#define PAGE_CHECKSUM_OFFSET 5
 #define TUPLE_PTR_SIZE 4
 page_id_t new_heap_page(DiskManager *disk_manager);
 
@@ -97,8 +97,8 @@ page_id_t new_heap_page(DiskManager *disk_manager);
  * Returns a newly created disk manager instance through which all table changes are made
  *
  * Table database file header consists of multiple metadata pages:
- *  1."page directory" page of the following layout:
- *   -32 bit (2x16) pairs consisting of page id and free space of the page
+ *  1.first "page directory" page, which is followed by another one every DIR_GROUP_PAGES pages (see page_directory.h):
+ *   -max-tree of the 8 bit free space buckets of the pages in the group
  *  2.table columns metadata page of the following layout:
  *   -first byte in the paae represents the number of columns in the table
  *   -triplets of data (column_name_length (8bit uint), column_name_string (variable string), column_data_type (8bit
@@ -106,6 +106,17 @@ page_id_t new_heap_page(DiskManager *disk_manager);
  */
 DiskManager *create_table(const char *table_name, Column *columns, uint8_t n_columns);
 
+/*
+ * Opens an existing table of TABLE_NAME created with create_table. The page directory and the schema page are read
+ * with a single read for tables smaller than DIR_GROUP_PAGES pages (one more read per further directory page) and kept
+ * in memory until close_table_file. Returns a null pointer if the table does not exist or is not a heap table, which
+ * is told by its first pages: a B+tree index's metadata page, or a schema page without a valid first column.
+ *
+ * Only one disk manager per table should modify it at a time within a process, since the page directory is not shared
+ * between disk manager instances
+ */
+DiskManager *open_table(const char *table_name);
+
 /*
  * Takes in page bytes and returns a constructed header of the page
  */
@@ -114,9 +125,10 @@ Header extract_header(uint8_t *page, page_id_t page_id);
 /*
  * Returns a pointer to the beginning of raw tuple data with the given RECORD_ID
  * or a null pointer if the tuple does not exist in the page id provided in RID.
- * Record is searched for in the table found inside DISK_MANAGER
+ * Record is searched for in the table found inside DISK_MANAGER. The page is read into PAGE (PAGE_SIZE bytes),
+ * which the returned pointer points into
  */
-uint8_t *get_tuple(RID rid, DiskManager *disk_manager);
+uint8_t *get_tuple(RID rid, DiskManager *disk_manager, uint8_t *page);
 
 /*
  * Marks tuple of the table find in disk_manager of the specified record id as removed.
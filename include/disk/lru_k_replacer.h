@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../utils/shared.h"
+
+#define LRU_K_DEFAULT_K 2
+// References to a frame at most this many references (of any frame) after its previous one are correlated with it,
+// e.g. the repeated fetches of a node by a single tree operation, and count as a single reference
+#define LRU_K_DEFAULT_CORRELATED_PERIOD 4
+
+// Bits of LruKReplacer.flags
+#define LRU_K_RESIDENT 1  // the frame holds a page, whose references are tracked
+#define LRU_K_EVICTABLE 2 // the frame is unpinned, so it may be evicted
+#define LRU_K_YOUNG 4     // the evictable frame is still within the correlated period of its last reference
+
+/*
+ * LRU-K replacement (O'Neil et al.): evicts the frame whose K-th most recent uncorrelated reference is the oldest,
+ * frames referenced fewer than K times first (in LRU order). A page touched once by a scan is therefore evicted before
+ * pages used over and over, like the inner nodes of a B+tree. Frames referenced within the correlated reference period
+ * are not evicted while others can be. Time is logical: the number of references made so far.
+ * The reference history of a page is dropped when it leaves its frame.
+ * Evictable frames past the correlated period are kept in a binary heap ordered like they are evicted, so evicting
+ * takes O(log n). Those within it (at most correlated_period frames, as a reference only touches one) wait in a list
+ * until they are past it, which each eviction checks
+ */
+typedef struct {
+    frame_id_t first_frame; // the replacer tracks frames [first_frame, first_frame + num_pages)
+    size_t num_pages;
+    u32 k;
+    u64 correlated_period;
+    u64 *history;     // k most recent uncorrelated reference times of each frame, most recent first, 0 if fewer
+    u64 *last_access; // time of each frame's most recent reference, correlated or not
+    u8 *flags;        // LRU_K_* bits of each frame
+    u32 *heap;        // evictable frames (indexes from first_frame) past the correlated period, by eviction order
+    size_t heap_size;
+    u32 *young;       // evictable frames within the correlated period, see LRU_K_YOUNG
+    size_t num_young;
+    u32 *pos;         // position of each evictable frame in heap or young
+    u32 *ahead;       // heap positions lru_k_replacer_frames_ahead is yet to visit, a min-heap as well
+    size_t size;      // number of evictable frames
+    u64 now;          // logical time
+    RWLOCK latch;
+} LruKReplacer;
+
+/*
+ * Initializes REPLACER in place to track the CAPACITY frames starting at FIRST_FRAME, keeping the K most recent
+ * references of each with CORRELATED_PERIOD (see LRU_K_DEFAULT_CORRELATED_PERIOD). Returns false if memory for the
+ * frames could not be allocated
+ */
+bool lru_k_replacer_init(LruKReplacer *replacer, frame_id_t first_frame, size_t capacity, u32 k, u64 correlated_period);
+
+/*
+ * Frees the memory of the frames of REPLACER and destroys its latch
+ */
+void lru_k_replacer_destroy(LruKReplacer *replacer);
+
+/*
+ * Records a reference to the page in frame FRAME_ID and makes the frame not evictable until unpinned. A frame pinned
+ * for the first time since it was evicted or removed starts a new history
+ */
+void lru_k_replacer_pin(LruKReplacer *replacer, frame_id_t frame_id);
+
+/*
+ * Makes frame FRAME_ID evictable
+ */
+void lru_k_replacer_unpin(LruKReplacer *replacer, frame_id_t frame_id);
+
+/*
+ * Removes and returns the evictable frame with the largest backward K-distance, or UINT32_MAX if there is none
+ */
+frame_id_t lru_k_replacer_evict(LruKReplacer *replacer);
+
+/*
+ * Forgets frame FRAME_ID and its history, e.g. when its page left the buffer pool without being evicted
+ */
+void lru_k_replacer_remove(LruKReplacer *replacer, frame_id_t frame_id);
+
+/*
+ * Stores up to MAX evictable frames into OUT in the order they would be evicted and returns how many were stored
+ */
+size_t lru_k_replacer_frames_ahead(LruKReplacer *replacer, frame_id_t *out, size_t max);
+
+/*
+ * Returns the number of evictable frames
+ */
+size_t lru_k_replacer_size(LruKReplacer *replacer);
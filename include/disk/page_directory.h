@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../utils/shared.h"
+#include "disk_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Page directory of a heap table, a free space map (FSM) keeping track of how much space each of its pages has left.
+ *
+ * Free space is tracked in 8 bit buckets of FSM_BUCKET_BYTES bytes (see FSM_BUCKET). On disk the map is spread over
+ * directory pages placed at a fixed interval: every DIR_GROUP_PAGES-th page (starting with page 0) is a directory page
+ * covering the pages of its group, itself included. A directory page is a complete binary max-tree laid out as an
+ * implicit heap: node i has children 2i and 2i+1, byte 1 is the root and bytes DIR_GROUP_PAGES..PAGE_SIZE-1 are the
+ * leaves, i.e. the buckets of the group's pages in order. Every inner node holds the largest bucket below it, and a
+ * small in memory max-tree over the groups' roots ties the directory pages together.
+ *
+ * Finding a page with enough free space walks down both trees, O(log pages). Finding the directory entry of any page
+ * is a constant time computation, and the directory grows together with the table without a size limit or any
+ * reorganization. The table file is grown in extents of TABLE_EXTENT_PAGES pages (preallocated with fallocate where
+ * supported)
+ */
+#define DIR_GROUP_PAGES (PAGE_SIZE / 2)
+#define TABLE_EXTENT_PAGES 64
+#define IS_DIRECTORY_PAGE(pid) ((pid) % DIR_GROUP_PAGES == 0)
+#define PID_TO_DIRECTORY_PAGE(pid) ((pid) - (pid) % DIR_GROUP_PAGES)
+#define PAGE_UNUSED PAGE_SIZE // free space of an allocated page that holds no tuples
+
+#define FSM_BUCKET_BYTES (PAGE_SIZE / 256)
+#define FSM_UNUSED 255 // bucket of unused pages, kept apart so that they can be told from formatted empty pages
+#define FSM_MAX_USED_BUCKET (FSM_UNUSED - 1)
+// Largest bucket guaranteeing at most FREE_SPACE free bytes
+#define FSM_BUCKET(free_space)                                                                                         \
+    ((free_space) == PAGE_UNUSED ? FSM_UNUSED                                                                          \
+                                 : ((free_space) / FSM_BUCKET_BYTES > FSM_MAX_USED_BUCKET                              \
+                                        ? FSM_MAX_USED_BUCKET                                                          \
+                                        : (free_space) / FSM_BUCKET_BYTES))
+// Smallest bucket guaranteeing at least SIZE free bytes
+#define FSM_NEEDED_BUCKET(size)                                                                                        \
+    ((size) > FSM_MAX_USED_BUCKET * FSM_BUCKET_BYTES ? FSM_UNUSED : ((size) + FSM_BUCKET_BYTES - 1) / FSM_BUCKET_BYTES)
+
+struct PageDirectory {
+    u8 **groups;          // in memory copies of the directory pages, one PAGE_SIZE aligned max-tree per group
+    u32 num_groups;
+    u8 *group_tree;       // max-tree over the groups' roots, with leaves starting at index group_capacity
+    u32 group_capacity;   // number of groups group_tree and groups have room for (a power of two)
+    u32 num_pages;        // number of pages the table's segment files currently have space for
+};
+
+/*
+ * Sets up the page directory of a new, empty table of DISK_MANAGER: allocates the first extent of the table file and
+ * writes out the first directory page. The first NUM_SYSTEM_PAGES pages (directory page 0 included) are reserved and
+ * never handed out by find_free_page. Returns a null pointer if the file could not be grown
+ */
+PageDirectory *init_page_directory(DiskManager *disk_manager, u32 num_system_pages);
+
+/*
+ * Loads the page directory of an existing table of DISK_MANAGER, sized after the table file. FIRST_DIRECTORY_PAGE is
+ * the already read content of page 0, so that a table with less than DIR_GROUP_PAGES pages is loaded without any I/O.
+ * Directory pages of further groups are read from disk. Returns a null pointer if the file size can not be determined
+ */
+PageDirectory *load_page_directory(DiskManager *disk_manager, const u8 *first_directory_page);
+
+/*
+ * Grows DISK_MANAGER's table file by an extent, marking its pages as unused (apart from directory pages) in memory and
+ * on disk. Returns false if the file could not be grown
+ */
+bool extend_table(DiskManager *disk_manager);
+
+/*
+ * Finds the first page with at least SIZE_NEEDED free bytes, growing the table if no page has enough space, and stores
+ * it in PAGE_ID. Only pages without any tuples qualify for PAGE_UNUSED. Returns false only if SIZE_NEEDED is larger
+ * than a page or the table can not be grown
+ */
+bool find_free_page(DiskManager *disk_manager, u16 size_needed, page_id_t *page_id);
+
+/*
+ * Sets the free space of PAGE_ID to FREE_SPACE bytes in memory and in its directory page on disk
+ */
+void set_page_free_space(DiskManager *disk_manager, page_id_t page_id, u16 free_space);
+
+/*
+ * Returns the free space bucket PAGE_ID is tracked with
+ */
+u8 page_free_bucket(PageDirectory *page_directory, page_id_t page_id);
+
+/*
+ * Frees the in memory page directory and sets the pointer to null
+ */
+void free_page_directory(PageDirectory **page_directory);
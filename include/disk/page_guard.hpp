@@ -0,0 +1,84 @@
+/*
+ * RAII access to pages of a buffer pool. A guard holds a pin on its page and the page's frame latch, shared for
+ * ReadPageGuard and exclusive for WritePageGuard, and gives both back when it is destroyed or released. Pages written
+ * through a WritePageGuard are marked dirty.
+ *
+ * Guards are move-only. Moving a guard into another one releases the page the target was guarding, after the new page
+ * is latched, so walking down a tree with `guard = fetchRead(bpm, child_pid)` latch-couples parent and child
+ */
+#pragma once
+#include "../utils/shared.h"
+#include "bpm.h"
+
+namespace somedb {
+
+class PageGuard {
+  public:
+    PageGuard(const PageGuard &) = delete;
+    PageGuard &operator=(const PageGuard &) = delete;
+
+    // False for guards that were moved from, released, or could not get their page (no frame available)
+    explicit operator bool() const { return page != nullptr; }
+
+    page_id_t pid() const { return page->id; }
+
+  protected:
+    PageGuard() = default;
+    PageGuard(BufferPoolManager *bpm, BpmPage *page) : bpm(bpm), page(page) {}
+    PageGuard(PageGuard &&other) noexcept : bpm(other.bpm), page(other.page) { other.page = nullptr; }
+    ~PageGuard() = default;
+
+    // Unlatches and unpins the page, marking it dirty with IS_DIRTY
+    void drop(bool is_dirty);
+
+    BufferPoolManager *bpm = nullptr;
+    BpmPage *page = nullptr;
+};
+
+class ReadPageGuard : public PageGuard {
+  public:
+    ReadPageGuard() = default;
+    ReadPageGuard(ReadPageGuard &&other) noexcept = default;
+    ReadPageGuard &operator=(ReadPageGuard &&other) noexcept;
+    ~ReadPageGuard() { release(); }
+
+    const u8 *data() const { return page->data; }
+
+    // Gives the page back before the guard goes out of scope
+    void release() { drop(false); }
+
+  private:
+    friend ReadPageGuard fetchRead(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy);
+    ReadPageGuard(BufferPoolManager *bpm, BpmPage *page);
+};
+
+class WritePageGuard : public PageGuard {
+  public:
+    WritePageGuard() = default;
+    WritePageGuard(WritePageGuard &&other) noexcept = default;
+    WritePageGuard &operator=(WritePageGuard &&other) noexcept;
+    ~WritePageGuard() { release(); }
+
+    u8 *data() const { return page->data; }
+
+    // Gives the page back, marked dirty, before the guard goes out of scope
+    void release() { drop(true); }
+
+  private:
+    friend WritePageGuard fetchWrite(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy);
+    friend WritePageGuard newPage(BufferPoolManager *bpm, PageType type);
+    WritePageGuard(BufferPoolManager *bpm, BpmPage *page);
+};
+
+// Fetches page PAGE_ID into BPM under STRATEGY (see fetch_bpm_page) and latches it for reading. The guard is empty if no
+// frame was available
+ReadPageGuard fetchRead(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy = nullptr);
+
+// Fetches page PAGE_ID into BPM under STRATEGY (see fetch_bpm_page) and latches it for writing. The guard is empty if
+// no frame was available
+WritePageGuard fetchWrite(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy = nullptr);
+
+// Allocates a new page of TYPE (see allocate_new_page) and latches it for writing
+WritePageGuard newPage(BufferPoolManager *bpm, PageType type);
+
+} // namespace somedb
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../utils/shared.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NO_FRAME UINT32_MAX // frame id of empty page table slots, and returned for pages that are not in the table
+
+// Identifies a page among those of all files sharing a buffer pool: the file's id (see BufferPool) and the page's id
+typedef u64 page_key_t;
+#define PAGE_KEY(file_id, page_id) (((page_key_t)(file_id) << 32) | (page_id_t)(page_id))
+
+typedef struct {
+    page_key_t key;
+    frame_id_t frame_id; // NO_FRAME if the slot is empty
+} PageTableSlot;
+
+/*
+ * Maps the keys of pages in a buffer pool to their frames, plain page ids being the keys of the pages of file 0. Open
+ * addressing with linear probing over an inline array of slots, so lookups hash the integer key directly and never
+ * allocate. Kept at most half full, which keeps probe sequences short, and deletes shift later entries back instead of
+ * leaving tombstones.
+ * Not synchronized: callers serialize access to a table
+ */
+typedef struct {
+    PageTableSlot *slots;
+    u32 mask;     // number of slots - 1, the number of slots being a power of two
+    u32 shift;    // 64 - log2(number of slots), for the multiplicative hash
+    u32 size;     // number of pages in the table
+    u32 capacity; // max number of pages, at most half the number of slots
+} PageTable;
+
+/*
+ * Initializes TABLE with room for MAX_PAGES pages. Returns false if its slots could not be allocated
+ */
+bool page_table_init(PageTable *table, size_t max_pages);
+
+/*
+ * Frees the slots of TABLE
+ */
+void page_table_destroy(PageTable *table);
+
+/*
+ * Returns the frame of the page with KEY, or NO_FRAME if the page is not in TABLE
+ */
+frame_id_t page_table_find(const PageTable *table, page_key_t key);
+
+/*
+ * Maps KEY to FRAME_ID, replacing a previous mapping of the page. Returns false if TABLE is already holding as many
+ * pages as it was initialized for
+ */
+bool page_table_insert(PageTable *table, page_key_t key, frame_id_t frame_id);
+
+/*
+ * Removes the page with KEY from TABLE. Returns false if it was not in it
+ */
+bool page_table_remove(PageTable *table, page_key_t key);
@@ -0,0 +1,68 @@
+/*
+ * Page replacement policy of a buffer pool (shard), chosen when the buffer pool is created (see new_bpm_with_policy).
+ * Every policy tracks a fixed range of frames, is told about the references to and the pinning of the pages in them,
+ * and picks the unpinned frame to reuse when a page has to be brought in and no frame is free
+ */
+#pragma once
+
+#include "../utils/shared.h"
+#include "clock_replacer.h"
+#include "lru_k_replacer.h"
+#include "two_q_replacer.h"
+
+typedef enum {
+    REPLACER_CLOCK, // second chance clock, see clock_replacer.h
+    REPLACER_LRU_K, // LRU-2 with a correlated reference period, see lru_k_replacer.h
+    REPLACER_2Q,    // full 2Q, see two_q_replacer.h
+} ReplacerPolicy;
+
+typedef struct {
+    ReplacerPolicy policy;
+    union {
+        ClockReplacer clock;
+        LruKReplacer lru_k;
+        TwoQReplacer two_q;
+    };
+} Replacer;
+
+/*
+ * Initializes REPLACER in place to replace the CAPACITY frames starting at FIRST_FRAME with POLICY. Returns false if
+ * memory for the frames could not be allocated
+ */
+bool replacer_init(Replacer *replacer, ReplacerPolicy policy, frame_id_t first_frame, size_t capacity);
+
+/*
+ * Frees the memory of REPLACER
+ */
+void replacer_destroy(Replacer *replacer);
+
+/*
+ * The page with KEY (see PAGE_KEY) in frame FRAME_ID was referenced and pinned: the frame is not evictable until
+ * unpinned
+ */
+void replacer_pin(Replacer *replacer, frame_id_t frame_id, page_key_t key);
+
+/*
+ * The page in frame FRAME_ID is not pinned anymore, so the frame may be evicted
+ */
+void replacer_unpin(Replacer *replacer, frame_id_t frame_id);
+
+/*
+ * Removes and returns the frame to reuse, or UINT32_MAX if no frame is evictable
+ */
+frame_id_t replacer_evict(Replacer *replacer);
+
+/*
+ * Forgets frame FRAME_ID, whose page left the buffer pool without being evicted
+ */
+void replacer_remove(Replacer *replacer, frame_id_t frame_id);
+
+/*
+ * Stores up to MAX evictable frames into OUT, the ones to be evicted first first, and returns how many were stored
+ */
+size_t replacer_frames_ahead(Replacer *replacer, frame_id_t *out, size_t max);
+
+/*
+ * Returns the number of evictable frames
+ */
+size_t replacer_size(Replacer *replacer);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../utils/shared.h"
+#include "page_table.h"
+
+// Bits of TwoQReplacer.flags
+#define TWO_Q_A1IN 1      // the frame is on the A1in queue
+#define TWO_Q_AM 2        // the frame is on the Am queue
+#define TWO_Q_EVICTABLE 4 // the frame is unpinned, so it may be evicted
+
+/*
+ * Full 2Q replacement (Johnson and Shasha). Pages enter the buffer pool on the A1in FIFO queue, and only pages
+ * referenced again after they left it, while their id is still remembered on the A1out ghost queue, are put on the Am
+ * LRU queue. Pages touched once, like those of a heap scan, therefore pass through A1in without pushing the pages on Am
+ * out. Victims come from A1in while it holds more than its share of frames, from Am otherwise.
+ * Queues are linked through per-frame arrays and the ghost queue is a ring of page keys indexed by a PageTable, so no
+ * operation allocates
+ */
+typedef struct {
+    frame_id_t first_frame; // the replacer tracks frames [first_frame, first_frame + num_pages)
+    size_t num_pages;
+    page_key_t *pages; // key of the page in each frame
+    u32 *prev;         // per frame index of the previous (more recently queued) frame on its queue, UINT32_MAX if none
+    u32 *next;         // per frame index of the next (less recently queued) frame on its queue, UINT32_MAX if none
+    u8 *flags;         // TWO_Q_* bits of each frame
+    u32 a1in_head, a1in_tail, am_head, am_tail;
+    size_t a1in_size;
+    size_t a1in_max; // Kin, the share of frames A1in holds before victims are taken from it
+    size_t size;     // number of evictable frames
+    page_key_t *ghosts;    // ring of the A1out page keys, oldest at ghost_start
+    size_t ghost_capacity; // Kout
+    size_t ghost_start, ghost_count;
+    PageTable ghost_slots; // ring slot of each page on A1out
+    RWLOCK latch;
+} TwoQReplacer;
+
+/*
+ * Initializes REPLACER in place to track the CAPACITY frames starting at FIRST_FRAME, with A1in holding a quarter of
+ * the frames and A1out remembering as many pages as half of them. Returns false if memory could not be allocated
+ */
+bool two_q_replacer_init(TwoQReplacer *replacer, frame_id_t first_frame, size_t capacity);
+
+/*
+ * Frees the memory of REPLACER
+ */
+void two_q_replacer_destroy(TwoQReplacer *replacer);
+
+/*
+ * Records a reference to the page with KEY in frame FRAME_ID and makes the frame not evictable until unpinned. A page
+ * new to the frame is queued on Am if A1out remembers it, on A1in otherwise. A page on Am moves to its front
+ */
+void two_q_replacer_pin(TwoQReplacer *replacer, frame_id_t frame_id, page_key_t key);
+
+/*
+ * Makes frame FRAME_ID evictable
+ */
+void two_q_replacer_unpin(TwoQReplacer *replacer, frame_id_t frame_id);
+
+/*
+ * Removes and returns the evictable frame at the back of A1in or Am (see TwoQReplacer), or UINT32_MAX if there is
+ * none. A page evicted from A1in is remembered on A1out
+ */
+frame_id_t two_q_replacer_evict(TwoQReplacer *replacer);
+
+/*
+ * Takes frame FRAME_ID off its queue without remembering its page, e.g. when the page left the buffer pool without
+ * being evicted
+ */
+void two_q_replacer_remove(TwoQReplacer *replacer, frame_id_t frame_id);
+
+/*
+ * Stores up to MAX evictable frames into OUT in the order they would be evicted if nothing else changed, and returns
+ * how many were stored
+ */
+size_t two_q_replacer_frames_ahead(TwoQReplacer *replacer, frame_id_t *out, size_t max);
+
+/*
+ * Returns the number of evictable frames
+ */
+size_t two_q_replacer_size(TwoQReplacer *replacer);
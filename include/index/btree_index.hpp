@@ -10,10 +10,12 @@
 
 #pragma once
 #include "../disk/bpm.h"
+#include "../disk/page_guard.hpp"
 #include "../utils/shared.h"
 #include "index_page.hpp"
 #include <cassert>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 /*
@@ -28,6 +30,13 @@ namespace somedb {
 using leaf_records = std::vector<RID>;
 using internal_pointers = std::vector<u32>;
 
+/*
+ * B+tree of an index file, whose nodes are read and written through the buffer pool. Lookups latch-couple their way
+ * down, but insert and remove modify in-memory copies of the nodes on their path and write them back one at a time
+ * without holding their latches across the update, so a tree is single-writer: an insert or remove must not run
+ * concurrently with any other operation on the same tree. Operations throw std::runtime_error if a node can not be
+ * fetched, e.g. because its page is damaged on disk or no frame can be freed for it
+ */
 struct BTree {
     u32 magic_num;
     u8 max_size;
@@ -36,6 +45,8 @@ struct BTree {
     u16 node_count;
 
     //--------------------------------------------------------------------------------------------------------------------------------
+    // Tree of the index file of BPM's disk manager. BPM stays the caller's, e.g. from attach_bpm to cache the nodes in a
+    // buffer pool shared with other files, and is detached by the caller once the tree is no longer used
     BTree(BufferPoolManager *bpm) : bpm(bpm) { assert(bpm->disk_manager != nullptr); }
 
     u8 *serialize() const;
@@ -50,17 +61,26 @@ struct BTree {
     // provided key already exists
     page_id_t insert(const BTreeKey &key, const RID &val);
 
-    // Updates provided node's contents(data) in the buffer pool and flushes it to disk
+    // Updates provided node's contents(data, as returned by serialize) in the buffer pool and flushes it to disk, leaving
+    // it cached for the next access. Takes ownership of data
     inline static void flush_node(page_id_t node_pid, u8 *data, BufferPoolManager *bpm) {
-        auto bpm_page = fetch_bpm_page(node_pid, bpm);
-        frame_id_t *fid =
-            static_cast<frame_id_t *>(hash_find(std::to_string(bpm_page->id).data(), bpm->page_table)->data);
-        write_to_frame(*fid, data, bpm);
+        {
+            WritePageGuard guard = fetchWrite(bpm, node_pid);
+            checkFetched(guard, node_pid);
+            memcpy(guard.data(), data, PAGE_SIZE);
+        }
+        delete[] data;
         flush_page(node_pid, bpm);
     }
 
     //--------------------------------------------------------------------------------------------------------------------------------
   private:
+    // Throws std::runtime_error if the page of node NODE_PID could not be fetched into GUARD
+    inline static void checkFetched(const PageGuard &guard, page_id_t node_pid) {
+        if (!guard)
+            throw std::runtime_error("Could not fetch B+tree node " + std::to_string(node_pid));
+    }
+
     // Finds the leaf appropriate for the provided key and returns a pointer to it.
     std::unique_ptr<BTreePage> findLeaf(const BTreeKey &key, std::stack<BREADCRUMB_TYPE> &breadcrumbs,
                                         page_id_t &found_pid);
@@ -106,7 +126,9 @@ struct BTree {
 
     // Given its page id, creates and returns a smart pointer of a btree page (the in memory representation)
     std::unique_ptr<BTreePage> inline getBtreePage(page_id_t pid) {
-        return std::make_unique<BTreePage>(fetch_bpm_page(pid, bpm)->data);
+        ReadPageGuard guard = fetchRead(bpm, pid);
+        checkFetched(guard, pid);
+        return std::make_unique<BTreePage>(guard.data());
     }
 
     // Returns a page id of the page at the top of the provided stack, or 0 if stack is empty.
@@ -117,7 +139,7 @@ struct BTree {
 
         auto top = breadcrumbs.top();
         breadcrumbs.pop();
-        return fetch_bpm_page(top.first, bpm)->id;
+        return top.first;
     }
 
     // Returns a vector of node's values, type of which depends on the node type (leaf/internal)
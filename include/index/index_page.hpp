@@ -8,6 +8,7 @@
  *  (32 bit uint) page id of next (sibling) pag
  *  (32 bit uint) page id of rightmost pointer (not guaranteed to be 0 for leaf nodes, but should be ignored then)
  *  (8 bit uint) special page header flags (8 bit uint) is_leaf boolean
+ *  (32 bit uint) CRC-32C checksum of the page, stamped by the disk manager on every write
  *
  *  Key-value pair pointers consists of:
  *  -16 bit unsigned integer representing the page offset to the corresponding kv pair
@@ -67,7 +68,7 @@ struct BTreePage {
     std::variant<std::vector<RID>, std::vector<u32>> values;
     //--------------------------------------------------------------------------------------------------------------------------------
     /* Deserialize given page data into a BTreePage instance */
-    BTreePage(u8 data[PAGE_SIZE]);
+    BTreePage(const u8 data[PAGE_SIZE]);
 
     BTreePage(bool is_leaf);
     //--------------------------------------------------------------------------------------------------------------------------------
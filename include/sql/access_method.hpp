@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../disk/bpm.h"
 #include "./schema.hpp"
 
 #include <memory>
@@ -14,8 +15,9 @@ using AccessMethodRef = std::unique_ptr<AccessMethod>;
 
 struct AccessMethod {
     std::string path;
+    BufferPool *pool; // buffer pool the method reads pages through, shared by all tables and indexes, or null
 
-    AccessMethod(std::string path) : path(path){};
+    AccessMethod(std::string path, BufferPool *pool = nullptr) : path(path), pool(pool){};
     virtual ~AccessMethod() = default;
 
     virtual Table schema() const = 0;
@@ -23,7 +25,7 @@ struct AccessMethod {
 };
 
 struct HeapfileAccess : AccessMethod {
-    HeapfileAccess(std::string table_name) : AccessMethod(table_name){};
+    HeapfileAccess(std::string table_name, BufferPool *pool = nullptr) : AccessMethod(table_name, pool){};
 
     std::vector<Row> scan() const override { throw std::runtime_error("TODO: Heapfile scan implementation"); };
 
@@ -31,6 +33,8 @@ struct HeapfileAccess : AccessMethod {
 };
 
 struct BTreeIndexAccess : AccessMethod {
+    BTreeIndexAccess(std::string index_name, BufferPool *pool = nullptr) : AccessMethod(index_name, pool){};
+
     std::vector<Row> scan() const { throw std::runtime_error("TODO: B+tree index scan implementation"); };
 };
 } // namespace somedb
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "shared.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * CRC-32C (Castagnoli polynomial, as used by iSCSI, ext4 and most storage formats) of LEN bytes of DATA.
+ * Uses the SSE4.2 crc32 instruction on x86-64 or the CRC extension on ARMv8 when the CPU has it, and a table-driven
+ * (slicing-by-8) implementation otherwise
+ */
+u32 crc32c(const void *data, size_t len);
+
+/*
+ * Continues checksum CRC (as returned by crc32c) with LEN more bytes of DATA, so that
+ * crc32c_update(crc32c(a, n), b, m) equals the checksum of the concatenation of a and b
+ */
+u32 crc32c_update(u32 crc, const void *data, size_t len);
+
+/*
+ * Table-driven crc32c_update, always available. Exposed for testing and benchmarking against the hardware one
+ */
+u32 crc32c_update_sw(u32 crc, const void *data, size_t len);
+
+/*
+ * Returns true if crc32c uses CPU instructions instead of lookup tables
+ */
+bool crc32c_hw_available(void);
@@ -15,6 +15,7 @@
 #define TREE_FLAGS_OFFSET RIGHTMOST_PID_OFFSET + RIGHTMOST_PID_SIZE
 #define IS_LEAF_SIZE 1
 #define IS_LEAF_OFFSET TREE_FLAGS_OFFSET + TREE_FLAGS_SIZE
+#define INDEX_CHECKSUM_OFFSET IS_LEAF_OFFSET + IS_LEAF_SIZE // within the header's spare bytes
 #define INDEX_PAGE_HEADER_SIZE                                                                                         \
     AVAILABLE_SPACE_START_SIZE + AVAILABLE_SPACE_END_SIZE + NEXT_PID_SIZE + RIGHTMOST_PID_SIZE + TREE_FLAGS_SIZE +     \
         IS_LEAF_OFFSET
@@ -38,19 +39,19 @@
  */
 
 void encode_uint32(uint32_t data, uint8_t *buf);
-uint32_t decode_uint32(uint8_t *buf);
+uint32_t decode_uint32(const uint8_t *buf);
 
 void encode_uint16(uint16_t data, uint8_t *buf);
-uint16_t decode_uint16(uint8_t *buf);
+uint16_t decode_uint16(const uint8_t *buf);
 
 void encode_int32(int data, uint8_t *buf);
-int32_t decode_int32(uint8_t *buf);
+int32_t decode_int32(const uint8_t *buf);
 
 void encode_int16(int data, uint8_t *buf);
-int16_t decode_int16(uint8_t *buf);
+int16_t decode_int16(const uint8_t *buf);
 
 void encode_double(double data, uint8_t *buf);
-double decode_double(uint8_t *buf);
+double decode_double(const uint8_t *buf);
 
 void encode_bool(bool data, uint8_t *buf);
-bool decode_bool(uint8_t *buf);
+bool decode_bool(const uint8_t *buf);
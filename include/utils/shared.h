@@ -7,6 +7,7 @@
 #define RWLOCK_INIT(l) pthread_rwlock_init(l, NULL)
 #define RWLOCK_RDLOCK(l) pthread_rwlock_rdlock(l)
 #define RWLOCK_WRLOCK(l) pthread_rwlock_wrlock(l)
+#define RWLOCK_TRYRDLOCK(l) pthread_rwlock_tryrdlock(l)
 #define RWLOCK_UNLOCK(l) pthread_rwlock_unlock(l)
 
 #define FRAME(f) *(frame_id_t *)f
@@ -16,6 +17,7 @@
 typedef uint32_t page_id_t;
 typedef uint32_t frame_id_t;
 
+typedef uint64_t u64;
 typedef uint32_t u32;
 typedef uint16_t u16;
 typedef uint8_t u8;
@@ -0,0 +1,263 @@
+#include "../../include/disk/async_io.h"
+#include "../../include/disk/disk_manager.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Userspace views of the io_uring submission and completion queues shared with the kernel
+struct UringQueues {
+    int ring_fd;
+    u32 to_submit; // queued submission entries the kernel doesn't know about yet
+
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32 *sq_mask;
+    u32 *sq_array;
+    struct io_uring_sqe *sqes;
+
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32 *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+static int uring_enter(int ring_fd, u32 to_submit, u32 min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+    } while (ret == -1 && errno == EINTR);
+    return ret;
+}
+
+static void uring_unmap(UringQueues *uring) {
+    if (uring->sqes)
+        munmap(uring->sqes, uring->sqes_size);
+    if (uring->cq_ring && uring->cq_ring != uring->sq_ring)
+        munmap(uring->cq_ring, uring->cq_ring_size);
+    if (uring->sq_ring)
+        munmap(uring->sq_ring, uring->sq_ring_size);
+    close(uring->ring_fd);
+    free(uring);
+}
+
+// Whether the kernel of io_uring instance RING_FD supports IORING_OP_READ and IORING_OP_WRITE, which io_uring only got
+// in 5.6 along with probing (older kernels fail the probe with EINVAL)
+static bool uring_supports_ops(int ring_fd) {
+    size_t size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, size);
+    bool supported = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0 &&
+                     probe->last_op >= IORING_OP_WRITE &&
+                     (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                     (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+// Sets up an io_uring instance with room for DEPTH requests. Returns a null pointer if io_uring is not usable
+static UringQueues *uring_init(u32 depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = depth * 2;
+
+    int ring_fd = syscall(__NR_io_uring_setup, depth, &params);
+    if (ring_fd < 0)
+        return NULL;
+    if (!uring_supports_ops(ring_fd)) {
+        close(ring_fd);
+        return NULL;
+    }
+
+    UringQueues *uring = (UringQueues *)calloc(1, sizeof(UringQueues));
+    uring->ring_fd = ring_fd;
+    uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Since 5.4 both rings can be mapped at once
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && uring->cq_ring_size > uring->sq_ring_size)
+        uring->sq_ring_size = uring->cq_ring_size;
+
+    void *sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                         IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        uring_unmap(uring);
+        return NULL;
+    }
+    uring->sq_ring = sq_ring;
+
+    void *cq_ring = sq_ring;
+    if (!single_mmap) {
+        cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                       IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            uring_unmap(uring);
+            return NULL;
+        }
+    }
+    uring->cq_ring = cq_ring;
+
+    void *sqes =
+        mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        uring_unmap(uring);
+        return NULL;
+    }
+    uring->sqes = (struct io_uring_sqe *)sqes;
+
+    u8 *sq = (u8 *)sq_ring;
+    uring->sq_head = (u32 *)(sq + params.sq_off.head);
+    uring->sq_tail = (u32 *)(sq + params.sq_off.tail);
+    uring->sq_mask = (u32 *)(sq + params.sq_off.ring_mask);
+    uring->sq_array = (u32 *)(sq + params.sq_off.array);
+
+    u8 *cq = (u8 *)cq_ring;
+    uring->cq_head = (u32 *)(cq + params.cq_off.head);
+    uring->cq_tail = (u32 *)(cq + params.cq_off.tail);
+    uring->cq_mask = (u32 *)(cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return uring;
+}
+
+AsyncIo *async_io_init(u32 depth, bool use_uring) {
+    AsyncIo *aio = (AsyncIo *)calloc(1, sizeof(AsyncIo));
+    aio->depth = depth;
+    aio->requests = (IoRequest *)calloc(depth, sizeof(IoRequest));
+    aio->ready = (IoCompletion *)calloc(depth, sizeof(IoCompletion));
+    aio->free_slots = (u32 *)malloc(sizeof(u32) * depth);
+    for (u32 i = 0; i < depth; i++)
+        aio->free_slots[i] = depth - 1 - i;
+    aio->num_free_slots = depth;
+
+    aio->uring = use_uring ? uring_init(depth) : NULL;
+    aio->backend = aio->uring ? IO_BACKEND_URING : IO_BACKEND_BLOCKING;
+    return aio;
+}
+
+static bool queue_request(AsyncIo *aio, DiskManager *disk_manager, page_id_t page_id, u8 *buf, u64 user_data,
+                          bool is_write) {
+    if (aio->in_flight == aio->depth)
+        return false;
+    aio->in_flight++;
+    if (is_write)
+        set_page_checksum(disk_manager, page_id, buf);
+
+    off_t offset;
+    int fd = page_fd(disk_manager, page_id, buf, &offset);
+    if (aio->backend == IO_BACKEND_BLOCKING) {
+        ssize_t res = is_write ? pwrite(fd, buf, PAGE_SIZE, offset) : pread(fd, buf, PAGE_SIZE, offset);
+        if (is_write && res == PAGE_SIZE && apply_sync_policy(disk_manager, page_id, 1) == -1)
+            res = -1;
+        aio->ready[aio->num_ready++] = (IoCompletion){.user_data = user_data, .result = res == -1 ? -errno : (int)res};
+        return true;
+    }
+
+    u32 slot = aio->free_slots[--aio->num_free_slots];
+    aio->requests[slot] = (IoRequest){
+        .user_data = user_data, .disk_manager = disk_manager, .page_id = page_id, .is_write = is_write};
+
+    UringQueues *uring = aio->uring;
+    u32 tail = *uring->sq_tail;
+    u32 idx = tail & *uring->sq_mask;
+    struct io_uring_sqe *sqe = uring->sqes + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = is_write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (u64)(uintptr_t)buf;
+    sqe->len = PAGE_SIZE;
+    sqe->off = offset;
+    sqe->user_data = slot;
+    uring->sq_array[idx] = idx;
+    __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    uring->to_submit++;
+    return true;
+}
+
+bool async_io_read_page(AsyncIo *aio, DiskManager *disk_manager, page_id_t page_id, u8 *buf, u64 user_data) {
+    return queue_request(aio, disk_manager, page_id, buf, user_data, false);
+}
+
+bool async_io_write_page(AsyncIo *aio, DiskManager *disk_manager, page_id_t page_id, u8 *buf, u64 user_data) {
+    return queue_request(aio, disk_manager, page_id, buf, user_data, true);
+}
+
+u32 async_io_submit(AsyncIo *aio) {
+    if (aio->backend == IO_BACKEND_BLOCKING || aio->uring->to_submit == 0)
+        return 0;
+
+    int submitted = uring_enter(aio->uring->ring_fd, aio->uring->to_submit, 0);
+    if (submitted < 0)
+        return 0;
+    aio->uring->to_submit -= submitted;
+    return submitted;
+}
+
+u32 async_io_complete(AsyncIo *aio, IoCompletion *out, u32 max, u32 min_complete) {
+    if (min_complete > aio->in_flight)
+        min_complete = aio->in_flight;
+
+    if (aio->backend == IO_BACKEND_BLOCKING) {
+        u32 n = aio->num_ready < max ? aio->num_ready : max;
+        memcpy(out, aio->ready, n * sizeof(IoCompletion));
+        memmove(aio->ready, aio->ready + n, (aio->num_ready - n) * sizeof(IoCompletion));
+        aio->num_ready -= n;
+        aio->in_flight -= n;
+        return n;
+    }
+
+    UringQueues *uring = aio->uring;
+    if (uring->to_submit > 0 || min_complete > 0) {
+        int submitted = uring_enter(uring->ring_fd, uring->to_submit, min_complete);
+        if (submitted > 0)
+            uring->to_submit -= submitted;
+    }
+
+    u32 n = 0;
+    u32 head = *uring->cq_head;
+    u32 tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && n < max) {
+        struct io_uring_cqe *cqe = uring->cqes + (head & *uring->cq_mask);
+        IoRequest *req = aio->requests + cqe->user_data;
+        int res = cqe->res;
+        if (req->is_write && res == PAGE_SIZE && apply_sync_policy(req->disk_manager, req->page_id, 1) == -1)
+            res = -EIO;
+
+        out[n++] = (IoCompletion){.user_data = req->user_data, .result = res};
+        aio->free_slots[aio->num_free_slots++] = (u32)cqe->user_data;
+        head++;
+    }
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+    aio->in_flight -= n;
+    return n;
+}
+
+void async_io_destroy(AsyncIo **aio) {
+    if (aio == NULL || *aio == NULL)
+        return;
+
+    // Waiting for a completion only returns none if io_uring_enter failed, closing the ring then cancels the rest
+    IoCompletion drained[16];
+    while ((*aio)->in_flight > 0 && async_io_complete(*aio, drained, 16, 1) > 0)
+        ;
+
+    if ((*aio)->uring)
+        uring_unmap((*aio)->uring);
+    free((*aio)->requests);
+    free((*aio)->ready);
+    free((*aio)->free_slots);
+    free(*aio);
+    *aio = NULL;
+}
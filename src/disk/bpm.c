@@ -1,7 +1,7 @@
 #include "../../include/disk/bpm.h"
 #include "../../include/disk/disk_manager.h"
 #include "../../include/disk/heapfile.h"
-#include "../../include/utils/hash.h"
+#include "../../include/disk/page_table.h"
 #include "../../include/utils/serialize.h"
 #include <assert.h>
 #include <errno.h>
@@ -11,82 +11,543 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+// Most pages the background writer writes from a shard while holding its latch, before letting fetches in again
+#define BG_WRITER_BATCH_PAGES 64
+
+struct BgWriter {
+    BufferPool *pool;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake_cond;
+    bool stop;
+    bool wanted; // a fetch had to evict a dirty page, so the next round starts right away
+    u32 clean_target_pct;
+    u32 interval_ms;
+    u64 started_ns;
+    u64 pages_written;
+};
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
 BufferPoolManager *new_bpm(const size_t pool_size, DiskManager *disk_manager) {
-    BpmPage *pages = (BpmPage *)calloc(sizeof(BpmPage), pool_size);
-    bool *free_list = (bool *)malloc(sizeof(bool) * pool_size);
+    return new_sharded_bpm(pool_size, 1, disk_manager);
+}
+
+BufferPoolManager *new_sharded_bpm(const size_t pool_size, u32 num_shards, DiskManager *disk_manager) {
+    return new_bpm_with_policy(pool_size, num_shards, REPLACER_CLOCK, disk_manager);
+}
+
+BufferPoolManager *new_bpm_with_policy(const size_t pool_size, u32 num_shards, ReplacerPolicy policy,
+                                       DiskManager *disk_manager) {
+    BufferPool *pool = new_buffer_pool(pool_size, num_shards, policy);
+    if (pool == NULL)
+        return NULL;
+    return attach_bpm(pool, disk_manager);
+}
+
+BufferPool *new_buffer_pool(const size_t pool_size, u32 num_shards, ReplacerPolicy policy) {
+    return new_resizable_buffer_pool(pool_size, pool_size, num_shards, policy);
+}
+
+BufferPool *new_resizable_buffer_pool(const size_t pool_size, size_t max_pool_size, u32 num_shards,
+                                      ReplacerPolicy policy) {
+    if (max_pool_size < pool_size)
+        max_pool_size = pool_size;
+    if (num_shards == 0 || num_shards > pool_size)
+        num_shards = pool_size > 0 ? pool_size : 1;
 
-    for (size_t i = 0; i < pool_size; i++) {
+    BpmPage *pages = (BpmPage *)calloc(sizeof(BpmPage), max_pool_size);
+    bool *free_list = (bool *)malloc(sizeof(bool) * max_pool_size);
+    BpmShard *shards = (BpmShard *)calloc(sizeof(BpmShard), num_shards);
+    // Only reserves address space, the memory of a frame is taken when a page is first read into it
+    uint8_t *frame_arena = (uint8_t *)mmap(NULL, max_pool_size * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (frame_arena == MAP_FAILED) {
+        free(pages);
+        free(free_list);
+        free(shards);
+        return NULL;
+    }
+
+    // The first pool_size % num_shards shards get one frame more than the others, and the same goes for the frames
+    // reserved for them
+    frame_id_t first_frame = 0;
+    for (u32 i = 0; i < num_shards; i++) {
+        BpmShard *shard = shards + i;
+        shard->first_frame = first_frame;
+        shard->num_frames = pool_size / num_shards + (i < pool_size % num_shards);
+        shard->capacity = max_pool_size / num_shards + (i < max_pool_size % num_shards);
+        first_frame += shard->capacity;
+        // The page table has room for pages left in frames retired while they were pinned, see resize_buffer_pool
+        bool ok = page_table_init(&shard->page_table, shard->capacity);
+        if (ok && !replacer_init(&shard->replacer, policy, shard->first_frame, shard->num_frames)) {
+            page_table_destroy(&shard->page_table);
+            ok = false;
+        }
+        if (!ok) {
+            for (u32 j = 0; j < i; j++) {
+                page_table_destroy(&shards[j].page_table);
+                replacer_destroy(&shards[j].replacer);
+            }
+            free(pages);
+            free(free_list);
+            free(shards);
+            munmap(frame_arena, max_pool_size * PAGE_SIZE);
+            return NULL;
+        }
+        pthread_mutex_init(&shard->latch, NULL);
+        pthread_cond_init(&shard->io_cond, NULL);
+        shard->write_backs = NULL;
+        shard->write_back_seq = 0;
+    }
+
+    for (size_t i = 0; i < max_pool_size; i++) {
         free_list[i] = true;
+        pages[i].data = frame_arena + i * PAGE_SIZE;
+        RWLOCK_INIT(&pages[i].latch);
+    }
+    // Stacked from the top, so that frames are taken in order
+    for (u32 i = 0; i < num_shards; i++) {
+        BpmShard *shard = shards + i;
+        shard->free_top = NO_FRAME;
+        shard->num_free = shard->num_frames;
+        for (frame_id_t fid = shard->first_frame + shard->num_frames; fid-- > shard->first_frame;) {
+            pages[fid].next_free = shard->free_top;
+            shard->free_top = fid;
+        }
     }
 
+    BufferPool *pool = (BufferPool *)malloc(sizeof(BufferPool));
+    pool->pool_size = pool_size;
+    pool->max_pool_size = max_pool_size;
+    pool->pages = pages;
+    pool->free_list = free_list;
+    pool->frame_arena = frame_arena;
+    pool->shards = shards;
+    pool->num_shards = num_shards;
+    pool->checksum_failures = 0;
+    pool->fetch_hits = 0;
+    pool->fetch_misses = 0;
+    pool->dirty_evictions = 0;
+    pool->prefetch_reads = 0;
+    pool->prefetch_waits = 0;
+    pool->prefetch_failures = 0;
+    pool->bg_writer = NULL;
+    pool->files = NULL;
+    pool->file_refs = NULL;
+    pool->num_files = 0;
+    pool->files_capacity = 0;
+    pthread_mutex_init(&pool->files_mutex, NULL);
+    pool->prefetch_io = NULL;
+    pthread_mutex_init(&pool->prefetch_mutex, NULL);
+    RWLOCK_INIT(&pool->sync_latch);
+
+    return pool;
+}
+
+BufferPoolManager *attach_bpm(BufferPool *pool, DiskManager *disk_manager) {
+    pthread_mutex_lock(&pool->files_mutex);
+    u32 file_id = 0;
+    while (file_id < pool->num_files && pool->files[file_id] != disk_manager)
+        file_id++;
+    if (file_id == pool->num_files) {
+        // Takes the id of a detached file if there is one
+        file_id = 0;
+        while (file_id < pool->num_files && pool->files[file_id] != NULL)
+            file_id++;
+        if (file_id == pool->num_files && pool->num_files == pool->files_capacity) {
+            pool->files_capacity = pool->files_capacity > 0 ? 2 * pool->files_capacity : 8;
+            pool->files = (DiskManager **)realloc(pool->files, sizeof(DiskManager *) * pool->files_capacity);
+            pool->file_refs = (u32 *)realloc(pool->file_refs, sizeof(u32) * pool->files_capacity);
+        }
+        if (file_id == pool->num_files)
+            pool->num_files++;
+        pool->files[file_id] = disk_manager;
+        pool->file_refs[file_id] = 0;
+    }
+    pool->file_refs[file_id]++;
+    pthread_mutex_unlock(&pool->files_mutex);
+
     BufferPoolManager *bpm = (BufferPoolManager *)malloc(sizeof(BufferPoolManager));
-    bpm->pool_size = pool_size;
-    bpm->pages = pages;
-    bpm->free_list = free_list;
-    bpm->page_table = init_hash(pool_size);
-    bpm->replacer = *clock_replacer_init(pool_size);
+    bpm->pool = pool;
     bpm->disk_manager = disk_manager;
-
+    bpm->file_id = file_id;
     return bpm;
 }
 
-static void add_to_pagetable(page_id_t key, frame_id_t *val, BufferPoolManager *bpm) {
-    char *key_str = (char *)malloc(sizeof(char) * 5);
-    sprintf(key_str, "%u", key);
+frame_id_t find_frame(page_id_t page_id, BufferPoolManager *bpm) {
+    BpmShard *shard = BPM_SHARD(bpm->pool, bpm->file_id, page_id);
+    pthread_mutex_lock(&shard->latch);
+    frame_id_t fid = page_table_find(&shard->page_table, PAGE_KEY(bpm->file_id, page_id));
+    pthread_mutex_unlock(&shard->latch);
+    return fid;
+}
+
+// Latches every shard of POOL, in order, for operations that must see or change the whole pool at once
+static void lock_all_shards(BufferPool *pool) {
+    for (u32 i = 0; i < pool->num_shards; i++)
+        pthread_mutex_lock(&pool->shards[i].latch);
+}
+
+static void unlock_all_shards(BufferPool *pool) {
+    for (u32 i = 0; i < pool->num_shards; i++)
+        pthread_mutex_unlock(&pool->shards[i].latch);
+}
+
+// Most pages write_dirty_pages copies before writing them out
+#define WRITE_COPY_PAGES 64
+
+// Copies of the pages write_dirty_pages writes, so their checksums are stamped while no reader of the frame can see it
+typedef struct {
+    u8 *copies; // WRITE_COPY_PAGES pages, aligned for O_DIRECT
+    struct iovec iovecs[WRITE_COPY_PAGES];
+} WriteBuffers;
+
+static WriteBuffers *new_write_buffers(void) {
+    WriteBuffers *buffers = (WriteBuffers *)malloc(sizeof(WriteBuffers));
+    buffers->copies = (u8 *)aligned_alloc(PAGE_SIZE, (size_t)WRITE_COPY_PAGES * PAGE_SIZE);
+    return buffers;
+}
+
+static void free_write_buffers(WriteBuffers *buffers) {
+    free(buffers->copies);
+    free(buffers);
+}
+
+// Pages of a file write_dirty_pages wrote without syncing them, within [first_page_id, first_page_id + count)
+typedef struct {
+    DiskManager *disk_manager;
+    page_id_t first_page_id;
+    u32 count;
+} WrittenRange;
+
+// Buffers for working on the frames of one shard at a time, with room for those of the largest shard
+typedef struct {
+    frame_id_t *ahead;     // frames in eviction order, see replacer_frames_ahead
+    BpmPage **dirty;       // pages to write, see write_dirty_pages
+    WrittenRange *written; // room for one per frame of the pool, so a resize can gather those of every shard
+    WriteBuffers *buffers;
+} ShardScratch;
+
+static ShardScratch new_shard_scratch(BufferPool *pool) {
+    size_t max_frames = pool->shards[0].capacity; // the first shards can grow the largest
+    ShardScratch scratch;
+    scratch.ahead = (frame_id_t *)malloc(sizeof(frame_id_t) * max_frames);
+    scratch.dirty = (BpmPage **)malloc(sizeof(BpmPage *) * max_frames);
+    scratch.written = (WrittenRange *)malloc(sizeof(WrittenRange) * pool->max_pool_size);
+    scratch.buffers = new_write_buffers();
+    return scratch;
+}
+
+static void free_shard_scratch(ShardScratch *scratch) {
+    free(scratch->ahead);
+    free(scratch->dirty);
+    free(scratch->written);
+    free_write_buffers(scratch->buffers);
+}
+
+// Puts frame FID of SHARD on the shard's free frame stack. Called with the shard's latch held
+static void push_free_frame(BufferPool *pool, BpmShard *shard, frame_id_t fid) {
+    pool->free_list[fid] = true;
+    pool->pages[fid].next_free = shard->free_top;
+    shard->free_top = fid;
+    shard->num_free++;
+}
 
-    HashInsertArgs in_args = {.key = key_str, .data = val, .ht = bpm->page_table};
-    hash_insert(&in_args);
+// Takes a frame off SHARD's free frame stack and returns it, or NO_FRAME if there is none. Called with the shard
+// latched
+static frame_id_t pop_free_frame(BufferPool *pool, BpmShard *shard) {
+    frame_id_t fid = shard->free_top;
+    if (fid == NO_FRAME)
+        return NO_FRAME;
+    shard->free_top = pool->pages[fid].next_free;
+    shard->num_free--;
+    pool->free_list[fid] = false;
+    return fid;
+}
+
+AccessStrategy *new_bulk_scan_strategy(BufferPoolManager *bpm, u32 ring_frames) {
+    BufferPool *pool = bpm->pool;
+    // The last shards are the smallest
+    u32 frames_per_shard = (ring_frames + pool->num_shards - 1) / pool->num_shards;
+    if (frames_per_shard > pool->shards[pool->num_shards - 1].num_frames)
+        frames_per_shard = pool->shards[pool->num_shards - 1].num_frames;
+    if (frames_per_shard == 0)
+        frames_per_shard = 1;
+
+    size_t num_slots = (size_t)frames_per_shard * pool->num_shards;
+    AccessStrategy *strategy = (AccessStrategy *)malloc(sizeof(AccessStrategy));
+    frame_id_t *frames = (frame_id_t *)malloc(sizeof(frame_id_t) * num_slots);
+    page_key_t *pages = (page_key_t *)malloc(sizeof(page_key_t) * num_slots);
+    u32 *next = (u32 *)calloc(pool->num_shards, sizeof(u32));
+    if (strategy == NULL || frames == NULL || pages == NULL || next == NULL) {
+        free(strategy);
+        free(frames);
+        free(pages);
+        free(next);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < num_slots; i++)
+        frames[i] = NO_FRAME;
+    strategy->frames_per_shard = frames_per_shard;
+    strategy->frames = frames;
+    strategy->pages = pages;
+    strategy->next = next;
+    return strategy;
+}
+
+void free_access_strategy(AccessStrategy *strategy) {
+    if (strategy == NULL)
+        return;
+    free(strategy->frames);
+    free(strategy->pages);
+    free(strategy->next);
+    free(strategy);
+}
+
+// Dirty victim a fetch writes back once it released the latch of its shard, from a copy since the frame holds another
+// page by then. Fetches and prefetches of the page wait for the write to land before reading it back from disk
+struct WriteBack {
+    page_key_t key;
+    page_id_t page_id;
+    DiskManager *disk_manager;
+    u8 *data;    // PAGE_SIZE bytes aligned for O_DIRECT, the copy of the victim
+    bool queued; // a victim was copied into DATA and is on its shard's list
+    u64 seq;     // order in which write backs of the shard were queued
+    WriteBack *next;
+};
+
+// Makes frame FID of SHARD ready to take another page: its page leaves the buffer pool, written back first if it was
+// modified, or with WRITE_BACK copied there and queued for the caller to write once the latch is released (see
+// finish_write_back). Called with the shard's latch held
+static void evict_frame(BufferPool *pool, BpmShard *shard, frame_id_t fid, WriteBack *write_back) {
+    BpmPage *victim = pool->pages + fid;
+    if (victim->is_dirty) {
+        if (write_back != NULL) {
+            memcpy(write_back->data, victim->data, PAGE_SIZE);
+            write_back->key = PAGE_KEY(victim->file_id, victim->id);
+            write_back->page_id = victim->id;
+            write_back->disk_manager = victim->disk_manager;
+            write_back->queued = true;
+            write_back->seq = ++shard->write_back_seq;
+            write_back->next = shard->write_backs;
+            shard->write_backs = write_back;
+        } else {
+            write_page(victim->id, victim->disk_manager, victim->data);
+        }
+        __atomic_add_fetch(&pool->dirty_evictions, 1, __ATOMIC_RELAXED);
+
+        // The background writer is falling behind. It is only stopped with every shard latched, like this one is
+        BgWriter *writer = pool->bg_writer;
+        if (writer != NULL) {
+            pthread_mutex_lock(&writer->mutex);
+            writer->wanted = true;
+            pthread_cond_signal(&writer->wake_cond);
+            pthread_mutex_unlock(&writer->mutex);
+        }
+    }
+    page_table_remove(&shard->page_table, PAGE_KEY(victim->file_id, victim->id));
+}
+
+// Writes the victim evict_frame queued in WRITE_BACK, with no latch held, and takes it off the list of SHARD
+static void finish_write_back(BpmShard *shard, WriteBack *write_back) {
+    write_page(write_back->page_id, write_back->disk_manager, write_back->data);
+    pthread_mutex_lock(&shard->latch);
+    WriteBack **link = &shard->write_backs;
+    while (*link != write_back)
+        link = &(*link)->next;
+    *link = write_back->next;
+    pthread_cond_broadcast(&shard->io_cond);
+    pthread_mutex_unlock(&shard->latch);
+}
+
+// Whether page KEY of SHARD is still being written back by the fetch that evicted it. Called with the shard latched
+static bool is_written_back(const BpmShard *shard, page_key_t key) {
+    for (const WriteBack *write_back = shard->write_backs; write_back != NULL; write_back = write_back->next)
+        if (write_back->key == key)
+            return true;
+    return false;
+}
+
+// Waits until the write backs of POOL's shards queued so far landed, for what assumes evicted pages are on disk
+static void wait_for_write_backs(BufferPool *pool) {
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        BpmShard *shard = pool->shards + i;
+        pthread_mutex_lock(&shard->latch);
+        u64 last = shard->write_back_seq;
+        bool pending = true;
+        while (pending) {
+            pending = false;
+            for (const WriteBack *write_back = shard->write_backs; write_back != NULL; write_back = write_back->next)
+                pending |= write_back->seq <= last;
+            if (pending)
+                pthread_cond_wait(&shard->io_cond, &shard->latch);
+        }
+        pthread_mutex_unlock(&shard->latch);
+    }
+}
+
+// Whether frame FID of SHARD was cut off by a shrink (see resize_buffer_pool) and is waiting for its page to be
+// unpinned to retire
+static inline bool is_frame_cut(const BpmShard *shard, frame_id_t fid) {
+    return fid >= shard->first_frame + shard->num_frames;
+}
+
+// Takes frame FID of SHARD out of use: its page, unpinned, leaves the buffer pool after it was written back if dirty,
+// and its memory goes back to the system. Called with the shard's latch held
+static void retire_frame(BufferPool *pool, BpmShard *shard, frame_id_t fid) {
+    BpmPage *page = pool->pages + fid;
+    if (!pool->free_list[fid]) {
+        if (page->is_dirty) {
+            write_page(page->id, page->disk_manager, page->data);
+            page->is_dirty = false;
+        }
+        page_table_remove(&shard->page_table, PAGE_KEY(page->file_id, page->id));
+        pool->free_list[fid] = true;
+    }
+    madvise(page->data, PAGE_SIZE, MADV_DONTNEED);
+}
+
+// Drops a pin of the page in frame FID of SHARD. A page whose prefetch failed leaves the buffer pool with its last
+// pin, and so does one in a frame cut off by a shrink. Called with the shard's latch held
+static void release_pin(BufferPool *pool, BpmShard *shard, frame_id_t fid) {
+    BpmPage *page = pool->pages + fid;
+    page->pin_count--;
+    if (page->pin_count > 0)
+        return;
+    if (page->io_state == PAGE_LOAD_FAILED) {
+        page->io_state = PAGE_LOADED;
+        if (!is_frame_cut(shard, fid)) {
+            page_table_remove(&shard->page_table, PAGE_KEY(page->file_id, page->id));
+            replacer_remove(&shard->replacer, fid);
+            push_free_frame(pool, shard, fid);
+            return;
+        }
+    }
+    if (is_frame_cut(shard, fid))
+        retire_frame(pool, shard, fid);
+    else
+        replacer_unpin(&shard->replacer, fid);
+}
+
+// Reaps prefetch reads that completed, waiting for at least MIN_COMPLETE of them, and releases the prefetch's pins on
+// their pages. Returns the number of reads reaped. Called with the prefetch mutex held
+static u32 reap_prefetches(BufferPool *pool, u32 min_complete) {
+    IoCompletion completions[PREFETCH_DEPTH];
+    u32 n = async_io_complete(pool->prefetch_io, completions, PREFETCH_DEPTH, min_complete);
+    for (u32 i = 0; i < n; i++) {
+        frame_id_t fid = (frame_id_t)completions[i].user_data;
+        // The prefetch's pin kept the page in its frame
+        BpmPage *page = pool->pages + fid;
+        BpmShard *shard = BPM_SHARD(pool, page->file_id, page->id);
+        pthread_mutex_lock(&shard->latch);
+        bool ok = completions[i].result == PAGE_SIZE;
+        if (!ok) {
+            __atomic_add_fetch(&pool->prefetch_failures, 1, __ATOMIC_RELAXED);
+            fprintf(stderr, "Prefetch of page %u of '%s' failed\n", page->id, page->disk_manager->table_name);
+        } else if (!verify_page_checksum(page->disk_manager, page->id, page->data)) {
+            __atomic_add_fetch(&pool->checksum_failures, 1, __ATOMIC_RELAXED);
+            fprintf(stderr, "Checksum mismatch in page %u of '%s'\n", page->id, page->disk_manager->table_name);
+            ok = false;
+        }
+        page->io_state = ok ? PAGE_LOADED : PAGE_LOAD_FAILED;
+        release_pin(pool, shard, fid);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return n;
+}
+
+// Releases the frames of prefetched pages whose reads completed, and with WAIT_ALL waits for every read in flight
+// first. Called without any shard latch held
+static void collect_prefetches(BufferPool *pool, bool wait_all) {
+    pthread_mutex_lock(&pool->prefetch_mutex);
+    if (pool->prefetch_io != NULL) {
+        // A wait reaping nothing failed, the reads left keep their frames pinned
+        while (wait_all && pool->prefetch_io->in_flight > 0 && reap_prefetches(pool, 1) > 0)
+            ;
+        reap_prefetches(pool, 0);
+    }
+    pthread_mutex_unlock(&pool->prefetch_mutex);
+}
+
+// Evicts the page the ring of STRATEGY read into the frame of ring SLOT and returns that frame, or NO_FRAME if the slot
+// has no frame yet, or its page is pinned or left the frame. Called with the latch of the slot's SHARD held
+static frame_id_t recycle_ring_frame(BufferPool *pool, BpmShard *shard, AccessStrategy *strategy, size_t slot,
+                                     WriteBack *write_back) {
+    frame_id_t fid = strategy->frames[slot];
+    if (fid == NO_FRAME || pool->free_list[fid])
+        return NO_FRAME;
+    BpmPage *page = pool->pages + fid;
+    if (PAGE_KEY(page->file_id, page->id) != strategy->pages[slot] || page->pin_count > 0)
+        return NO_FRAME;
+
+    replacer_remove(&shard->replacer, fid);
+    evict_frame(pool, shard, fid, write_back);
+    return fid;
 }
 
 /*
- * Helper function for creating a page in the buffer pool.
- * If no frame is available or evictable, returns a null pointer.
+ * Helper function for creating a page in the buffer pool, called with the latch of the page's SHARD held.
+ * The page goes to a frame recycled from the ring of STRATEGY if it is not a null pointer and has one (see
+ * AccessStrategy), to a free or evicted frame otherwise. If no frame is available or evictable, returns a null pointer.
  */
-static BpmPage *new_bpm_page(BufferPoolManager *bpm, page_id_t pid) {
+static BpmPage *new_bpm_page(BufferPoolManager *bpm, BpmShard *shard, page_id_t pid, AccessStrategy *strategy,
+                             WriteBack *write_back) {
+    BufferPool *pool = bpm->pool;
+    page_key_t key = PAGE_KEY(bpm->file_id, pid);
     // Return early if already exists
-    char pid_str[11];
-    sprintf(pid_str, "%d", pid);
-    HashEl *found = hash_find(pid_str, bpm->page_table);
-    if (found) {
-        frame_id_t fidx = (*(frame_id_t *)found->data);
-        return bpm->pages + fidx;
-    }
-
-    // Find free frame id
-    frame_id_t *fid = (frame_id_t *)malloc(sizeof(frame_id_t));
-    *fid = UINT32_MAX;
-    for (size_t i = 0; i < bpm->pool_size; i++) {
-        if (bpm->free_list[i] == true) {
-            *fid = i;
-            bpm->free_list[i] = false;
-            break;
-        }
+    frame_id_t fid = page_table_find(&shard->page_table, key);
+    if (fid != NO_FRAME)
+        return pool->pages + fid;
+
+    size_t slot = 0;
+    if (strategy != NULL) {
+        u32 shard_idx = shard - pool->shards;
+        slot = (size_t)shard_idx * strategy->frames_per_shard + strategy->next[shard_idx];
+        strategy->next[shard_idx] = (strategy->next[shard_idx] + 1) % strategy->frames_per_shard;
+        fid = recycle_ring_frame(pool, shard, strategy, slot, write_back);
     }
-    if (*fid == UINT32_MAX) {
-        *fid = evict(&bpm->replacer);
-        if (*fid == UINT32_MAX)
+    if (fid == NO_FRAME)
+        fid = pop_free_frame(pool, shard);
+    if (fid == NO_FRAME) {
+        fid = replacer_evict(&shard->replacer);
+        if (fid == UINT32_MAX)
             return NULL;
-        else if (bpm->pages[*fid].is_dirty)
-            flush_page(*fid, bpm);
+        evict_frame(pool, shard, fid, write_back);
+    }
+    // A ring frame that could not be recycled is replaced by this one
+    if (strategy != NULL) {
+        strategy->frames[slot] = fid;
+        strategy->pages[slot] = key;
     }
 
-    BpmPage page;
-    page.id = pid;
-    page.pin_count = 1;
-    page.is_dirty = false;
-    memset(page.data, 0, PAGE_SIZE);
-    bpm->pages[*fid] = page;
+    BpmPage *page = pool->pages + fid;
+    page->id = pid;
+    page->file_id = bpm->file_id;
+    page->disk_manager = bpm->disk_manager;
+    page->pin_count = 1;
+    page->is_dirty = false;
+    page->io_state = PAGE_LOADED;
+    memset(page->data, 0, PAGE_SIZE);
 
-    add_to_pagetable(pid, fid, bpm);
-    clock_replacer_pin(fid, &bpm->replacer);
+    page_table_insert(&shard->page_table, key, fid);
+    replacer_pin(&shard->replacer, fid, key);
 
-    return bpm->pages + *fid;
+    return page;
 }
 
 BpmPage *allocate_new_page(BufferPoolManager *bpm, PageType type) {
-    page_id_t pid;
+    page_id_t pid = 0;
     BpmPage *bpm_page = NULL;
 
     // Write page out to disk in appropriate format without populating the buffer pool for now
@@ -99,77 +560,795 @@ BpmPage *allocate_new_page(BufferPoolManager *bpm, PageType type) {
         break;
     case INVALID:
         assert(type != INVALID); // "throw" error
-        break;
+        return NULL;
     }
 
-    while (bpm_page == NULL)
-        bpm_page = new_bpm_page(bpm, pid);
+    BpmShard *shard = BPM_SHARD(bpm->pool, bpm->file_id, pid);
+    while (bpm_page == NULL) {
+        pthread_mutex_lock(&shard->latch);
+        bpm_page = new_bpm_page(bpm, shard, pid, NULL, NULL);
+        pthread_mutex_unlock(&shard->latch);
+    }
 
     return bpm_page;
 }
 
 bool unpin_page(page_id_t page_id, bool is_dirty, BufferPoolManager *bpm) {
-    char pid_str[15];
-    sprintf(pid_str, "%d", page_id);
+    BufferPool *pool = bpm->pool;
+    BpmShard *shard = BPM_SHARD(pool, bpm->file_id, page_id);
+    pthread_mutex_lock(&shard->latch);
+    frame_id_t frame_idx = page_table_find(&shard->page_table, PAGE_KEY(bpm->file_id, page_id));
+    if (frame_idx == NO_FRAME || pool->pages[frame_idx].pin_count == 0) {
+        pthread_mutex_unlock(&shard->latch);
+        return false;
+    }
+
+    BpmPage *page = pool->pages + frame_idx;
 
-    HashEl *el = hash_find(pid_str, bpm->page_table);
+    page->is_dirty |= is_dirty;
+    page->pin_count--;
+    if (page->pin_count == 0 && is_frame_cut(shard, frame_idx))
+        retire_frame(pool, shard, frame_idx);
+    else if (page->pin_count == 0)
+        replacer_unpin(&shard->replacer, frame_idx);
 
-    if (el == NULL)
+    pthread_mutex_unlock(&shard->latch);
+    return true;
+}
+
+void write_to_frame(frame_id_t fid, u8 *data, BufferPoolManager *bpm) {
+    // The caller has the page pinned, so the frame keeps holding it
+    memcpy(bpm->pool->pages[fid].data, data, PAGE_SIZE);
+    bpm->pool->pages[fid].is_dirty = true;
+}
+
+bool flush_page(page_id_t page_id, BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    BpmShard *shard = BPM_SHARD(pool, bpm->file_id, page_id);
+    pthread_mutex_lock(&shard->latch);
+    frame_id_t fid = page_table_find(&shard->page_table, PAGE_KEY(bpm->file_id, page_id));
+    // A page still being prefetched is not in the frame yet
+    if (fid == NO_FRAME || pool->pages[fid].io_state != PAGE_LOADED) {
+        pthread_mutex_unlock(&shard->latch);
         return false;
+    }
+    // The frame latch is waited for with the page pinned rather than the shard latched, since a guard holder may be
+    // fetching from the shard
+    BpmPage *page = pool->pages + fid;
+    page->pin_count++;
+    replacer_pin(&shard->replacer, fid, PAGE_KEY(bpm->file_id, page_id));
+    pthread_mutex_unlock(&shard->latch);
 
-    frame_id_t frame_idx = *(frame_id_t *)(el->data);
-    BpmPage *page = bpm->pages + frame_idx;
+    // The frame stays latched shared until the page is on disk, so no writer changes it halfway, nor before a
+    // concurrent write of the page by another thread lands. The checksum is stamped in a copy readers do not see
+    u8 copy[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+    RWLOCK_RDLOCK(&page->latch);
+    memcpy(copy, page->data, PAGE_SIZE);
+    pthread_mutex_lock(&shard->latch);
+    page->is_dirty = false;
+    pthread_mutex_unlock(&shard->latch);
+    write_page(page_id, bpm->disk_manager, copy);
+    RWLOCK_UNLOCK(&page->latch);
 
-    if (page->pin_count == 0)
+    pthread_mutex_lock(&shard->latch);
+    release_pin(pool, shard, fid);
+    pthread_mutex_unlock(&shard->latch);
+    return true;
+}
+
+bool evict_page(page_id_t page_id, BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    // A prefetched page keeps the prefetch's pin until its read is reaped
+    collect_prefetches(pool, false);
+    BpmShard *shard = BPM_SHARD(pool, bpm->file_id, page_id);
+    pthread_mutex_lock(&shard->latch);
+    frame_id_t fid = page_table_find(&shard->page_table, PAGE_KEY(bpm->file_id, page_id));
+    if (fid == NO_FRAME || pool->pages[fid].pin_count > 0) {
+        pthread_mutex_unlock(&shard->latch);
         return false;
+    }
 
-    page->is_dirty = is_dirty;
-    page->pin_count--;
-    if (page->pin_count == 0)
-        clock_replacer_unpin((frame_id_t *)el->data, &bpm->replacer);
+    BpmPage *page = pool->pages + fid;
+    if (page->is_dirty) {
+        write_page(page_id, bpm->disk_manager, page->data);
+        page->is_dirty = false;
+    }
 
+    // A free frame is handed out from the free list, so it leaves the replacer
+    page_table_remove(&shard->page_table, PAGE_KEY(bpm->file_id, page_id));
+    replacer_remove(&shard->replacer, fid);
+    push_free_frame(pool, shard, fid);
+
+    pthread_mutex_unlock(&shard->latch);
     return true;
 }
 
-void write_to_frame(frame_id_t fid, u8 *data, BufferPoolManager *bpm) {
-    memcpy(bpm->pages[fid].data, data, PAGE_SIZE);
-    bpm->pages[fid].is_dirty = true;
+// Orders pages by file, then by page id
+static int compare_pages_by_key(const void *a, const void *b) {
+    const BpmPage *page_a = *(BpmPage *const *)a;
+    const BpmPage *page_b = *(BpmPage *const *)b;
+    page_key_t key_a = PAGE_KEY(page_a->file_id, page_a->id);
+    page_key_t key_b = PAGE_KEY(page_b->file_id, page_b->id);
+    return (key_a > key_b) - (key_a < key_b);
 }
 
-bool flush_page(page_id_t page_id, BufferPoolManager *bpm) {
-    char pid_str[11];
-    sprintf(pid_str, "%d", page_id);
-    HashEl *entry = hash_find(pid_str, bpm->page_table);
-    if (!entry)
+/*
+ * Writes the NUM_DIRTY pages of DIRTY to disk through the disk managers of their files and unsets their dirty bits, with
+ * the shards they belong to latched and no writer on the pages. Pages of a file with consecutive ids are written with a
+ * single vectored write, regardless of which frames they are in, from copies in BUFFERS so that readers of the frames
+ * never see their checksums being stamped. Nothing is synced, since that would stall every fetch of the latched shards:
+ * unless WRITTEN is NULL, the pages written are recorded there, one range per file, for sync_written_pages to sync
+ * once the latches are released, and the number of ranges is returned
+ */
+static size_t write_dirty_pages(BpmPage **dirty, size_t num_dirty, WriteBuffers *buffers, WrittenRange *written) {
+    qsort(dirty, num_dirty, sizeof(BpmPage *), compare_pages_by_key);
+    size_t num_written = 0;
+    u32 num_copies = 0;
+    for (size_t i = 0; i < num_dirty; i++) {
+        BpmPage *page = dirty[i];
+        u8 *copy = buffers->copies + (size_t)num_copies * PAGE_SIZE;
+        memcpy(copy, page->data, PAGE_SIZE);
+        buffers->iovecs[num_copies++] = (struct iovec){.iov_base = copy, .iov_len = PAGE_SIZE};
+        page->is_dirty = false;
+
+        bool run_ends =
+            i + 1 == num_dirty || dirty[i + 1]->file_id != page->file_id || dirty[i + 1]->id != page->id + 1;
+        if (run_ends || num_copies == WRITE_COPY_PAGES) {
+            write_pages_nosync(page->id + 1 - num_copies, num_copies, page->disk_manager, buffers->iovecs);
+            num_copies = 0;
+        }
+
+        if (written == NULL)
+            continue;
+        if (num_written > 0 && written[num_written - 1].disk_manager == page->disk_manager)
+            written[num_written - 1].count = page->id + 1 - written[num_written - 1].first_page_id;
+        else
+            written[num_written++] = (WrittenRange){.disk_manager = page->disk_manager, .first_page_id = page->id,
+                                                    .count = 1};
+    }
+    return num_written;
+}
+
+// Applies the sync policies of their files to the NUM_WRITTEN ranges of pages of WRITTEN, once no latch is held
+static void sync_written_pages(const WrittenRange *written, size_t num_written) {
+    for (size_t i = 0; i < num_written; i++)
+        if (apply_sync_policy(written[i].disk_manager, written[i].first_page_id, written[i].count) == -1)
+            printf("I/O error while writing pages\n");
+}
+
+/*
+ * Writes those of the NUM_DIRTY dirty pages of DIRTY whose frames no writer holds with write_dirty_pages, each frame
+ * latched shared while it is written so that no writer changes it halfway, and returns the number of pages left
+ * because a writer held them, which are pinned for write_busy_pages and moved to the front of DIRTY. Called with the
+ * shards of the pages latched, so the frame latches are only tried: a guard holder may be waiting for one of those
+ * shards to fetch another page
+ */
+static size_t write_unlatched_pages(BufferPool *pool, BpmPage **dirty, size_t num_dirty, WriteBuffers *buffers) {
+    size_t num_latched = 0;
+    for (size_t i = 0; i < num_dirty; i++) {
+        if (RWLOCK_TRYRDLOCK(&dirty[i]->latch) != 0)
+            continue;
+        BpmPage *page = dirty[i];
+        dirty[i] = dirty[num_latched];
+        dirty[num_latched++] = page;
+    }
+    write_dirty_pages(dirty, num_latched, buffers, NULL);
+    for (size_t i = 0; i < num_latched; i++)
+        RWLOCK_UNLOCK(&dirty[i]->latch);
+
+    for (size_t i = num_latched; i < num_dirty; i++) {
+        BpmPage *page = dirty[i];
+        page->pin_count++;
+        replacer_pin(&BPM_SHARD(pool, page->file_id, page->id)->replacer, (frame_id_t)(page - pool->pages),
+                     PAGE_KEY(page->file_id, page->id));
+    }
+    memmove(dirty, dirty + num_latched, (num_dirty - num_latched) * sizeof(BpmPage *));
+    return num_dirty - num_latched;
+}
+
+/*
+ * Writes the NUM_BUSY pages of BUSY write_unlatched_pages pinned because a writer held them, one at a time once their
+ * frame latches are taken shared, and unpins them. Retrying them under the shard latches instead can starve behind a
+ * writer that latches the page again every time it is released. Called with no shard latched. Returns the number of
+ * pages written, those written back meanwhile being skipped
+ */
+static size_t write_busy_pages(BufferPool *pool, BpmPage **busy, size_t num_busy, WriteBuffers *buffers) {
+    size_t written = 0;
+    for (size_t i = 0; i < num_busy; i++) {
+        BpmPage *page = busy[i];
+        BpmShard *shard = BPM_SHARD(pool, page->file_id, page->id);
+        RWLOCK_RDLOCK(&page->latch);
+        pthread_mutex_lock(&shard->latch);
+        if (page->is_dirty) {
+            write_dirty_pages(&page, 1, buffers, NULL);
+            written++;
+        }
+        release_pin(pool, shard, (frame_id_t)(page - pool->pages));
+        pthread_mutex_unlock(&shard->latch);
+        RWLOCK_UNLOCK(&page->latch);
+    }
+    return written;
+}
+
+void flush_all(BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    BpmPage **dirty = (BpmPage **)malloc(sizeof(BpmPage *) * pool->max_pool_size);
+    WriteBuffers *buffers = new_write_buffers();
+
+    // All shards stay latched until the pages are written, so none of them is evicted meanwhile. Pages being modified
+    // are written once their writers are done, pinned. The table file is synced once at the end
+    size_t num_dirty = 0;
+    lock_all_shards(pool);
+    for (frame_id_t fid = 0; fid < pool->max_pool_size; fid++) {
+        BpmPage *page = pool->pages + fid;
+        if (!pool->free_list[fid] && page->file_id == bpm->file_id && page->is_dirty)
+            dirty[num_dirty++] = page;
+    }
+    size_t num_busy = write_unlatched_pages(pool, dirty, num_dirty, buffers);
+    unlock_all_shards(pool);
+    write_busy_pages(pool, dirty, num_busy, buffers);
+    wait_for_write_backs(pool);
+    sync_table_file(bpm->disk_manager);
+
+    free(dirty);
+    free_write_buffers(buffers);
+}
+
+static int compare_page_ids(const void *a, const void *b) {
+    page_id_t pid_a = *(const page_id_t *)a;
+    page_id_t pid_b = *(const page_id_t *)b;
+    return (pid_a > pid_b) - (pid_a < pid_b);
+}
+
+// Sleeps until DEADLINE_NS on the clock of now_ns
+static void sleep_until_ns(u64 deadline_ns) {
+    u64 now = now_ns();
+    if (now >= deadline_ns)
+        return;
+    struct timespec ts = {.tv_sec = (time_t)((deadline_ns - now) / 1000000000ull),
+                          .tv_nsec = (long)((deadline_ns - now) % 1000000000ull)};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+size_t checkpoint(BufferPoolManager *bpm, u32 max_pages_per_sec) {
+    BufferPool *pool = bpm->pool;
+    page_id_t *snapshot = (page_id_t *)malloc(sizeof(page_id_t) * pool->max_pool_size);
+    size_t num_snapshot = 0;
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        BpmShard *shard = pool->shards + i;
+        pthread_mutex_lock(&shard->latch);
+        for (frame_id_t fid = shard->first_frame; fid < shard->first_frame + shard->capacity; fid++) {
+            BpmPage *page = pool->pages + fid;
+            if (!pool->free_list[fid] && page->file_id == bpm->file_id && page->is_dirty)
+                snapshot[num_snapshot++] = page->id;
+        }
+        pthread_mutex_unlock(&shard->latch);
+    }
+    qsort(snapshot, num_snapshot, sizeof(page_id_t), compare_page_ids);
+
+    // Batches are small enough for the pacing to spread them over every tenth of a second
+    size_t batch_pages = CHECKPOINT_BATCH_PAGES;
+    if (max_pages_per_sec > 0 && max_pages_per_sec / 10 < batch_pages)
+        batch_pages = max_pages_per_sec / 10 > 0 ? max_pages_per_sec / 10 : 1;
+    BpmPage *dirty[CHECKPOINT_BATCH_PAGES];
+    WriteBuffers *buffers = new_write_buffers();
+    size_t written = 0;
+    u64 start = now_ns();
+
+    // Pages a writer is modifying when their batch comes up are written after the others of the batch, once the
+    // shards are released and the writers are done
+    for (size_t next = 0; next < num_snapshot; next += batch_pages) {
+        size_t end = next + batch_pages < num_snapshot ? next + batch_pages : num_snapshot;
+        if (max_pages_per_sec > 0 && written > 0)
+            sleep_until_ns(start + written * 1000000000ull / max_pages_per_sec);
+
+        size_t num_dirty = 0;
+        lock_all_shards(pool);
+        for (size_t j = next; j < end; j++) {
+            BpmShard *shard = BPM_SHARD(pool, bpm->file_id, snapshot[j]);
+            frame_id_t fid = page_table_find(&shard->page_table, PAGE_KEY(bpm->file_id, snapshot[j]));
+            if (fid != NO_FRAME && pool->pages[fid].is_dirty && pool->pages[fid].io_state == PAGE_LOADED)
+                dirty[num_dirty++] = pool->pages + fid;
+        }
+        size_t num_busy = write_unlatched_pages(pool, dirty, num_dirty, buffers);
+        unlock_all_shards(pool);
+        written += num_dirty - num_busy + write_busy_pages(pool, dirty, num_busy, buffers);
+    }
+    // Pages evicted since the snapshot were written back, maybe by fetches that are not done yet
+    wait_for_write_backs(pool);
+    sync_table_file(bpm->disk_manager);
+
+    free(snapshot);
+    free_write_buffers(buffers);
+    return written;
+}
+
+bool detach_bpm(BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    // No read may still be targeting the file once it is detached
+    collect_prefetches(pool, true);
+    BpmPage **dirty = (BpmPage **)malloc(sizeof(BpmPage *) * pool->max_pool_size);
+    size_t num_dirty = 0;
+    bool pinned = false;
+
+    lock_all_shards(pool);
+    for (frame_id_t fid = 0; fid < pool->max_pool_size && !pinned; fid++) {
+        BpmPage *page = pool->pages + fid;
+        if (pool->free_list[fid] || page->file_id != bpm->file_id)
+            continue;
+        pinned = page->pin_count > 0;
+        if (page->is_dirty)
+            dirty[num_dirty++] = page;
+    }
+    if (pinned) {
+        unlock_all_shards(pool);
+        free(dirty);
+        return false;
+    }
+
+    // Unpinned pages are never in frames cut off by a shrink, those retire with the last unpin
+    WriteBuffers *buffers = new_write_buffers();
+    WrittenRange written;
+    size_t num_written = write_dirty_pages(dirty, num_dirty, buffers, &written);
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        BpmShard *shard = pool->shards + i;
+        for (frame_id_t fid = shard->first_frame; fid < shard->first_frame + shard->num_frames; fid++) {
+            BpmPage *page = pool->pages + fid;
+            if (pool->free_list[fid] || page->file_id != bpm->file_id)
+                continue;
+            page_table_remove(&shard->page_table, PAGE_KEY(page->file_id, page->id));
+            replacer_remove(&shard->replacer, fid);
+            push_free_frame(pool, shard, fid);
+        }
+    }
+    unlock_all_shards(pool);
+    sync_written_pages(&written, num_written);
+    // Pages of the file the background writer or a resize wrote before are synced too once it lets go, and those
+    // fetches evicted are written back
+    RWLOCK_WRLOCK(&pool->sync_latch);
+    RWLOCK_UNLOCK(&pool->sync_latch);
+    wait_for_write_backs(pool);
+
+    // The file id goes back to the pool with the file's last buffer pool manager, no page refers to it anymore
+    pthread_mutex_lock(&pool->files_mutex);
+    if (--pool->file_refs[bpm->file_id] == 0)
+        pool->files[bpm->file_id] = NULL;
+    pthread_mutex_unlock(&pool->files_mutex);
+
+    free(dirty);
+    free_write_buffers(buffers);
+    free(bpm);
+    return true;
+}
+
+// Moves the unpinned page in frame FROM of SHARD to frame TO of the shard, which holds no page, leaving FROM free.
+// Called with the shard's latch held
+static void move_page(BufferPool *pool, BpmShard *shard, frame_id_t from, frame_id_t to) {
+    BpmPage *src = pool->pages + from;
+    BpmPage *dst = pool->pages + to;
+    memcpy(dst->data, src->data, PAGE_SIZE);
+    dst->id = src->id;
+    dst->file_id = src->file_id;
+    dst->disk_manager = src->disk_manager;
+    dst->pin_count = 0;
+    dst->is_dirty = src->is_dirty;
+    dst->io_state = PAGE_LOADED;
+    pool->free_list[to] = false;
+    page_table_insert(&shard->page_table, PAGE_KEY(src->file_id, src->id), to);
+
+    src->is_dirty = false;
+    pool->free_list[from] = true;
+}
+
+bool resize_buffer_pool(BufferPool *pool, size_t pool_size) {
+    if (pool_size < pool->num_shards || pool_size > pool->max_pool_size)
         return false;
-    frame_id_t *fid = (frame_id_t *)entry->data;
 
-    write_page(page_id, bpm->disk_manager, bpm->pages[*fid].data);
+    collect_prefetches(pool, false);
+    ShardScratch scratch = new_shard_scratch(pool);
+    size_t num_written = 0;
 
-    HashRemoveArgs rm_args = {.key = pid_str, .ht = bpm->page_table, .success_out = NULL};
-    hash_remove(&rm_args);
+    lock_all_shards(pool);
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        BpmShard *shard = pool->shards + i;
+        size_t num_frames = pool_size / pool->num_shards + (i < pool_size % pool->num_shards);
+        frame_id_t old_end = shard->first_frame + shard->num_frames;
+        frame_id_t new_end = shard->first_frame + num_frames;
+        size_t num_ahead = replacer_frames_ahead(&shard->replacer, scratch.ahead, shard->num_frames);
 
-    bpm->free_list[*fid] = true;
-    clock_replacer_unpin(fid, &bpm->replacer);
+        frame_id_t *link = &shard->free_top;
+        while (*link != NO_FRAME) {
+            if (*link >= new_end) {
+                *link = pool->pages[*link].next_free;
+                shard->num_free--;
+            } else {
+                link = &pool->pages[*link].next_free;
+            }
+        }
 
+        // The unpinned pages of the frames cut off, the ones the replacer would keep longest first, move to the free
+        // frames kept, then in place of the pages it would evict before them. Those left are written back together and
+        // leave the pool with their frames
+        size_t victim = 0;
+        for (size_t j = num_ahead; j-- > 0;) {
+            if (scratch.ahead[j] < new_end)
+                continue;
+            frame_id_t target = pop_free_frame(pool, shard);
+            if (target == NO_FRAME) {
+                while (victim < j && (scratch.ahead[victim] == NO_FRAME || scratch.ahead[victim] >= new_end))
+                    victim++;
+                if (victim == j)
+                    break;
+                target = scratch.ahead[victim];
+                scratch.ahead[victim] = NO_FRAME;
+                evict_frame(pool, shard, target, NULL);
+            }
+            move_page(pool, shard, scratch.ahead[j], target);
+            scratch.ahead[j] = target;
+        }
+        size_t num_dirty = 0;
+        for (frame_id_t fid = new_end; fid < old_end; fid++) {
+            BpmPage *page = pool->pages + fid;
+            if (!pool->free_list[fid] && page->pin_count == 0 && page->is_dirty)
+                scratch.dirty[num_dirty++] = page;
+        }
+        num_written += write_dirty_pages(scratch.dirty, num_dirty, scratch.buffers, scratch.written + num_written);
+        for (frame_id_t fid = new_end; fid < old_end; fid++)
+            if (pool->free_list[fid] || pool->pages[fid].pin_count == 0)
+                retire_frame(pool, shard, fid);
+
+        // Frames given back to the shard may still hold a page pinned since they were cut off, which stays
+        for (frame_id_t fid = new_end; fid-- > old_end;)
+            if (pool->free_list[fid])
+                push_free_frame(pool, shard, fid);
+        shard->num_frames = num_frames;
+
+        // The replacer only tracks the frames in use, so it is set up again for the new range. The evictable pages
+        // are handed to it in the order the old one would have evicted them, then those still pinned
+        ReplacerPolicy policy = shard->replacer.policy;
+        replacer_destroy(&shard->replacer);
+        bool ok = replacer_init(&shard->replacer, policy, shard->first_frame, num_frames);
+        assert(ok); // far less memory than the frames themselves
+        (void)ok;
+        for (size_t j = 0; j < num_ahead; j++) {
+            if (scratch.ahead[j] == NO_FRAME || scratch.ahead[j] >= new_end)
+                continue;
+            BpmPage *page = pool->pages + scratch.ahead[j];
+            replacer_pin(&shard->replacer, scratch.ahead[j], PAGE_KEY(page->file_id, page->id));
+            replacer_unpin(&shard->replacer, scratch.ahead[j]);
+        }
+        for (frame_id_t fid = shard->first_frame; fid < new_end; fid++) {
+            BpmPage *page = pool->pages + fid;
+            if (!pool->free_list[fid] && page->pin_count > 0)
+                replacer_pin(&shard->replacer, fid, PAGE_KEY(page->file_id, page->id));
+        }
+    }
+    pool->pool_size = pool_size;
+    RWLOCK_RDLOCK(&pool->sync_latch);
+    unlock_all_shards(pool);
+    sync_written_pages(scratch.written, num_written);
+    RWLOCK_UNLOCK(&pool->sync_latch);
+
+    free_shard_scratch(&scratch);
     return true;
 }
 
-BpmPage *fetch_bpm_page(page_id_t page_id, BufferPoolManager *bpm) {
-    char pid_str[11];
-    sprintf(pid_str, "%d", page_id);
-    HashEl *entry = hash_find(pid_str, bpm->page_table);
-    frame_id_t fid = 0;
+/*
+ * Stores the frames of SHARD's replacer into AHEAD in eviction order (see replacer_frames_ahead), their number
+ * into NUM_AHEAD, and returns how many frames of SHARD are free or hold a clean unpinned page. Called with the shard's
+ * latch held
+ */
+static size_t clean_frames(BufferPool *pool, BpmShard *shard, frame_id_t *ahead, size_t *num_ahead) {
+    size_t clean = shard->num_free;
+
+    *num_ahead = replacer_frames_ahead(&shard->replacer, ahead, shard->num_frames);
+    for (size_t i = 0; i < *num_ahead; i++)
+        clean += !pool->pages[ahead[i]].is_dirty;
+    return clean;
+}
+
+/*
+ * Writes the dirty unpinned pages of SHARD its replacer would evict first, until CLEAN_TARGET_PCT percent of its frames
+ * are clean or BG_WRITER_BATCH_PAGES were written, with the buffers of SCRATCH, and returns the number of pages written
+ */
+static size_t bg_write_shard(BufferPool *pool, BpmShard *shard, u32 clean_target_pct, ShardScratch *scratch) {
+    pthread_mutex_lock(&shard->latch);
+    size_t num_ahead;
+    size_t clean = clean_frames(pool, shard, scratch->ahead, &num_ahead);
+    size_t target = (shard->num_frames * clean_target_pct + 99) / 100;
+
+    size_t num_dirty = 0;
+    for (size_t i = 0; i < num_ahead && clean + num_dirty < target && num_dirty < BG_WRITER_BATCH_PAGES; i++) {
+        BpmPage *page = pool->pages + scratch->ahead[i];
+        if (page->is_dirty && page->pin_count == 0)
+            scratch->dirty[num_dirty++] = page;
+    }
+    size_t num_written = write_dirty_pages(scratch->dirty, num_dirty, scratch->buffers, scratch->written);
+    // Counted while the pages are seen clean only by those latching the shard, as bg_writer_stats does
+    __atomic_add_fetch(&pool->bg_writer->pages_written, num_dirty, __ATOMIC_RELAXED);
+    RWLOCK_RDLOCK(&pool->sync_latch);
+    pthread_mutex_unlock(&shard->latch);
+    sync_written_pages(scratch->written, num_written);
+    RWLOCK_UNLOCK(&pool->sync_latch);
+    return num_dirty;
+}
+
+static void *bg_writer_loop(void *arg) {
+    BgWriter *writer = (BgWriter *)arg;
+    BufferPool *pool = writer->pool;
+    ShardScratch scratch = new_shard_scratch(pool);
+
+    pthread_mutex_lock(&writer->mutex);
+    while (!writer->stop) {
+        if (!writer->wanted) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += writer->interval_ms / 1000;
+            deadline.tv_nsec += (long)(writer->interval_ms % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&writer->wake_cond, &writer->mutex, &deadline);
+            if (writer->stop)
+                break;
+        }
+        writer->wanted = false;
+        pthread_mutex_unlock(&writer->mutex);
+
+        // Prefetched pages that arrived are unpinned, so they count as clean frames
+        collect_prefetches(pool, false);
+        // A shard that filled a whole batch may still be below its target, so the next round does not wait
+        bool more = false;
+        for (u32 i = 0; i < pool->num_shards; i++) {
+            size_t written = bg_write_shard(pool, pool->shards + i, writer->clean_target_pct, &scratch);
+            more |= written == BG_WRITER_BATCH_PAGES;
+        }
+
+        pthread_mutex_lock(&writer->mutex);
+        writer->wanted |= more;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    free_shard_scratch(&scratch);
+    return NULL;
+}
+
+static void stop_bg_writer(BufferPool *pool) {
+    BgWriter *writer = pool->bg_writer;
+    if (writer == NULL)
+        return;
+
+    // Fetches wake the writer with their shard latched, so once every shard was latched none can still reach it
+    lock_all_shards(pool);
+    pool->bg_writer = NULL;
+    unlock_all_shards(pool);
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->stop = true;
+    pthread_cond_signal(&writer->wake_cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->wake_cond);
+    free(writer);
+}
+
+void set_bg_writer(BufferPoolManager *bpm, u32 clean_target_pct, u32 interval_ms) {
+    BufferPool *pool = bpm->pool;
+    stop_bg_writer(pool);
+    if (clean_target_pct == 0)
+        return;
+
+    BgWriter *writer = (BgWriter *)malloc(sizeof(BgWriter));
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->wake_cond, NULL);
+    writer->pool = pool;
+    writer->stop = false;
+    writer->wanted = false;
+    writer->clean_target_pct = clean_target_pct < 100 ? clean_target_pct : 100;
+    writer->interval_ms = interval_ms > 0 ? interval_ms : 1;
+    writer->started_ns = now_ns();
+    writer->pages_written = 0;
+
+    lock_all_shards(pool);
+    pool->bg_writer = writer;
+    unlock_all_shards(pool);
+    pthread_create(&writer->thread, NULL, bg_writer_loop, writer);
+}
+
+BgWriterStats bg_writer_stats(BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    BgWriterStats stats = {.pages_written = 0, .pages_per_sec = 0, .dirty_evictions = 0, .clean_ratio = 0};
+    frame_id_t *ahead = (frame_id_t *)malloc(sizeof(frame_id_t) * pool->shards[0].capacity);
+    size_t clean = 0;
+
+    // The writer is only freed after it was unset with every shard latched
+    lock_all_shards(pool);
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        size_t num_ahead;
+        clean += clean_frames(pool, pool->shards + i, ahead, &num_ahead);
+    }
+    BgWriter *writer = pool->bg_writer;
+    if (writer != NULL) {
+        stats.pages_written = __atomic_load_n(&writer->pages_written, __ATOMIC_RELAXED);
+        stats.pages_per_sec = stats.pages_written / ((now_ns() - writer->started_ns) / 1e9);
+    }
+    stats.dirty_evictions = __atomic_load_n(&pool->dirty_evictions, __ATOMIC_RELAXED);
+    size_t pool_size = pool->pool_size;
+    unlock_all_shards(pool);
+
+    stats.clean_ratio = pool_size > 0 ? (double)clean / pool_size : 1;
+    free(ahead);
+    return stats;
+}
+
+void free_buffer_pool(BufferPool *pool) {
+    // The reads in flight pin frames and write into the arena
+    collect_prefetches(pool, true);
+    async_io_destroy(&pool->prefetch_io);
+    stop_bg_writer(pool);
+
+    for (u32 i = 0; i < pool->num_shards; i++) {
+        page_table_destroy(&pool->shards[i].page_table);
+        replacer_destroy(&pool->shards[i].replacer);
+        pthread_mutex_destroy(&pool->shards[i].latch);
+        pthread_cond_destroy(&pool->shards[i].io_cond);
+    }
+    munmap(pool->frame_arena, pool->max_pool_size * PAGE_SIZE);
+    pthread_mutex_destroy(&pool->files_mutex);
+    pthread_mutex_destroy(&pool->prefetch_mutex);
+    pthread_rwlock_destroy(&pool->sync_latch);
+    free(pool->pages);
+    free(pool->free_list);
+    free(pool->shards);
+    free(pool->files);
+    free(pool->file_refs);
+    free(pool);
+}
+
+u32 prefetch_bpm_pages(const page_id_t *pids, u32 n, BufferPoolManager *bpm) {
+    BufferPool *pool = bpm->pool;
+    u32 started = 0;
+    pthread_mutex_lock(&pool->prefetch_mutex);
+    if (pool->prefetch_io == NULL)
+        pool->prefetch_io = async_io_init(PREFETCH_DEPTH, true);
+    // Pages whose reads completed since the last prefetch are released first, making room for these
+    reap_prefetches(pool, 0);
+
+    for (u32 i = 0; i < n && pool->prefetch_io->in_flight < PREFETCH_DEPTH; i++) {
+        BpmShard *shard = BPM_SHARD(pool, bpm->file_id, pids[i]);
+        pthread_mutex_lock(&shard->latch);
+        // A page being written back is only read again once its write landed
+        page_key_t key = PAGE_KEY(bpm->file_id, pids[i]);
+        if (page_table_find(&shard->page_table, key) != NO_FRAME || is_written_back(shard, key)) {
+            pthread_mutex_unlock(&shard->latch);
+            continue;
+        }
+        // The pin new_bpm_page leaves on the page is the prefetch's, fetches seeing PAGE_LOADING wait for the read
+        BpmPage *page = new_bpm_page(bpm, shard, pids[i], NULL, NULL);
+        if (page != NULL)
+            page->io_state = PAGE_LOADING;
+        pthread_mutex_unlock(&shard->latch);
+        if (page == NULL)
+            break;
+
+        async_io_read_page(pool->prefetch_io, bpm->disk_manager, pids[i], page->data, page - pool->pages);
+        started++;
+    }
+    async_io_submit(pool->prefetch_io);
+    pthread_mutex_unlock(&pool->prefetch_mutex);
+
+    __atomic_add_fetch(&pool->prefetch_reads, started, __ATOMIC_RELAXED);
+    return started;
+}
+
+// Waits until the prefetch read of PAGE of SHARD, which the caller pinned without holding the shard's latch, is done.
+// Returns true if the page arrived intact, unpins it and returns false otherwise, or if waiting for the read failed
+static bool wait_for_prefetch(BufferPool *pool, BpmShard *shard, BpmPage *page) {
+    bool waited = false;
+    pthread_mutex_lock(&pool->prefetch_mutex);
+    pthread_mutex_lock(&shard->latch);
+    // The page's state is checked again after every completion, which may be that of another read. A wait reaping
+    // nothing failed: the read stays in flight with the frame pinned, as collect_prefetches leaves it
+    while (page->io_state == PAGE_LOADING) {
+        pthread_mutex_unlock(&shard->latch);
+        u32 reaped = reap_prefetches(pool, 1);
+        waited = true;
+        pthread_mutex_lock(&shard->latch);
+        if (reaped == 0)
+            break;
+    }
+    bool loaded = page->io_state == PAGE_LOADED;
+    if (!loaded)
+        release_pin(pool, shard, page - pool->pages);
+    pthread_mutex_unlock(&shard->latch);
+    pthread_mutex_unlock(&pool->prefetch_mutex);
+
+    if (waited)
+        __atomic_add_fetch(&pool->prefetch_waits, 1, __ATOMIC_RELAXED);
+    return loaded;
+}
+
+// Releases the frames of prefetched pages whose reads completed, waiting for one if none did yet. Returns false if no
+// read was in flight, so that no frame could be released
+static bool reap_prefetched_frames(BufferPool *pool) {
+    pthread_mutex_lock(&pool->prefetch_mutex);
+    bool reaped = pool->prefetch_io != NULL && pool->prefetch_io->in_flight > 0 && reap_prefetches(pool, 1) > 0;
+    pthread_mutex_unlock(&pool->prefetch_mutex);
+    return reaped;
+}
+
+BpmPage *fetch_bpm_page(page_id_t page_id, BufferPoolManager *bpm, AccessStrategy *strategy) {
+    BufferPool *pool = bpm->pool;
+    BpmShard *shard = BPM_SHARD(pool, bpm->file_id, page_id);
+    page_key_t key = PAGE_KEY(bpm->file_id, page_id);
+    pthread_mutex_lock(&shard->latch);
+    frame_id_t fid = page_table_find(&shard->page_table, key);
+
+    if (fid != NO_FRAME) {
+        __atomic_add_fetch(&pool->fetch_hits, 1, __ATOMIC_RELAXED);
+        // Every reference counts for the replacer, which must not hand the frame out while it is used either
+        BpmPage *page = pool->pages + fid;
+        page->pin_count++;
+        replacer_pin(&shard->replacer, fid, key);
+        while (page->io_state == PAGE_READING)
+            pthread_cond_wait(&shard->io_cond, &shard->latch);
+        bool failed = page->io_state == PAGE_LOAD_FAILED;
+        if (failed)
+            release_pin(pool, shard, fid);
+        bool prefetching = page->io_state == PAGE_LOADING;
+        pthread_mutex_unlock(&shard->latch);
+        if (failed || (prefetching && !wait_for_prefetch(pool, shard, page)))
+            return NULL;
+        return page;
+    }
+
+    // The frame is published before the page is read, with the shard released, so that hits on the shard do not wait
+    // for the read. Fetches of the page wait for it on the shard's io_cond instead
+    u8 victim[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+    WriteBack write_back;
+    write_back.data = victim;
+    write_back.queued = false;
+    BpmPage *newp = new_bpm_page(bpm, shard, page_id, strategy, &write_back);
+    if (newp == NULL) {
+        pthread_mutex_unlock(&shard->latch);
+        // The frames may be pinned by prefetches that completed but were not reaped yet
+        if (reap_prefetched_frames(pool))
+            return fetch_bpm_page(page_id, bpm, strategy);
+        return NULL;
+    }
+    fid = newp - pool->pages;
+    newp->io_state = PAGE_READING;
+    __atomic_add_fetch(&pool->fetch_misses, 1, __ATOMIC_RELAXED);
+    // The page may have been evicted dirty by a fetch still writing it back. That fetch does not wait for another
+    // write back, having none of its own left by then, so neither does this one before waiting
+    if (write_back.queued) {
+        pthread_mutex_unlock(&shard->latch);
+        finish_write_back(shard, &write_back);
+        pthread_mutex_lock(&shard->latch);
+    }
+    while (is_written_back(shard, key))
+        pthread_cond_wait(&shard->io_cond, &shard->latch);
+    pthread_mutex_unlock(&shard->latch);
+
+    read_page_into(page_id, bpm->disk_manager, newp->data);
+    bool intact = verify_page_checksum(bpm->disk_manager, page_id, newp->data);
+    if (!intact) {
+        __atomic_add_fetch(&pool->checksum_failures, 1, __ATOMIC_RELAXED);
+        fprintf(stderr, "Checksum mismatch in page %u of '%s'\n", page_id, bpm->disk_manager->table_name);
+    }
 
-    if (entry) {
-        fid = *(frame_id_t *)entry->data;
-        bpm->pages[fid].pin_count++;
-        return bpm->pages + fid;
-    } else {
-        BpmPage *newp = new_bpm_page(bpm, page_id); // TODO: handle NULL return (aka no space)
-        fid = *(frame_id_t *)hash_find(pid_str, bpm->page_table)->data;
-        bpm->pages[fid].pin_count++;
-        memcpy(newp->data, read_page(page_id, bpm->disk_manager), PAGE_SIZE);
-        return newp;
+    // A corrupted page leaves the buffer pool with the last pin of the fetches that waited for it
+    pthread_mutex_lock(&shard->latch);
+    newp->io_state = intact ? PAGE_LOADED : PAGE_LOAD_FAILED;
+    pthread_cond_broadcast(&shard->io_cond);
+    if (!intact) {
+        release_pin(pool, shard, fid);
+        newp = NULL;
     }
+    pthread_mutex_unlock(&shard->latch);
+    return newp;
 }
@@ -6,84 +6,103 @@
 
 ClockReplacer *clock_replacer_init(size_t capacity) {
     ClockReplacer *replacer = (ClockReplacer *)malloc(sizeof(ClockReplacer));
-    RWLOCK latch;
-    RWLOCK_INIT(&latch);
+    if (!clock_replacer_init_frames(replacer, 0, capacity)) {
+        free(replacer);
+        return NULL;
+    }
+    return replacer;
+}
 
-    replacer->hand = NULL;
-    replacer->frames = circular_list_init(capacity);
-    replacer->num_pages = capacity;
-    replacer->frame_table = init_hash(capacity);
-    replacer->latch = latch;
+bool clock_replacer_init_frames(ClockReplacer *replacer, frame_id_t first_frame, size_t capacity) {
+    replacer->frames = (u8 *)calloc(capacity > 0 ? capacity : 1, sizeof(u8));
+    if (replacer->frames == NULL)
+        return false;
 
-    return replacer;
+    replacer->first_frame = first_frame;
+    replacer->num_pages = capacity;
+    replacer->size = 0;
+    replacer->hand = 0;
+    RWLOCK_INIT(&replacer->latch);
+    return true;
 }
 
-static char *frame_to_str(frame_id_t frame_id) {
-    char *str = (char *)malloc(sizeof(char) * 11);
-    snprintf(str, 11, "%d", frame_id);
-    return str;
+void clock_replacer_destroy(ClockReplacer *replacer) {
+    free(replacer->frames);
+    replacer->frames = NULL;
+    pthread_rwlock_destroy(&replacer->latch);
 }
 
 frame_id_t evict(ClockReplacer *replacer) {
     RWLOCK_WRLOCK(&replacer->latch);
-    if (replacer->frames->size == 0)
+    if (replacer->size == 0) {
+        RWLOCK_UNLOCK(&replacer->latch);
         return UINT32_MAX;
-    if (replacer->hand == NULL)
-        replacer->hand = replacer->frames->head;
+    }
 
-    for (size_t i = 0; i < replacer->frames->size; i++) {
-        char *curr_frame = (char *)replacer->hand->value;
-        HashEl *frame_info = hash_find(curr_frame, replacer->frame_table);
+    // One sweep may only clear reference bits, so the hand gets two
+    for (size_t i = 0; i < 2 * replacer->num_pages; i++) {
+        size_t idx = replacer->hand;
+        u8 *frame = replacer->frames + idx;
+        replacer->hand = idx + 1 < replacer->num_pages ? idx + 1 : 0;
 
-        if (*(bool *)frame_info->data == true) {
-            bool *ref_bit = (bool *)malloc(sizeof(bool));
-            *ref_bit = false;
-            HashInsertArgs in_args = {.key = curr_frame, .data = ref_bit, .ht = replacer->frame_table};
-            hash_insert(&in_args);
-            replacer->hand = circular_list_next(replacer->hand, replacer->frames);
+        if (!(*frame & CLOCK_EVICTABLE))
+            continue;
+        if (*frame & CLOCK_REFERENCED) {
+            *frame &= ~CLOCK_REFERENCED;
             continue;
-        } else {
-            frame_id_t frame_id = atoi(frame_info->key);
-            HashRemoveArgs rm_args = {.key = curr_frame, .ht = replacer->frame_table, .success_out = NULL};
-            hash_remove(&rm_args);
-            circular_list_remove(curr_frame, replacer->frames);
-            RWLOCK_UNLOCK(&replacer->latch);
-            return frame_id;
         }
+        *frame = 0;
+        replacer->size--;
+        RWLOCK_UNLOCK(&replacer->latch);
+        return replacer->first_frame + idx;
     }
 
     RWLOCK_UNLOCK(&replacer->latch);
     return UINT32_MAX;
 }
 
+// Index of FRAME_ID in REPLACER's frames, or the replacer's capacity if it does not track the frame
+static size_t frame_index(frame_id_t frame_id, ClockReplacer *replacer) {
+    size_t idx = (size_t)frame_id - replacer->first_frame;
+    return frame_id >= replacer->first_frame && idx < replacer->num_pages ? idx : replacer->num_pages;
+}
+
 void clock_replacer_unpin(frame_id_t *frame_id, ClockReplacer *replacer) {
     RWLOCK_WRLOCK(&replacer->latch);
-    char *frame_str = frame_to_str(*frame_id);
-
-    void *node = circular_list_insert(frame_str, replacer->frames);
-    if (node == NULL) {
-        RWLOCK_UNLOCK(&replacer->latch);
-        return;
+    size_t idx = frame_index(*frame_id, replacer);
+    if (idx < replacer->num_pages) {
+        // A frame already in the replacer only gets its reference bit set again
+        replacer->size += !(replacer->frames[idx] & CLOCK_EVICTABLE);
+        replacer->frames[idx] = CLOCK_EVICTABLE | CLOCK_REFERENCED;
     }
-
-    bool *unpinned = (bool *)malloc(sizeof(bool));
-    *unpinned = true;
-    HashInsertArgs in_args = {.key = frame_str, .data = unpinned, .ht = replacer->frame_table};
-    hash_insert(&in_args);
     RWLOCK_UNLOCK(&replacer->latch);
 }
 
 void clock_replacer_pin(frame_id_t *frame_id, ClockReplacer *replacer) {
     RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(*frame_id, replacer);
+    if (idx < replacer->num_pages && (replacer->frames[idx] & CLOCK_EVICTABLE)) {
+        replacer->frames[idx] = 0;
+        replacer->size--;
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+}
 
-    char *frame_str = frame_to_str(*frame_id);
-    bool *ok = (bool *)malloc(sizeof(bool));
-    HashRemoveArgs rm_args = {.key = frame_str, .ht = replacer->frame_table, .success_out = ok};
-    hash_remove(&rm_args);
-    if (ok) {
-        circular_list_remove(frame_str, replacer->frames);
-        free(ok);
+size_t clock_replacer_frames_ahead(ClockReplacer *replacer, frame_id_t *out, size_t max) {
+    RWLOCK_RDLOCK(&replacer->latch);
+    size_t count = 0;
+    for (size_t i = 0; i < replacer->num_pages && count < max && count < replacer->size; i++) {
+        size_t idx = (replacer->hand + i) % replacer->num_pages;
+        if (replacer->frames[idx] & CLOCK_EVICTABLE)
+            out[count++] = replacer->first_frame + idx;
     }
+    RWLOCK_UNLOCK(&replacer->latch);
+    return count;
+}
 
+size_t clock_replacer_size(ClockReplacer *replacer) {
+    RWLOCK_RDLOCK(&replacer->latch);
+    size_t size = replacer->size;
     RWLOCK_UNLOCK(&replacer->latch);
+    return size;
 }
@@ -1,77 +1,740 @@
 #include "../../include/disk/disk_manager.h"
+#include "../../include/disk/heapfile.h"
+#include "../../include/disk/page_directory.h"
+#include "../../include/utils/crc32c.h"
 #include "../../include/utils/serialize.h"
 #include "../../include/utils/shared.h"
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
-int table_file(const char *table_name) {
-    opendir(DBFILES_DIR);
-    if (ENOENT == errno) {
-        mkdir(DBFILES_DIR, 0700);
-        opendir(DBFILES_DIR);
+// Process-wide registry of open table files, mapping table names and segments to their shared descriptors
+typedef struct TableFd {
+    char *table_name;
+    u32 segment;
+    int fd;
+    int refs;     // number of disk managers currently using the descriptor
+    bool removed; // table file was removed, so the descriptor is only kept open for its remaining users
+    struct TableFd *next;
+} TableFd;
+
+static TableFd *fd_registry = NULL;
+static RWLOCK fd_registry_latch = PTHREAD_RWLOCK_INITIALIZER;
+
+static void segment_path(const char *table_name, u32 segment, char *path) {
+    if (segment == 0)
+        snprintf(path, PATH_MAX, "%s/%s.db", DBFILES_DIR, table_name);
+    else
+        snprintf(path, PATH_MAX, "%s/%s.db.%u", DBFILES_DIR, table_name, segment);
+}
+
+static void table_path(const char *table_name, char *path) { segment_path(table_name, 0, path); }
+
+// Opens segment SEGMENT of TABLE_NAME read-write, creating it only if EXTRA_FLAGS has O_CREAT
+static int open_segment_file(const char *table_name, u32 segment, int extra_flags) {
+    if ((extra_flags & O_CREAT) && mkdir(DBFILES_DIR, 0700) == -1 && errno != EEXIST)
+        return -1;
+
+    char path[PATH_MAX];
+    segment_path(table_name, segment, path);
+    int fd = open(path, O_RDWR | extra_flags, 0644);
+    return fd;
+}
+
+static int open_table_file(const char *table_name, int extra_flags) {
+    return open_segment_file(table_name, 0, extra_flags);
+}
+
+bool table_exists(const char *table_name) {
+    char path[PATH_MAX];
+    table_path(table_name, path);
+    return access(path, F_OK) == 0;
+}
+
+int table_file(const char *table_name) { return open_table_file(table_name, O_CREAT); }
+
+int acquire_table_fd(const char *table_name) { return acquire_segment_fd(table_name, 0, true); }
+
+int acquire_segment_fd(const char *table_name, u32 segment, bool create) {
+    RWLOCK_WRLOCK(&fd_registry_latch);
+    for (TableFd *entry = fd_registry; entry != NULL; entry = entry->next) {
+        if (!entry->removed && entry->segment == segment && strcmp(entry->table_name, table_name) == 0) {
+            entry->refs++;
+            RWLOCK_UNLOCK(&fd_registry_latch);
+            return entry->fd;
+        }
     }
 
-    char path[40];
-    sprintf(path, "%s/%s.db", DBFILES_DIR, table_name);
-    int fd = open(path, O_CREAT | O_RDWR, 0644);
+    int fd = open_segment_file(table_name, segment, create ? O_CREAT : 0);
+    if (fd == -1) {
+        RWLOCK_UNLOCK(&fd_registry_latch);
+        return -1;
+    }
+    TableFd *entry = (TableFd *)malloc(sizeof(TableFd));
+    entry->table_name = strdup(table_name);
+    entry->segment = segment;
+    entry->fd = fd;
+    entry->refs = 1;
+    entry->removed = false;
+    entry->next = fd_registry;
+    fd_registry = entry;
+    RWLOCK_UNLOCK(&fd_registry_latch);
     return fd;
 }
 
-void write_page(page_id_t page_id, DiskManager *disk_manager, void *data) {
-    char pid_str[11];
-    sprintf(pid_str, "%d", page_id);
+void release_table_fd(int fd) {
+    RWLOCK_WRLOCK(&fd_registry_latch);
+    TableFd **link = &fd_registry;
+    while (*link != NULL && (*link)->fd != fd)
+        link = &(*link)->next;
+
+    TableFd *entry = *link;
+    if (entry != NULL && --entry->refs == 0) {
+        close(entry->fd);
+        *link = entry->next;
+        free(entry->table_name);
+        free(entry);
+    }
+    RWLOCK_UNLOCK(&fd_registry_latch);
+}
+
+DiskManager *new_disk_manager(const char *table_name) {
+    DiskManager *disk_mgr = (DiskManager *)calloc(1, sizeof(DiskManager));
+    disk_mgr->table_name = strdup(table_name);
+    disk_mgr->fd = acquire_table_fd(table_name);
+    disk_mgr->num_segments = 1;
+    pthread_mutex_init(&disk_mgr->segments_mutex, NULL);
+    disk_mgr->direct_fd = -1;
+    disk_mgr->readahead_max_pages = READAHEAD_MAX_PAGES;
+    pthread_mutex_init(&disk_mgr->readahead.mutex, NULL);
+    RWLOCK_INIT(&disk_mgr->latch);
+    return disk_mgr;
+}
+
+struct SyncWorker {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t stop_cond;
+    bool stop;
+};
+
+/*
+ * Opens segment SEGMENT (> 0) of DISK_MANAGER, creating its file with CREATE, and its O_DIRECT descriptor too with
+ * DIRECT, returning the requested one
+ */
+static int open_segment(DiskManager *disk_manager, u32 segment, bool direct, bool create) {
+    pthread_mutex_lock(&disk_manager->segments_mutex);
+    if (disk_manager->segments == NULL) {
+        Segment *segments = (Segment *)malloc((MAX_TABLE_SEGMENTS - 1) * sizeof(Segment));
+        for (u32 i = 0; i < MAX_TABLE_SEGMENTS - 1; i++)
+            segments[i] = (Segment){.fd = -1, .direct_fd = -1};
+        __atomic_store_n(&disk_manager->segments, segments, __ATOMIC_RELEASE);
+    }
+
+    Segment *seg = disk_manager->segments + segment - 1;
+    if (seg->fd == -1) {
+        __atomic_store_n(&seg->fd, acquire_segment_fd(disk_manager->table_name, segment, create), __ATOMIC_RELEASE);
+        if (seg->fd != -1 && segment >= disk_manager->num_segments)
+            __atomic_store_n(&disk_manager->num_segments, segment + 1, __ATOMIC_RELEASE);
+    }
+    if (direct && seg->fd != -1 && seg->direct_fd == -1)
+        __atomic_store_n(&seg->direct_fd, open_segment_file(disk_manager->table_name, segment, O_DIRECT),
+                         __ATOMIC_RELEASE);
+
+    int fd = direct ? seg->direct_fd : seg->fd;
+    pthread_mutex_unlock(&disk_manager->segments_mutex);
+    return fd;
+}
+
+/*
+ * Returns the descriptor of the segment file holding PAGE_ID, the O_DIRECT one with DIRECT, and stores the page's
+ * offset within that file in OFFSET. Returns -1 if the segment file can not be opened or doesn't exist yet
+ */
+static int segment_fd(DiskManager *disk_manager, page_id_t page_id, bool direct, off_t *offset) {
+    u32 segment = PAGE_SEGMENT(page_id);
+    *offset = PAGE_SEGMENT_OFFSET(page_id);
+    if (segment == 0)
+        return direct ? disk_manager->direct_fd : disk_manager->fd;
+
+    Segment *segments = __atomic_load_n(&disk_manager->segments, __ATOMIC_ACQUIRE);
+    if (segments != NULL) {
+        Segment *seg = segments + segment - 1;
+        int fd = __atomic_load_n(direct ? &seg->direct_fd : &seg->fd, __ATOMIC_ACQUIRE);
+        if (fd != -1)
+            return fd;
+    }
+    return open_segment(disk_manager, segment, direct, false);
+}
+
+// Returns the buffered descriptor of the already opened segment SEGMENT, -1 if it is not open
+static int opened_segment_fd(DiskManager *disk_manager, u32 segment) {
+    if (segment == 0)
+        return disk_manager->fd;
+    Segment *segments = __atomic_load_n(&disk_manager->segments, __ATOMIC_ACQUIRE);
+    return segments == NULL ? -1 : __atomic_load_n(&segments[segment - 1].fd, __ATOMIC_ACQUIRE);
+}
+
+// Syncs the opened segments in [FIRST_SEGMENT, LAST_SEGMENT], with fdatasync if DATASYNC (which still syncs a change
+// of the file size, as reading the data back needs it) and fsync otherwise
+static int sync_segment_range(DiskManager *disk_manager, u32 first_segment, u32 last_segment, bool datasync) {
+    int r = 0;
+    for (u32 segment = first_segment; segment <= last_segment; segment++) {
+        int fd = opened_segment_fd(disk_manager, segment);
+        if (fd != -1 && (datasync ? fdatasync(fd) : fsync(fd)) == -1)
+            r = -1;
+    }
+    return r;
+}
+
+static int sync_segments(DiskManager *disk_manager, bool datasync) {
+    u32 num_segments = __atomic_load_n(&disk_manager->num_segments, __ATOMIC_ACQUIRE);
+    return sync_segment_range(disk_manager, 0, num_segments == 0 ? 0 : num_segments - 1, datasync);
+}
+
+// Applies posix_fadvise ADVICE to the whole of every opened segment
+static void advise_segments(DiskManager *disk_manager, int advice) {
+    u32 num_segments = __atomic_load_n(&disk_manager->num_segments, __ATOMIC_ACQUIRE);
+    for (u32 segment = 0; segment < num_segments || segment == 0; segment++) {
+        int fd = opened_segment_fd(disk_manager, segment);
+        if (fd != -1)
+            posix_fadvise(fd, 0, 0, advice);
+    }
+}
+
+// Applies posix_fadvise ADVICE to pages [FIRST_PAGE_ID, FIRST_PAGE_ID + COUNT), segment by segment
+static void advise_pages(DiskManager *disk_manager, page_id_t first_page_id, u32 count, int advice) {
+    while (count > 0) {
+        u32 n = TABLE_SEGMENT_PAGES - first_page_id % TABLE_SEGMENT_PAGES;
+        if (n > count)
+            n = count;
+        off_t offset;
+        int fd = segment_fd(disk_manager, first_page_id, false, &offset);
+        if (fd != -1)
+            posix_fadvise(fd, offset, (off_t)n * PAGE_SIZE, advice);
+        first_page_id += n;
+        count -= n;
+    }
+}
+
+int apply_sync_policy(DiskManager *disk_manager, page_id_t first_page_id, u32 count) {
+    if (disk_manager->sync_policy == SYNC_ALWAYS)
+        return sync_segment_range(disk_manager, PAGE_SEGMENT(first_page_id), PAGE_SEGMENT(first_page_id + count - 1),
+                                  false);
+
+    __atomic_store_n(&disk_manager->has_unsynced_writes, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+bool set_direct_io(DiskManager *disk_manager, bool enable) {
+    __atomic_store_n(&disk_manager->direct_io, false, __ATOMIC_RELEASE);
+    if (disk_manager->direct_fd != -1) {
+        close(disk_manager->direct_fd);
+        disk_manager->direct_fd = -1;
+    }
+    pthread_mutex_lock(&disk_manager->segments_mutex);
+    for (u32 segment = 1; disk_manager->segments != NULL && segment < disk_manager->num_segments; segment++) {
+        Segment *seg = disk_manager->segments + segment - 1;
+        if (seg->direct_fd != -1) {
+            close(seg->direct_fd);
+            __atomic_store_n(&seg->direct_fd, -1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&disk_manager->segments_mutex);
+    if (!enable)
+        return false;
+
+    // Only segment 0 is opened and probed here, the other segments get their O_DIRECT descriptors on first access
+
+    // tmpfs and some other filesystems refuse O_DIRECT already on open
+    int fd = open_table_file(disk_manager->table_name, O_DIRECT);
+    if (fd == -1)
+        return false;
+
+    // Others only reject the actual transfers, so probe with a read of the first page
+    u8 *probe = NULL;
+    if (posix_memalign((void **)&probe, PAGE_SIZE, PAGE_SIZE) != 0) {
+        close(fd);
+        return false;
+    }
+    ssize_t r = pread(fd, probe, PAGE_SIZE, 0);
+    free(probe);
+    if (r == -1) {
+        close(fd);
+        return false;
+    }
+
+    disk_manager->direct_fd = fd;
+    __atomic_store_n(&disk_manager->direct_io, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+int page_fd(DiskManager *disk_manager, page_id_t page_id, const void *buf, off_t *offset) {
+    if (__atomic_load_n(&disk_manager->direct_io, __ATOMIC_ACQUIRE) && IS_PAGE_ALIGNED(buf)) {
+        int fd = segment_fd(disk_manager, page_id, true, offset);
+        if (fd != -1)
+            return fd;
+    }
+    return segment_fd(disk_manager, page_id, false, offset);
+}
+
+u64 table_num_pages(DiskManager *disk_manager) {
+    // Segments are allocated in order, so the last one is followed by the first missing segment file
+    u32 last = 0;
+    char path[PATH_MAX];
+    for (;;) {
+        segment_path(disk_manager->table_name, last + 1, path);
+        if (last + 1 == MAX_TABLE_SEGMENTS || access(path, F_OK) != 0)
+            break;
+        last++;
+    }
+
+    struct stat st;
+    segment_path(disk_manager->table_name, last, path);
+    if (stat(path, &st) == -1)
+        return 0;
+    return (u64)last * TABLE_SEGMENT_PAGES + st.st_size / PAGE_SIZE;
+}
+
+bool allocate_table_pages(DiskManager *disk_manager, page_id_t first_page_id, u32 count) {
+    while (count > 0) {
+        u32 n = TABLE_SEGMENT_PAGES - first_page_id % TABLE_SEGMENT_PAGES;
+        if (n > count)
+            n = count;
+        u32 segment = PAGE_SEGMENT(first_page_id);
+        off_t offset = PAGE_SEGMENT_OFFSET(first_page_id);
+        // The only place creating segments, so that reads past the end never leave empty ones for table_num_pages
+        int fd = segment == 0 ? disk_manager->fd : open_segment(disk_manager, segment, false, true);
+        if (fd == -1)
+            return false;
+
+        off_t len = (off_t)n * PAGE_SIZE;
+        if (fallocate(fd, 0, offset, len) != 0) {
+            if (errno != EOPNOTSUPP && errno != ENOSYS)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) == -1 || (st.st_size < offset + len && ftruncate(fd, offset + len) != 0))
+                return false;
+        }
+        first_page_id += n;
+        count -= n;
+    }
+    return true;
+}
+
+/*
+ * Feeds a read of COUNT pages starting at FIRST_PAGE_ID to DISK_MANAGER's sequential read detector (see ReadAhead),
+ * hinting the OS about the pages a sequential reader is going to ask for next
+ */
+static void track_reads(DiskManager *disk_manager, page_id_t first_page_id, u32 count) {
+    if (disk_manager->readahead_max_pages == 0 || __atomic_load_n(&disk_manager->direct_io, __ATOMIC_ACQUIRE))
+        return;
+    ReadAhead *ra = &disk_manager->readahead;
+    // Concurrent readers of the same disk manager don't form a sequential pattern anyway, skipping a read is harmless
+    if (pthread_mutex_trylock(&ra->mutex) != 0)
+        return;
+
+    if (first_page_id == ra->next_pid && ra->run_length > 0) {
+        ra->run_length += count;
+    } else {
+        if (ra->sequential) {
+            advise_segments(disk_manager, POSIX_FADV_NORMAL);
+            ra->sequential = false;
+        }
+        ra->run_length = count;
+        ra->window_end = 0;
+        ra->window = READAHEAD_MIN_PAGES < disk_manager->readahead_max_pages ? READAHEAD_MIN_PAGES
+                                                                              : disk_manager->readahead_max_pages;
+    }
+    ra->next_pid = first_page_id + count;
+
+    if (ra->run_length >= READAHEAD_SCAN_PAGES && !ra->sequential) {
+        advise_segments(disk_manager, POSIX_FADV_SEQUENTIAL);
+        ra->sequential = true;
+    }
+    // The next window is hinted once the reader got halfway into the previous one, keeping the hints ahead of it
+    if (ra->run_length >= READAHEAD_TRIGGER && ra->window_end < ra->next_pid + ra->window / 2) {
+        page_id_t start = ra->window_end > ra->next_pid ? ra->window_end : ra->next_pid;
+        advise_pages(disk_manager, start, ra->window, POSIX_FADV_WILLNEED);
+        ra->window_end = start + ra->window;
+        if (ra->window * 2 <= disk_manager->readahead_max_pages)
+            ra->window *= 2;
+    }
+    pthread_mutex_unlock(&ra->mutex);
+}
+
+// Aligned stand-in for unaligned caller buffers (e.g. on the stack) when transferring a page with O_DIRECT
+static __thread u8 bounce_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
 
-    int fd = table_file(disk_manager->table_name);
-    int l = lseek(fd, page_id * PAGE_SIZE, SEEK_SET);
-    int w = write(fd, data, PAGE_SIZE);
-    int f = fsync(fd);
+/*
+ * Transfers page PAGE_ID between BUF and its segment file, through the O_DIRECT descriptor if direct I/O is enabled.
+ * Falls back to buffered I/O for good if the filesystem rejects a direct transfer
+ */
+static ssize_t page_io(DiskManager *disk_manager, page_id_t page_id, void *buf, bool is_write) {
+    off_t offset;
+    if (__atomic_load_n(&disk_manager->direct_io, __ATOMIC_ACQUIRE)) {
+        int direct_fd = segment_fd(disk_manager, page_id, true, &offset);
+        void *direct_buf = IS_PAGE_ALIGNED(buf) ? buf : bounce_page;
+        if (is_write && direct_buf != buf)
+            memcpy(bounce_page, buf, PAGE_SIZE);
 
-    if (l == -1 || w == -1 || f == -1) {
+        ssize_t r = -1;
+        errno = EINVAL;
+        if (direct_fd != -1)
+            r = is_write ? pwrite(direct_fd, direct_buf, PAGE_SIZE, offset)
+                         : pread(direct_fd, direct_buf, PAGE_SIZE, offset);
+        if (r != -1 || errno != EINVAL) {
+            if (!is_write && r > 0 && direct_buf != buf)
+                memcpy(buf, bounce_page, r);
+            return r;
+        }
+        __atomic_store_n(&disk_manager->direct_io, false, __ATOMIC_RELEASE);
+    }
+
+    int fd = segment_fd(disk_manager, page_id, false, &offset);
+    if (fd == -1)
+        return -1;
+    return is_write ? pwrite(fd, buf, PAGE_SIZE, offset) : pread(fd, buf, PAGE_SIZE, offset);
+}
+
+int page_checksum_offset(PageType page_type, page_id_t page_id) {
+    switch (page_type) {
+    case HEAP_PAGE:
+        return IS_DIRECTORY_PAGE(page_id) || page_id == TABLE_SCHEMA_PAGE ? -1 : PAGE_CHECKSUM_OFFSET;
+    case BTREE_INDEX_PAGE:
+        return page_id == BTREE_METADATA_PAGE_ID ? -1 : INDEX_CHECKSUM_OFFSET;
+    case INVALID:
+        break;
+    }
+    return -1;
+}
+
+u32 page_checksum(const u8 *page, u16 checksum_offset) {
+    static const u8 zero_field[PAGE_CHECKSUM_SIZE] = {0};
+    u32 crc = crc32c(page, checksum_offset);
+    crc = crc32c_update(crc, zero_field, PAGE_CHECKSUM_SIZE);
+    return crc32c_update(crc, page + checksum_offset + PAGE_CHECKSUM_SIZE,
+                         PAGE_SIZE - checksum_offset - PAGE_CHECKSUM_SIZE);
+}
+
+void set_page_checksum(DiskManager *disk_manager, page_id_t page_id, u8 *page) {
+    int offset = page_checksum_offset(disk_manager->page_type, page_id);
+    if (offset != -1)
+        encode_uint32(page_checksum(page, offset), page + offset);
+}
+
+bool verify_page_checksum(DiskManager *disk_manager, page_id_t page_id, const u8 *page) {
+    int offset = page_checksum_offset(disk_manager->page_type, page_id);
+    if (offset == -1)
+        return true;
+
+    u32 stored = decode_uint32(page + offset);
+    if (stored == 0) {
+        // Allocated (e.g. fallocated) pages that were never written hold no checksum yet
+        size_t i = 0;
+        while (i < PAGE_SIZE && page[i] == 0)
+            i++;
+        if (i == PAGE_SIZE)
+            return true;
+    }
+    return stored == page_checksum(page, offset);
+}
+
+void write_page(page_id_t page_id, DiskManager *disk_manager, void *data) {
+    set_page_checksum(disk_manager, page_id, (u8 *)data);
+    ssize_t w = page_io(disk_manager, page_id, data, true);
+    int f = apply_sync_policy(disk_manager, page_id, 1);
+
+    if (w == -1 || f == -1) {
         printf("I/O error while writing page\n");
         return;
     }
 }
 
-uint8_t *read_page(page_id_t page_id, DiskManager *disk_manager) {
-    uint8_t *page = (uint8_t *)malloc(PAGE_SIZE);
+void write_bytes(off_t offset, DiskManager *disk_manager, const void *data, size_t size) {
+    off_t page_offset;
+    int fd = segment_fd(disk_manager, offset / PAGE_SIZE, false, &page_offset);
+    ssize_t w = fd == -1 ? -1 : pwrite(fd, data, size, page_offset + offset % PAGE_SIZE);
+    int f = apply_sync_policy(disk_manager, offset / PAGE_SIZE, 1);
 
-    int fd = table_file(disk_manager->table_name);
+    if (w == -1 || f == -1)
+        printf("I/O error while writing page\n");
+}
 
-    int offset = page_id * PAGE_SIZE;
-    off_t fsize = lseek(fd, 0, SEEK_END);
-    if (offset >= fsize) {
-        fprintf(stderr, "I/O error, reading past EOF\n");
+// Number of buffers passed to a single preadv/pwritev call, well below IOV_MAX
+#define PAGE_RUN_BATCH 256
+
+/*
+ * Transfers the buffers of IOVECS to or from consecutive bytes of FD starting at OFFSET, retrying partial transfers.
+ * Returns the number of bytes transferred, which is less than requested only when a read reaches EOF, or -1
+ */
+static ssize_t page_run_io(int fd, const struct iovec *iovecs, u32 count, off_t offset, bool is_write) {
+    struct iovec batch[PAGE_RUN_BATCH];
+    ssize_t total = 0;
+    u32 next = 0;
+    int n = 0;
+
+    while (next < count || n > 0) {
+        while (n < PAGE_RUN_BATCH && next < count)
+            batch[n++] = iovecs[next++];
+
+        ssize_t r = is_write ? pwritev(fd, batch, n, offset + total) : preadv(fd, batch, n, offset + total);
+        if (r == -1) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (r == 0)
+            break;
+        total += r;
+
+        // Drop the buffers that were fully transferred and trim the one the transfer stopped in
+        int done = 0;
+        while (done < n && (size_t)r >= batch[done].iov_len)
+            r -= batch[done++].iov_len;
+        if (done < n) {
+            batch[done].iov_base = (u8 *)batch[done].iov_base + r;
+            batch[done].iov_len -= r;
+        }
+        memmove(batch, batch + done, (n - done) * sizeof(struct iovec));
+        n -= done;
+    }
+    return total;
+}
+
+/*
+ * Vectored counterpart of page_io for a run of COUNT pages within a single segment. Runs with any unaligned buffer go
+ * through the buffered descriptor, since bouncing them would cost the copy the vectored call is meant to save
+ */
+static ssize_t segment_run_io(DiskManager *disk_manager, const struct iovec *iovecs, u32 count,
+                              page_id_t first_page_id, bool is_write) {
+    off_t offset;
+    bool aligned = __atomic_load_n(&disk_manager->direct_io, __ATOMIC_ACQUIRE);
+    for (u32 i = 0; aligned && i < count; i++)
+        aligned = IS_PAGE_ALIGNED(iovecs[i].iov_base) && iovecs[i].iov_len % PAGE_SIZE == 0;
+
+    if (aligned) {
+        int direct_fd = segment_fd(disk_manager, first_page_id, true, &offset);
+        ssize_t r = -1;
+        errno = EINVAL;
+        if (direct_fd != -1)
+            r = page_run_io(direct_fd, iovecs, count, offset, is_write);
+        if (r != -1 || errno != EINVAL)
+            return r;
+        __atomic_store_n(&disk_manager->direct_io, false, __ATOMIC_RELEASE);
+    }
+
+    int fd = segment_fd(disk_manager, first_page_id, false, &offset);
+    if (fd == -1)
+        return -1;
+    return page_run_io(fd, iovecs, count, offset, is_write);
+}
+
+// Splits a run of COUNT pages (one buffer of IOVECS each) at segment boundaries, see segment_run_io
+static ssize_t page_run_io_direct(DiskManager *disk_manager, const struct iovec *iovecs, u32 count,
+                                  page_id_t first_page_id, bool is_write) {
+    ssize_t total = 0;
+    while (count > 0) {
+        u32 n = TABLE_SEGMENT_PAGES - first_page_id % TABLE_SEGMENT_PAGES;
+        if (n > count)
+            n = count;
+        ssize_t r = segment_run_io(disk_manager, iovecs, n, first_page_id, is_write);
+        if (r == -1)
+            return -1;
+        total += r;
+        if (r < (ssize_t)n * PAGE_SIZE) // end of the table
+            break;
+        iovecs += n;
+        count -= n;
+        first_page_id += n;
+    }
+    return total;
+}
+
+// Stamps the checksums of a run of pages and writes it, leaving the sync policy to the caller
+static ssize_t write_page_run(page_id_t first_page_id, u32 count, DiskManager *disk_manager,
+                              const struct iovec *iovecs) {
+    for (u32 i = 0; i < count; i++)
+        set_page_checksum(disk_manager, first_page_id + i, (u8 *)iovecs[i].iov_base);
+    return page_run_io_direct(disk_manager, iovecs, count, first_page_id, true);
+}
+
+void write_pages(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs) {
+    ssize_t w = write_page_run(first_page_id, count, disk_manager, iovecs);
+    int f = apply_sync_policy(disk_manager, first_page_id, count);
+
+    if (w == -1 || f == -1)
+        printf("I/O error while writing pages\n");
+}
+
+void write_pages_nosync(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs) {
+    ssize_t w = write_page_run(first_page_id, count, disk_manager, iovecs);
+    // Still synced on close or by the periodic worker if the caller never gets to it
+    __atomic_store_n(&disk_manager->has_unsynced_writes, true, __ATOMIC_RELEASE);
+
+    if (w == -1)
+        printf("I/O error while writing pages\n");
+}
+
+u32 read_pages(page_id_t first_page_id, u32 count, DiskManager *disk_manager, const struct iovec *iovecs) {
+    ssize_t r = page_run_io_direct(disk_manager, iovecs, count, first_page_id, false);
+
+    if (r == -1) {
+        fprintf(stderr, "I/O error while reading specified pages\n");
         exit(1);
     }
+    track_reads(disk_manager, first_page_id, count);
+    return r / PAGE_SIZE;
+}
+
+void sync_table_file(DiskManager *disk_manager) {
+    __atomic_store_n(&disk_manager->has_unsynced_writes, false, __ATOMIC_RELEASE);
+    if (sync_segments(disk_manager, false) == -1)
+        printf("I/O error while syncing table file\n");
+}
+
+static void *sync_worker_loop(void *arg) {
+    DiskManager *disk_manager = (DiskManager *)arg;
+    SyncWorker *worker = disk_manager->sync_worker;
+
+    pthread_mutex_lock(&worker->mutex);
+    while (!worker->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += disk_manager->sync_interval_ms / 1000;
+        deadline.tv_nsec += (long)(disk_manager->sync_interval_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&worker->stop_cond, &worker->mutex, &deadline);
+
+        if (__atomic_exchange_n(&disk_manager->has_unsynced_writes, false, __ATOMIC_ACQ_REL) &&
+            sync_segments(disk_manager, true) == -1)
+            printf("I/O error while syncing table file\n");
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return NULL;
+}
+
+static void stop_sync_worker(DiskManager *disk_manager) {
+    SyncWorker *worker = disk_manager->sync_worker;
+    if (worker == NULL)
+        return;
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->stop = true;
+    pthread_cond_signal(&worker->stop_cond);
+    pthread_mutex_unlock(&worker->mutex);
+    pthread_join(worker->thread, NULL);
+
+    pthread_mutex_destroy(&worker->mutex);
+    pthread_cond_destroy(&worker->stop_cond);
+    free(worker);
+    disk_manager->sync_worker = NULL;
+}
+
+void set_sync_policy(DiskManager *disk_manager, SyncPolicy policy, u32 interval_ms) {
+    stop_sync_worker(disk_manager);
+    // Don't leave writes done under a more relaxed policy behind
+    if (__atomic_load_n(&disk_manager->has_unsynced_writes, __ATOMIC_ACQUIRE))
+        sync_table_file(disk_manager);
+
+    disk_manager->sync_policy = policy;
+    disk_manager->sync_interval_ms = interval_ms;
+    if (policy != SYNC_PERIODIC)
+        return;
+
+    SyncWorker *worker = (SyncWorker *)malloc(sizeof(SyncWorker));
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->stop_cond, NULL);
+    worker->stop = false;
+    disk_manager->sync_worker = worker;
+    pthread_create(&worker->thread, NULL, sync_worker_loop, disk_manager);
+}
 
-    int s = lseek(fd, offset, SEEK_SET);
-    int r = read(fd, page, PAGE_SIZE);
+void read_page_into(page_id_t page_id, DiskManager *disk_manager, uint8_t *buf) {
+    ssize_t r = page_io(disk_manager, page_id, buf, false);
 
-    if (s == -1 || r == -1) {
+    if (r == -1) {
         fprintf(stderr, "I/O error while reading specified page\n");
         exit(1);
     }
+    if (r == 0) {
+        fprintf(stderr, "I/O error, reading past EOF\n");
+        exit(1);
+    }
+    track_reads(disk_manager, page_id, 1);
 
     if (r < PAGE_SIZE)
         fprintf(stdout, "Read less than a page size\n");
+}
 
+uint8_t *read_page(page_id_t page_id, DiskManager *disk_manager) {
+    uint8_t *page = (uint8_t *)malloc(PAGE_SIZE);
+    read_page_into(page_id, disk_manager, page);
     return page;
 }
 
-void close_table_file(DiskManager *disk_manager) { close(table_file(disk_manager->table_name)); }
+void close_table_file(DiskManager *disk_manager) {
+    if (disk_manager->fd == -1)
+        return;
+    stop_sync_worker(disk_manager);
+    if (__atomic_load_n(&disk_manager->has_unsynced_writes, __ATOMIC_ACQUIRE))
+        sync_table_file(disk_manager);
+    set_direct_io(disk_manager, false);
+    if (disk_manager->readahead.sequential) // the advice sticks to the shared descriptors
+        advise_segments(disk_manager, POSIX_FADV_NORMAL);
+    for (u32 segment = 1; disk_manager->segments != NULL && segment < disk_manager->num_segments; segment++)
+        if (disk_manager->segments[segment - 1].fd != -1)
+            release_table_fd(disk_manager->segments[segment - 1].fd);
+    free(disk_manager->segments);
+    disk_manager->segments = NULL;
+    disk_manager->num_segments = 1;
+    free_page_directory(&disk_manager->page_directory);
+    free(disk_manager->schema_page);
+    disk_manager->schema_page = NULL;
+    release_table_fd(disk_manager->fd);
+    disk_manager->fd = -1;
+}
 
 // for test only
 void remove_table(const char *table_name) {
-    char path[40] = {0};
-    sprintf(path, "%s/%s.db", DBFILES_DIR, table_name);
+    // Disk managers still using the table keep their descriptor, but the next acquire opens a fresh file
+    RWLOCK_WRLOCK(&fd_registry_latch);
+    for (TableFd *entry = fd_registry; entry != NULL; entry = entry->next)
+        if (strcmp(entry->table_name, table_name) == 0)
+            entry->removed = true;
+    RWLOCK_UNLOCK(&fd_registry_latch);
+
+    char path[PATH_MAX];
+    table_path(table_name, path);
     remove(path);
+
+    // Segments past the first
+    char segment_prefix[NAME_MAX];
+    int prefix_len = snprintf(segment_prefix, sizeof(segment_prefix), "%s.db.", table_name);
+    DIR *dir = opendir(DBFILES_DIR);
+    if (dir == NULL)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *suffix = entry->d_name + prefix_len;
+        if (strncmp(entry->d_name, segment_prefix, prefix_len) == 0 && *suffix != '\0' &&
+            strspn(suffix, "0123456789") == strlen(suffix)) {
+            snprintf(path, sizeof(path), "%s/%s", DBFILES_DIR, entry->d_name);
+            remove(path);
+        }
+    }
+    closedir(dir);
 }
 
 // B+tree disk handling methods used by buffer pool, which is in C
@@ -79,7 +742,8 @@ void remove_table(const char *table_name) {
 // probably solve this properly if there are more issues like this in the future, but this will do for now
 //-------------------------------------------------------------------------------------------------
 page_id_t new_btree_index_page(DiskManager *disk_manager, bool is_leaf) {
-    u8 *metadata_page = read_page(0, disk_manager);
+    u8 metadata_page[PAGE_SIZE];
+    read_page_into(0, disk_manager, metadata_page);
     assert(decode_uint32(metadata_page) == BTREE_INDEX);
 
     u16 curr_node_num = decode_uint16(metadata_page + NODE_COUNT_OFFSET);
@@ -87,7 +751,10 @@ page_id_t new_btree_index_page(DiskManager *disk_manager, bool is_leaf) {
     encode_uint16(new_node_num, metadata_page + NODE_COUNT_OFFSET);
     write_page(0, disk_manager, metadata_page);
 
-    u8 *page = (u8 *)calloc(PAGE_SIZE, 1);
+    // Empty slotted page, so that deserializing it never walks into the header (which holds the checksum)
+    u8 page[PAGE_SIZE] = {0};
+    encode_uint16(INDEX_PAGE_HEADER_SIZE, page + AVAILABLE_SPACE_START_OFFSET);
+    encode_uint16(PAGE_SIZE, page + AVAILABLE_SPACE_END_OFFSET);
     memcpy(page + IS_LEAF_OFFSET, &is_leaf, IS_LEAF_SIZE);
     write_page(new_node_num, disk_manager, page);
 
@@ -95,19 +762,13 @@ page_id_t new_btree_index_page(DiskManager *disk_manager, bool is_leaf) {
 }
 
 DiskManager *create_btree_index(const char *idx_name, const u8 max_keys) {
-    DiskManager *disk_mgr = (DiskManager *)malloc(sizeof(DiskManager));
-    disk_mgr->table_name = (char *)malloc(sizeof(char) * 25);
-    strcpy(disk_mgr->table_name, idx_name);
-    RWLOCK l;
-    RWLOCK_INIT(&l);
-    disk_mgr->latch = l;
-
-    int fd = table_file(disk_mgr->table_name);
+    DiskManager *disk_mgr = new_disk_manager(idx_name);
+    int fd = disk_mgr->fd;
 
     off_t offset = lseek(fd, 0, SEEK_END);
     if (offset != 0) {
         printf("Index with that name already exists");
-        close(fd);
+        close_table_file(disk_mgr);
         return NULL;
     }
 
@@ -117,6 +778,7 @@ DiskManager *create_btree_index(const char *idx_name, const u8 max_keys) {
     memcpy(index_buf + sizeof(u32) + sizeof(u16), &max_keys, 1);
 
     write(fd, index_buf, PAGE_SIZE);
+    disk_mgr->page_type = BTREE_INDEX_PAGE;
     return disk_mgr;
 }
 
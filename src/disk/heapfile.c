@@ -1,5 +1,6 @@
 #include "../../include/disk/heapfile.h"
 #include "../../include/disk/disk_manager.h"
+#include "../../include/disk/page_directory.h"
 #include "../../include/utils/serialize.h"
 #include "../../include/utils/shared.h"
 #include <assert.h>
@@ -14,69 +15,24 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-/**
- * Finds page in the table file that has enough space to store the provided size.
- * Returns true if found, false otherwise.
- * Found page_id is stored in the provided out param
- */
-static bool find_spacious_page(uint16_t size_needed, DiskManager *disk_manager, page_id_t *page_id) {
-    for (page_id_t i = START_USER_PAGE; i < MAX_PAGES; i++) {
-        char pid_key[11];
-        sprintf(pid_key, "%d", i);
-        HashEl *found = hash_find(pid_key, disk_manager->page_directory);
-        if (found && (size_t)found->data >= size_needed) {
-            *page_id = i;
-            return true;
-        }
-    }
-    return false;
-}
-
 DiskManager *create_table(const char *table_name, Column *columns, uint8_t n_columns) {
-    DiskManager *disk_mgr = (DiskManager *)malloc(sizeof(DiskManager));
-    disk_mgr->page_directory = init_hash(MAX_PAGES);
-    disk_mgr->table_name = (char *)malloc(sizeof(char) * 15);
-    strcpy(disk_mgr->table_name, table_name);
-    RWLOCK l;
-    RWLOCK_INIT(&l);
-    disk_mgr->latch = l;
-
-    int fd = table_file(table_name);
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    int fd = disk_mgr->fd;
 
     off_t offset = lseek(fd, 0, SEEK_END);
     if (offset != 0) {
         printf("Table with that name already exists");
-        close(fd);
+        close_table_file(disk_mgr);
         return NULL;
     }
 
-    // Setup a database file header and an in memory page directory
-    uint8_t pid_buf[2], free_space_buf[2], total_buf[4];
-    for (page_id_t pid = 0; pid < MAX_PAGES; pid++) {
-        encode_uint16(pid, pid_buf);
-        encode_uint16(PAGE_SIZE, free_space_buf);
-        memcpy(total_buf, pid_buf, 2);
-        memcpy(total_buf + 2, free_space_buf, 2);
-        write(fd, total_buf, 4);
-
-        if (pid < START_USER_PAGE)
-            continue; // only write user pages in memory page dir
-
-        uint16_t *free_space = (uint16_t *)malloc(sizeof(uint16_t));
-        char *pid_str = (char *)malloc(sizeof(char) * 7);
-        sprintf(pid_str, "%d", pid);
-        *free_space = PAGE_SIZE;
-        HashInsertArgs insert_args = {.key = pid_str, .data = free_space, .ht = disk_mgr->page_directory};
-        hash_insert(&insert_args);
+    // Allocate the first extent of the file, writing out the first page directory page
+    if (!init_page_directory(disk_mgr, START_USER_PAGE)) {
+        printf("Couldn't allocate space for the table file");
+        close_table_file(disk_mgr);
+        return NULL;
     }
 
-    // Add padding to the header page up to PAGE_SIZE (necessary for reading page into memory)
-    const uint16_t remainder = PAGE_SIZE - (MAX_PAGES * 4);
-    uint8_t fill_buf[remainder];
-    for (int i = 0; i < remainder; i++)
-        fill_buf[i] = 0;
-    write(fd, fill_buf, remainder);
-
     // Add table columns metadata page
     uint8_t col_buf[PAGE_SIZE] = {n_columns};
     size_t col_size = 0;
@@ -87,7 +43,55 @@ DiskManager *create_table(const char *table_name, Column *columns, uint8_t n_col
         memcpy(buf_offset + 1 + columns[j].name_len, &columns[j].type, 1);
         col_size = SCHEMA_COLUMN_SIZE(columns[j].name_len);
     }
-    write(fd, col_buf, PAGE_SIZE);
+    write_page(TABLE_SCHEMA_PAGE, disk_mgr, col_buf);
+    disk_mgr->page_type = HEAP_PAGE;
+    disk_mgr->schema_page = (u8 *)malloc(PAGE_SIZE);
+    memcpy(disk_mgr->schema_page, col_buf, PAGE_SIZE);
+
+    return disk_mgr;
+}
+
+// Tells the first directory page and the schema page of a heap table apart from the first pages of other files, e.g.
+// B+tree indexes, whose first page holds the index's magic number
+static bool is_heap_table(const uint8_t *dir_page, const uint8_t *schema_page) {
+    if (decode_uint32(dir_page) == BTREE_INDEX)
+        return false;
+
+    // Tables have at least one column, named
+    uint8_t cols_num = schema_page[0];
+    uint8_t col_name_len = schema_page[START_COLUMNS_INFO];
+    if (cols_num == 0 || col_name_len == 0)
+        return false;
+    uint8_t col_type = schema_page[START_COLUMNS_INFO + 1 + col_name_len];
+    return col_type >= BOOLEAN && col_type <= DECIMAL;
+}
+
+DiskManager *open_table(const char *table_name) {
+    if (!table_exists(table_name))
+        return NULL;
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    if (disk_mgr->fd == -1) {
+        free(disk_mgr->table_name);
+        free(disk_mgr);
+        return NULL;
+    }
+
+    // The first directory page and the schema page are adjacent, so both come in with a single read
+    uint8_t dir_page[PAGE_SIZE];
+    uint8_t *schema_page = (uint8_t *)malloc(PAGE_SIZE);
+    struct iovec iovecs[2] = {{.iov_base = dir_page, .iov_len = PAGE_SIZE},
+                              {.iov_base = schema_page, .iov_len = PAGE_SIZE}};
+    if (read_pages(PAGE_DIR_PAGE, 2, disk_mgr, iovecs) != 2 || !is_heap_table(dir_page, schema_page) ||
+        !load_page_directory(disk_mgr, dir_page)) {
+        fprintf(stderr, "Table file '%s' is not a valid heap table\n", table_name);
+        free(schema_page);
+        close_table_file(disk_mgr);
+        free(disk_mgr->table_name);
+        free(disk_mgr);
+        return NULL;
+    }
+    disk_mgr->page_type = HEAP_PAGE;
+    disk_mgr->schema_page = schema_page;
 
     return disk_mgr;
 }
@@ -96,7 +100,8 @@ Header extract_header(uint8_t *page, page_id_t page_id) {
     uint16_t free_start = decode_uint16(page);
     uint16_t free_end = decode_uint16(page + sizeof(uint16_t));
     Header header = {
-        .id = page_id, .free_start = free_start, .free_end = free_end, .flags = *(page + (sizeof(uint16_t) * 2))};
+        .id = page_id, .free_start = free_start, .free_end = free_end, .flags = *(page + (sizeof(uint16_t) * 2)),
+        .checksum = decode_uint32(page + PAGE_CHECKSUM_OFFSET)};
 
     return header;
 }
@@ -124,45 +129,25 @@ static void construct_page_tuple_ptr(uint8_t *page, uint32_t slot_num, TuplePtr
 }
 
 page_id_t new_heap_page(DiskManager *disk_manager) {
-    uint8_t *page = (uint8_t *)malloc(PAGE_SIZE);
+    uint8_t page[PAGE_SIZE] = {0};
     page_id_t pid = 0;
-    if (!find_spacious_page(PAGE_SIZE, disk_manager, &pid))
-        return 0;
 
     RWLOCK_WRLOCK(&disk_manager->latch);
+    if (!find_free_page(disk_manager, PAGE_UNUSED, &pid)) {
+        RWLOCK_UNLOCK(&disk_manager->latch);
+        return 0;
+    }
+
     // Construct page header
-    Header header = {.id = pid, .free_start = PAGE_HEADER_SIZE, .free_end = PAGE_SIZE - 1, .flags = 0x00};
+    Header header = {
+        .id = pid, .free_start = PAGE_HEADER_SIZE, .free_end = PAGE_SIZE - 1, .flags = 0x00, .checksum = 0};
     construct_page_header_buf(page, header);
 
     write_page(pid, disk_manager, page);
-    free(page);
     RWLOCK_UNLOCK(&disk_manager->latch);
     return pid;
 }
 
-// Updates the free_space associated with the provided page id in a table's page directory (in memory and on disk)
-static void update_page_dir(DiskManager *disk_manager, page_id_t pid, uint16_t tuple_size, enum TupleAction act) {
-    char *pid_key = (char *)malloc(sizeof(char) * 11);
-    sprintf(pid_key, "%u", pid);
-
-    // TODO: make find->remove->insert a single procedure
-    uint16_t curr_free_space = *(uint16_t *)hash_find(pid_key, disk_manager->page_directory)->data;
-    HashRemoveArgs rm_args = {.key = pid_key, .ht = disk_manager->page_directory, .success_out = NULL};
-    hash_remove(&rm_args);
-    uint16_t *free_space = (uint16_t *)malloc(sizeof(uint16_t));
-    *free_space = act == TUPLE_ADD ? curr_free_space - tuple_size : curr_free_space + tuple_size;
-    HashInsertArgs in_args = {.key = pid_key, .data = free_space, .ht = disk_manager->page_directory};
-    hash_insert(&in_args);
-
-    int fd = table_file(disk_manager->table_name);
-    uint8_t pid_buf[4], free_space_buf[4], total_buf[4];
-    encode_uint16(pid, pid_buf);
-    encode_uint16(*free_space, free_space_buf);
-    memcpy(total_buf, pid_buf, 2);
-    memcpy(total_buf + 2, free_space_buf, 2);
-    pwrite(fd, total_buf, 4, PID_TO_PAGE_DIRECTORY_OFFSET(pid));
-}
-
 void *add_tuple(void *data_args) {
     AddTupleArgs *data = (AddTupleArgs *)data_args;
 
@@ -217,20 +202,32 @@ void *add_tuple(void *data_args) {
     }
 
     RWLOCK_WRLOCK(&data->disk_manager->latch);
-    page_id_t *pid = (page_id_t *)malloc(sizeof(page_id_t));
-    find_spacious_page(tuple_size, data->disk_manager, pid);
-    if (!pid) {
+    page_id_t pid;
+    if (tuple_size + TUPLE_PTR_SIZE > PAGE_SIZE - 1 - PAGE_HEADER_SIZE ||
+        !find_free_page(data->disk_manager, tuple_size + TUPLE_PTR_SIZE, &pid)) {
         printf("Couldn't find available page"); // this can be solved with overflow pages
         RWLOCK_UNLOCK(&data->disk_manager->latch);
         return NULL;
     }
-    uint8_t *page = read_page(*pid, data->disk_manager);
-    Header header = extract_header(page, *pid);
+    uint8_t page[PAGE_SIZE] = {0};
+    Header header = {
+        .id = pid, .free_start = PAGE_HEADER_SIZE, .free_end = PAGE_SIZE - 1, .flags = 0x00, .checksum = 0};
+    if (page_free_bucket(data->disk_manager->page_directory, pid) == FSM_UNUSED)
+        construct_page_header_buf(page, header); // page was never written to (or emptied by new_heap_page)
+    else {
+        read_page_into(pid, data->disk_manager, page);
+        header = extract_header(page, pid);
+    }
 
-    // Extract schema info
-    uint8_t *schema = read_page(1, data->disk_manager);
-    uint8_t cols_num = *schema + 0;
-    schema = schema + START_COLUMNS_INFO;
+    // Extract schema info, from the cached copy if the table was created or opened through this disk manager
+    uint8_t schema_buf[PAGE_SIZE];
+    uint8_t *schema_page = data->disk_manager->schema_page;
+    if (schema_page == NULL) {
+        read_page_into(TABLE_SCHEMA_PAGE, data->disk_manager, schema_buf);
+        schema_page = schema_buf;
+    }
+    uint8_t cols_num = *schema_page;
+    uint8_t *schema = schema_page + START_COLUMNS_INFO;
 
     uint8_t col_name_len_buf[1];
     uint8_t data_type_buf[1];
@@ -282,20 +279,20 @@ void *add_tuple(void *data_args) {
     header.free_end -= tuple_size;
     construct_page_header_buf(page, header);
 
-    write_page(*pid, data->disk_manager, page);
-    update_page_dir(data->disk_manager, *pid, tuple_size, TUPLE_ADD);
+    write_page(pid, data->disk_manager, page);
+    set_page_free_space(data->disk_manager, pid, header.free_end - header.free_start);
 
     data->tup_ptr_out->size = tuple_ptr.size;
     data->tup_ptr_out->start_offset = tuple_ptr.start_offset;
 
-    free(pid);
     RWLOCK_UNLOCK(&data->disk_manager->latch);
     return NULL;
 }
 
 void remove_tuple(DiskManager *disk_manager, RID rid) {
     RWLOCK_WRLOCK(&disk_manager->latch);
-    uint8_t *page = read_page(rid.pid, disk_manager);
+    uint8_t page[PAGE_SIZE];
+    read_page_into(rid.pid, disk_manager, page);
 
     TuplePtr tuple_ptr = extract_tuple_ptr(page, rid.slot_num);
 
@@ -311,8 +308,8 @@ void remove_tuple(DiskManager *disk_manager, RID rid) {
     RWLOCK_UNLOCK(&disk_manager->latch);
 }
 
-uint8_t *get_tuple(RID rid, DiskManager *disk_manager) {
-    uint8_t *page = read_page(rid.pid, disk_manager);
+uint8_t *get_tuple(RID rid, DiskManager *disk_manager, uint8_t *page) {
+    read_page_into(rid.pid, disk_manager, page);
     TuplePtr tuple_ptr = extract_tuple_ptr(page, rid.slot_num);
 
     if (tuple_ptr.start_offset == 0) {
@@ -323,20 +320,25 @@ uint8_t *get_tuple(RID rid, DiskManager *disk_manager) {
 }
 
 void defragment(page_id_t page_id, DiskManager *disk_manager) {
-    Header old_header = extract_header(read_page(page_id, disk_manager), page_id);
+    uint8_t temp[PAGE_SIZE];
+    read_page_into(page_id, disk_manager, temp);
+    Header old_header = extract_header(temp, page_id);
     if ((old_header.flags & COMPACTABLE) == 0)
         return;
 
-    uint8_t *page = (uint8_t *)malloc(PAGE_SIZE);
-    Header header = {.id = page_id, .free_start = PAGE_HEADER_SIZE, .free_end = PAGE_SIZE - 1, .flags = 0x00};
+    uint8_t page[PAGE_SIZE];
+    Header header = {
+        .id = page_id, .free_start = PAGE_HEADER_SIZE, .free_end = PAGE_SIZE - 1, .flags = 0x00, .checksum = 0};
 
-    uint8_t *temp = read_page(page_id, disk_manager);
     uint16_t temp_tuple_offset = old_header.free_end;
     uint16_t temp_tup_ptr_offset = PAGE_HEADER_SIZE;
     for (;;) {
+        // Past free_start there are no more tuple pointers (on a full page those bytes belong to a tuple)
+        if (temp_tup_ptr_offset >= old_header.free_start)
+            break;
         TuplePtr tup_ptr = extract_tuple_ptr(temp, TUPLE_POINTER_OFFSET_TO_TUPLE_INDEX(temp_tup_ptr_offset));
 
-        if (tup_ptr.size == 0 || temp_tup_ptr_offset > old_header.free_start)
+        if (tup_ptr.size == 0)
             break;
 
         // Removed tuples' offsets are 0 so skip them
@@ -359,4 +361,5 @@ void defragment(page_id_t page_id, DiskManager *disk_manager) {
     header.flags = old_header.flags & ~COMPACTABLE;
     construct_page_header_buf(page, header);
     write_page(page_id, disk_manager, page);
+    set_page_free_space(disk_manager, page_id, header.free_end - header.free_start);
 }
@@ -0,0 +1,302 @@
+#include "../../include/disk/lru_k_replacer.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool lru_k_replacer_init(LruKReplacer *replacer, frame_id_t first_frame, size_t capacity, u32 k, u64 correlated_period) {
+    size_t frames = capacity > 0 ? capacity : 1;
+    RWLOCK_INIT(&replacer->latch);
+    replacer->k = k > 0 ? k : 1;
+    replacer->history = (u64 *)calloc(frames * replacer->k, sizeof(u64));
+    replacer->last_access = (u64 *)calloc(frames, sizeof(u64));
+    replacer->flags = (u8 *)calloc(frames, sizeof(u8));
+    replacer->heap = (u32 *)malloc(frames * sizeof(u32));
+    replacer->young = (u32 *)malloc(frames * sizeof(u32));
+    replacer->pos = (u32 *)malloc(frames * sizeof(u32));
+    replacer->ahead = (u32 *)malloc(frames * sizeof(u32));
+    if (replacer->history == NULL || replacer->last_access == NULL || replacer->flags == NULL ||
+        replacer->heap == NULL || replacer->young == NULL || replacer->pos == NULL || replacer->ahead == NULL) {
+        lru_k_replacer_destroy(replacer);
+        return false;
+    }
+
+    replacer->first_frame = first_frame;
+    replacer->num_pages = capacity;
+    replacer->correlated_period = correlated_period;
+    replacer->heap_size = 0;
+    replacer->num_young = 0;
+    replacer->size = 0;
+    replacer->now = 0;
+    return true;
+}
+
+void lru_k_replacer_destroy(LruKReplacer *replacer) {
+    free(replacer->history);
+    free(replacer->last_access);
+    free(replacer->flags);
+    free(replacer->heap);
+    free(replacer->young);
+    free(replacer->pos);
+    free(replacer->ahead);
+    replacer->history = NULL;
+    replacer->last_access = NULL;
+    replacer->flags = NULL;
+    replacer->heap = NULL;
+    replacer->young = NULL;
+    replacer->pos = NULL;
+    replacer->ahead = NULL;
+    pthread_rwlock_destroy(&replacer->latch);
+}
+
+// Whether frame IDX goes before frame OTHER, both being past the correlated period or both within it: the frame whose
+// K-th most recent uncorrelated reference (0 with fewer than K) is older, then the one whose most recent is
+static bool evicted_before(const LruKReplacer *replacer, u32 idx, u32 other) {
+    const u64 *history = replacer->history + (size_t)idx * replacer->k;
+    const u64 *other_history = replacer->history + (size_t)other * replacer->k;
+    if (history[replacer->k - 1] != other_history[replacer->k - 1])
+        return history[replacer->k - 1] < other_history[replacer->k - 1];
+    return history[0] < other_history[0];
+}
+
+// Whether a reference to frame IDX made next would be correlated with its last one
+static bool is_correlated(const LruKReplacer *replacer, u32 idx) {
+    return replacer->now - replacer->last_access[idx] < replacer->correlated_period;
+}
+
+static void heap_place(LruKReplacer *replacer, size_t i, u32 idx) {
+    replacer->heap[i] = idx;
+    replacer->pos[idx] = (u32)i;
+}
+
+// Moves the frame at position I of the heap up or down to where it belongs
+static void heap_fix(LruKReplacer *replacer, size_t i) {
+    u32 idx = replacer->heap[i];
+    while (i > 0 && evicted_before(replacer, idx, replacer->heap[(i - 1) / 2])) {
+        heap_place(replacer, i, replacer->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= replacer->heap_size)
+            break;
+        u32 *heap = replacer->heap;
+        if (child + 1 < replacer->heap_size && evicted_before(replacer, heap[child + 1], heap[child]))
+            child++;
+        if (!evicted_before(replacer, replacer->heap[child], idx))
+            break;
+        heap_place(replacer, i, replacer->heap[child]);
+        i = child;
+    }
+    heap_place(replacer, i, idx);
+}
+
+// Makes evictable frame IDX wait in the young list or the heap, whichever it belongs to
+static void add_evictable(LruKReplacer *replacer, u32 idx) {
+    if (is_correlated(replacer, idx)) {
+        replacer->flags[idx] |= LRU_K_YOUNG;
+        replacer->pos[idx] = (u32)replacer->num_young;
+        replacer->young[replacer->num_young++] = idx;
+    } else {
+        heap_place(replacer, replacer->heap_size++, idx);
+        heap_fix(replacer, replacer->heap_size - 1);
+    }
+}
+
+// Takes evictable frame IDX out of the young list or the heap, leaving its flags to the caller
+static void remove_evictable(LruKReplacer *replacer, u32 idx) {
+    size_t i = replacer->pos[idx];
+    if (replacer->flags[idx] & LRU_K_YOUNG) {
+        replacer->flags[idx] &= ~LRU_K_YOUNG;
+        u32 last = replacer->young[--replacer->num_young];
+        replacer->young[i] = last;
+        replacer->pos[last] = (u32)i;
+    } else {
+        u32 last = replacer->heap[--replacer->heap_size];
+        if (i < replacer->heap_size) {
+            heap_place(replacer, i, last);
+            heap_fix(replacer, i);
+        }
+    }
+}
+
+// Moves the young frames now past the correlated period to the heap
+static void age_young(LruKReplacer *replacer) {
+    for (size_t i = 0; i < replacer->num_young;) {
+        u32 idx = replacer->young[i];
+        if (is_correlated(replacer, idx)) {
+            i++;
+            continue;
+        }
+        remove_evictable(replacer, idx);
+        add_evictable(replacer, idx);
+    }
+}
+
+// Index of FRAME_ID in REPLACER's arrays, or the replacer's capacity if it does not track the frame
+static size_t frame_index(frame_id_t frame_id, LruKReplacer *replacer) {
+    size_t idx = (size_t)frame_id - replacer->first_frame;
+    return frame_id >= replacer->first_frame && idx < replacer->num_pages ? idx : replacer->num_pages;
+}
+
+void lru_k_replacer_pin(LruKReplacer *replacer, frame_id_t frame_id) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx == replacer->num_pages) {
+        RWLOCK_UNLOCK(&replacer->latch);
+        return;
+    }
+
+    // The frame leaves the eviction order before its history changes
+    if (replacer->flags[idx] & LRU_K_EVICTABLE) {
+        remove_evictable(replacer, (u32)idx);
+        replacer->flags[idx] &= ~LRU_K_EVICTABLE;
+        replacer->size--;
+    }
+    u64 now = ++replacer->now;
+    u64 *history = replacer->history + idx * replacer->k;
+    if (!(replacer->flags[idx] & LRU_K_RESIDENT)) {
+        memset(history, 0, replacer->k * sizeof(u64));
+        history[0] = now;
+        replacer->flags[idx] = LRU_K_RESIDENT;
+    } else {
+        if (now - replacer->last_access[idx] > replacer->correlated_period) {
+            // A new uncorrelated reference. The previous correlated period shifts the older references along with it,
+            // so that it counts as a single reference
+            u64 correlated = replacer->last_access[idx] - history[0];
+            for (u32 i = replacer->k - 1; i > 0; i--)
+                history[i] = history[i - 1] != 0 ? history[i - 1] + correlated : 0;
+            history[0] = now;
+        }
+    }
+    replacer->last_access[idx] = now;
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+void lru_k_replacer_unpin(LruKReplacer *replacer, frame_id_t frame_id) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx < replacer->num_pages && replacer->flags[idx] == LRU_K_RESIDENT) {
+        replacer->flags[idx] |= LRU_K_EVICTABLE;
+        add_evictable(replacer, (u32)idx);
+        replacer->size++;
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+// Index of the young frame to be evicted first, all of them being within the correlated period. Called with young
+// frames left
+static size_t first_young(const LruKReplacer *replacer) {
+    size_t first = 0;
+    for (size_t i = 1; i < replacer->num_young; i++)
+        if (evicted_before(replacer, replacer->young[i], replacer->young[first]))
+            first = i;
+    return first;
+}
+
+frame_id_t lru_k_replacer_evict(LruKReplacer *replacer) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    if (replacer->size == 0) {
+        RWLOCK_UNLOCK(&replacer->latch);
+        return UINT32_MAX;
+    }
+
+    // Frames within the correlated period only go once no other frame is left
+    age_young(replacer);
+    u32 idx = replacer->heap_size > 0 ? replacer->heap[0] : replacer->young[first_young(replacer)];
+    remove_evictable(replacer, idx);
+    replacer->flags[idx] = 0;
+    replacer->size--;
+    RWLOCK_UNLOCK(&replacer->latch);
+    return replacer->first_frame + idx;
+}
+
+void lru_k_replacer_remove(LruKReplacer *replacer, frame_id_t frame_id) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx < replacer->num_pages) {
+        if (replacer->flags[idx] & LRU_K_EVICTABLE) {
+            remove_evictable(replacer, (u32)idx);
+            replacer->size--;
+        }
+        replacer->flags[idx] = 0;
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+// Whether the heap frame at position I goes before the one at position J
+static bool heap_position_before(const LruKReplacer *replacer, u32 i, u32 j) {
+    return evicted_before(replacer, replacer->heap[i], replacer->heap[j]);
+}
+
+// Adds heap position P to the NUM_AHEAD positions of the ahead min-heap
+static void ahead_push(LruKReplacer *replacer, size_t *num_ahead, u32 p) {
+    size_t i = (*num_ahead)++;
+    while (i > 0 && heap_position_before(replacer, p, replacer->ahead[(i - 1) / 2])) {
+        replacer->ahead[i] = replacer->ahead[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    replacer->ahead[i] = p;
+}
+
+// Removes and returns the first of the NUM_AHEAD positions of the ahead min-heap
+static u32 ahead_pop(LruKReplacer *replacer, size_t *num_ahead) {
+    u32 first = replacer->ahead[0];
+    u32 last = replacer->ahead[--(*num_ahead)];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= *num_ahead)
+            break;
+        u32 *ahead = replacer->ahead;
+        if (child + 1 < *num_ahead && heap_position_before(replacer, ahead[child + 1], ahead[child]))
+            child++;
+        if (!heap_position_before(replacer, replacer->ahead[child], last))
+            break;
+        replacer->ahead[i] = replacer->ahead[child];
+        i = child;
+    }
+    replacer->ahead[i] = last;
+    return first;
+}
+
+size_t lru_k_replacer_frames_ahead(LruKReplacer *replacer, frame_id_t *out, size_t max) {
+    // Aging the young frames does not change the order, only where the frames are kept
+    RWLOCK_WRLOCK(&replacer->latch);
+    age_young(replacer);
+
+    // The heap is walked in order from its root: the next frame is always the first of the children of those visited,
+    // so only the first MAX frames are ordered
+    size_t count = 0;
+    size_t num_ahead = 0;
+    if (replacer->heap_size > 0)
+        ahead_push(replacer, &num_ahead, 0);
+    while (count < max && num_ahead > 0) {
+        u32 p = ahead_pop(replacer, &num_ahead);
+        out[count++] = replacer->first_frame + replacer->heap[p];
+        for (size_t child = 2 * (size_t)p + 1; child <= 2 * (size_t)p + 2 && child < replacer->heap_size; child++)
+            ahead_push(replacer, &num_ahead, (u32)child);
+    }
+
+    // Then the few young frames, by insertion
+    size_t first = count;
+    for (size_t i = 0; i < replacer->num_young; i++) {
+        u32 idx = replacer->young[i];
+        size_t j = count < max ? count++ : max;
+        while (j > first && evicted_before(replacer, idx, out[j - 1] - replacer->first_frame)) {
+            if (j < max)
+                out[j] = out[j - 1];
+            j--;
+        }
+        if (j < max)
+            out[j] = replacer->first_frame + idx;
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+    return count;
+}
+
+size_t lru_k_replacer_size(LruKReplacer *replacer) {
+    RWLOCK_RDLOCK(&replacer->latch);
+    size_t size = replacer->size;
+    RWLOCK_UNLOCK(&replacer->latch);
+    return size;
+}
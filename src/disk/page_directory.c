@@ -0,0 +1,183 @@
+#include "../../include/disk/page_directory.h"
+#include "../../include/disk/disk_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ROOT 1
+
+static u8 *group_leaf(PageDirectory *dir, page_id_t pid) {
+    return dir->groups[pid / DIR_GROUP_PAGES] + DIR_GROUP_PAGES + pid % DIR_GROUP_PAGES;
+}
+
+// Recomputes the ancestors of NODE in max-tree TREE, stopping early once a node is left unchanged
+static void propagate_up(u8 *tree, u32 node) {
+    for (node /= 2; node >= ROOT; node /= 2) {
+        u8 max = MAX(tree[2 * node], tree[2 * node + 1]);
+        if (tree[node] == max)
+            break;
+        tree[node] = max;
+    }
+}
+
+// Recomputes all inner nodes of max-tree TREE with NUM_LEAVES leaves
+static void rebuild_tree(u8 *tree, u32 num_leaves) {
+    for (u32 node = num_leaves - 1; node >= ROOT; node--)
+        tree[node] = MAX(tree[2 * node], tree[2 * node + 1]);
+}
+
+// Returns the leftmost leaf index of max-tree TREE holding at least BUCKET, which the root must hold
+static u32 find_leaf(const u8 *tree, u32 num_leaves, u8 bucket) {
+    u32 node = ROOT;
+    while (node < num_leaves)
+        node = tree[2 * node] >= bucket ? 2 * node : 2 * node + 1;
+    return node - num_leaves;
+}
+
+static void update_group_root(PageDirectory *dir, u32 group) {
+    u32 leaf = dir->group_capacity + group;
+    dir->group_tree[leaf] = dir->groups[group][ROOT];
+    propagate_up(dir->group_tree, leaf);
+}
+
+// Adds an empty group, doubling the capacity of the group tree if it is full
+static void add_group(PageDirectory *dir) {
+    if (dir->num_groups == dir->group_capacity) {
+        u32 capacity = dir->group_capacity * 2;
+        u8 *tree = (u8 *)calloc(2 * capacity, 1);
+        memcpy(tree + capacity, dir->group_tree + dir->group_capacity, dir->group_capacity);
+        rebuild_tree(tree, capacity);
+        free(dir->group_tree);
+        dir->group_tree = tree;
+        dir->groups = (u8 **)realloc(dir->groups, capacity * sizeof(u8 *));
+        dir->group_capacity = capacity;
+    }
+
+    // Aligned so that directory pages can be written out directly with O_DIRECT
+    u8 *group = NULL;
+    if (posix_memalign((void **)&group, PAGE_SIZE, PAGE_SIZE) != 0) {
+        fprintf(stderr, "Out of memory while growing the page directory\n");
+        exit(1);
+    }
+    memset(group, 0, PAGE_SIZE);
+    dir->groups[dir->num_groups++] = group;
+}
+
+static void write_directory_page(DiskManager *disk_manager, u32 group) {
+    write_page(group * DIR_GROUP_PAGES, disk_manager, disk_manager->page_directory->groups[group]);
+}
+
+bool extend_table(DiskManager *disk_manager) {
+    PageDirectory *dir = disk_manager->page_directory;
+    page_id_t first_pid = dir->num_pages;
+    if (first_pid > UINT32_MAX - TABLE_EXTENT_PAGES)
+        return false;
+    if (!allocate_table_pages(disk_manager, first_pid, TABLE_EXTENT_PAGES))
+        return false;
+
+    // An extent can reach into the next group, which then needs its own directory page
+    u32 first_group = first_pid / DIR_GROUP_PAGES;
+    u32 last_group = (first_pid + TABLE_EXTENT_PAGES - 1) / DIR_GROUP_PAGES;
+    while (dir->num_groups <= last_group)
+        add_group(dir);
+
+    for (page_id_t pid = first_pid; pid < first_pid + TABLE_EXTENT_PAGES; pid++)
+        *group_leaf(dir, pid) = IS_DIRECTORY_PAGE(pid) ? 0 : FSM_UNUSED;
+    dir->num_pages += TABLE_EXTENT_PAGES;
+
+    for (u32 group = first_group; group <= last_group; group++) {
+        rebuild_tree(dir->groups[group], DIR_GROUP_PAGES);
+        update_group_root(dir, group);
+        write_directory_page(disk_manager, group);
+    }
+    return true;
+}
+
+PageDirectory *init_page_directory(DiskManager *disk_manager, u32 num_system_pages) {
+    PageDirectory *dir = (PageDirectory *)calloc(1, sizeof(PageDirectory));
+    dir->group_capacity = 1;
+    dir->group_tree = (u8 *)calloc(2, 1);
+    dir->groups = (u8 **)malloc(sizeof(u8 *));
+    disk_manager->page_directory = dir;
+
+    if (!extend_table(disk_manager)) {
+        free_page_directory(&disk_manager->page_directory);
+        return NULL;
+    }
+    for (page_id_t pid = 0; pid < num_system_pages; pid++)
+        *group_leaf(dir, pid) = 0;
+    rebuild_tree(dir->groups[0], DIR_GROUP_PAGES);
+    update_group_root(dir, 0);
+    write_directory_page(disk_manager, 0);
+    return dir;
+}
+
+PageDirectory *load_page_directory(DiskManager *disk_manager, const u8 *first_directory_page) {
+    u64 num_pages = table_num_pages(disk_manager);
+    if (num_pages == 0)
+        return NULL;
+
+    PageDirectory *dir = (PageDirectory *)calloc(1, sizeof(PageDirectory));
+    dir->group_capacity = 1;
+    dir->group_tree = (u8 *)calloc(2, 1);
+    dir->groups = (u8 **)malloc(sizeof(u8 *));
+    dir->num_pages = num_pages;
+
+    u32 num_groups = (dir->num_pages + DIR_GROUP_PAGES - 1) / DIR_GROUP_PAGES;
+    for (u32 group = 0; group < num_groups; group++) {
+        add_group(dir);
+        if (group == 0)
+            memcpy(dir->groups[0], first_directory_page, PAGE_SIZE);
+        else
+            read_page_into(group * DIR_GROUP_PAGES, disk_manager, dir->groups[group]);
+        dir->group_tree[dir->group_capacity + group] = dir->groups[group][ROOT];
+    }
+    rebuild_tree(dir->group_tree, dir->group_capacity);
+
+    disk_manager->page_directory = dir;
+    return dir;
+}
+
+bool find_free_page(DiskManager *disk_manager, u16 size_needed, page_id_t *page_id) {
+    PageDirectory *dir = disk_manager->page_directory;
+    if (size_needed > PAGE_SIZE)
+        return false;
+
+    u8 bucket = FSM_NEEDED_BUCKET(size_needed);
+    while (dir->group_tree[ROOT] < bucket) {
+        if (!extend_table(disk_manager))
+            return false;
+    }
+
+    u32 group = find_leaf(dir->group_tree, dir->group_capacity, bucket);
+    *page_id = group * DIR_GROUP_PAGES + find_leaf(dir->groups[group], DIR_GROUP_PAGES, bucket);
+    return true;
+}
+
+void set_page_free_space(DiskManager *disk_manager, page_id_t page_id, u16 free_space) {
+    PageDirectory *dir = disk_manager->page_directory;
+    u8 bucket = FSM_BUCKET(free_space);
+    u8 *leaf = group_leaf(dir, page_id);
+    if (*leaf == bucket)
+        return;
+
+    u32 group = page_id / DIR_GROUP_PAGES;
+    *leaf = bucket;
+    propagate_up(dir->groups[group], DIR_GROUP_PAGES + page_id % DIR_GROUP_PAGES);
+    update_group_root(dir, group);
+    write_directory_page(disk_manager, group);
+}
+
+u8 page_free_bucket(PageDirectory *page_directory, page_id_t page_id) { return *group_leaf(page_directory, page_id); }
+
+void free_page_directory(PageDirectory **page_directory) {
+    if (page_directory == NULL || *page_directory == NULL)
+        return;
+    for (u32 group = 0; group < (*page_directory)->num_groups; group++)
+        free((*page_directory)->groups[group]);
+    free((*page_directory)->groups);
+    free((*page_directory)->group_tree);
+    free(*page_directory);
+    *page_directory = NULL;
+}
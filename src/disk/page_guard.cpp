@@ -0,0 +1,57 @@
+#include "../../include/disk/page_guard.hpp"
+#include "../../include/disk/bpm.h"
+
+namespace somedb {
+
+void PageGuard::drop(bool is_dirty) {
+    if (page == nullptr)
+        return;
+    page_id_t page_id = page->id;
+    RWLOCK_UNLOCK(&page->latch);
+    page = nullptr;
+    unpin_page(page_id, is_dirty, bpm);
+}
+
+ReadPageGuard::ReadPageGuard(BufferPoolManager *bpm, BpmPage *page) : PageGuard(bpm, page) {
+    if (page != nullptr)
+        RWLOCK_RDLOCK(&page->latch);
+}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&other) noexcept {
+    if (this != &other) {
+        release();
+        bpm = other.bpm;
+        page = other.page;
+        other.page = nullptr;
+    }
+    return *this;
+}
+
+WritePageGuard::WritePageGuard(BufferPoolManager *bpm, BpmPage *page) : PageGuard(bpm, page) {
+    if (page != nullptr)
+        RWLOCK_WRLOCK(&page->latch);
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&other) noexcept {
+    if (this != &other) {
+        release();
+        bpm = other.bpm;
+        page = other.page;
+        other.page = nullptr;
+    }
+    return *this;
+}
+
+ReadPageGuard fetchRead(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy) {
+    return ReadPageGuard(bpm, fetch_bpm_page(page_id, bpm, strategy));
+}
+
+WritePageGuard fetchWrite(BufferPoolManager *bpm, page_id_t page_id, AccessStrategy *strategy) {
+    return WritePageGuard(bpm, fetch_bpm_page(page_id, bpm, strategy));
+}
+
+WritePageGuard newPage(BufferPoolManager *bpm, PageType type) {
+    return WritePageGuard(bpm, allocate_new_page(bpm, type));
+}
+
+} // namespace somedb
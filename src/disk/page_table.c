@@ -0,0 +1,73 @@
+#include "../../include/disk/page_table.h"
+#include <stdlib.h>
+
+// Fibonacci hashing: the top bits of the product spread consecutive page ids (of any file) over the whole table
+static inline u32 home_slot(const PageTable *table, page_key_t key) {
+    return (u32)((key * 11400714819323198485ull) >> table->shift);
+}
+
+bool page_table_init(PageTable *table, size_t max_pages) {
+    u32 bits = 1;
+    while (((size_t)1 << bits) < 2 * max_pages)
+        bits++;
+
+    table->slots = (PageTableSlot *)malloc(sizeof(PageTableSlot) << bits);
+    if (table->slots == NULL)
+        return false;
+    table->mask = (1u << bits) - 1;
+    table->shift = 64 - bits;
+    table->size = 0;
+    table->capacity = max_pages;
+    for (u32 i = 0; i <= table->mask; i++)
+        table->slots[i] = (PageTableSlot){.key = 0, .frame_id = NO_FRAME};
+    return true;
+}
+
+void page_table_destroy(PageTable *table) {
+    free(table->slots);
+    table->slots = NULL;
+    table->size = 0;
+}
+
+frame_id_t page_table_find(const PageTable *table, page_key_t key) {
+    for (u32 i = home_slot(table, key);; i = (i + 1) & table->mask) {
+        const PageTableSlot *slot = table->slots + i;
+        if (slot->frame_id == NO_FRAME || slot->key == key)
+            return slot->frame_id;
+    }
+}
+
+bool page_table_insert(PageTable *table, page_key_t key, frame_id_t frame_id) {
+    u32 i = home_slot(table, key);
+    while (table->slots[i].frame_id != NO_FRAME && table->slots[i].key != key)
+        i = (i + 1) & table->mask;
+
+    if (table->slots[i].frame_id == NO_FRAME) {
+        if (table->size == table->capacity)
+            return false;
+        table->size++;
+    }
+    table->slots[i] = (PageTableSlot){.key = key, .frame_id = frame_id};
+    return true;
+}
+
+bool page_table_remove(PageTable *table, page_key_t key) {
+    u32 hole = home_slot(table, key);
+    while (table->slots[hole].key != key || table->slots[hole].frame_id == NO_FRAME) {
+        if (table->slots[hole].frame_id == NO_FRAME)
+            return false;
+        hole = (hole + 1) & table->mask;
+    }
+
+    // Moves back every later entry of the cluster whose home slot does not lie between the hole and the entry itself
+    for (u32 i = (hole + 1) & table->mask; table->slots[i].frame_id != NO_FRAME; i = (i + 1) & table->mask) {
+        u32 home = home_slot(table, table->slots[i].key);
+        if (((i - home) & table->mask) >= ((i - hole) & table->mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+    table->slots[hole].frame_id = NO_FRAME;
+    table->size--;
+    return true;
+}
@@ -0,0 +1,111 @@
+#include "../../include/disk/replacer.h"
+#include <assert.h>
+#include <stdint.h>
+
+bool replacer_init(Replacer *replacer, ReplacerPolicy policy, frame_id_t first_frame, size_t capacity) {
+    replacer->policy = policy;
+    switch (policy) {
+    case REPLACER_CLOCK:
+        return clock_replacer_init_frames(&replacer->clock, first_frame, capacity);
+    case REPLACER_LRU_K:
+        return lru_k_replacer_init(&replacer->lru_k, first_frame, capacity, LRU_K_DEFAULT_K,
+                                   LRU_K_DEFAULT_CORRELATED_PERIOD);
+    case REPLACER_2Q:
+        return two_q_replacer_init(&replacer->two_q, first_frame, capacity);
+    }
+    assert(false);
+    return false;
+}
+
+void replacer_destroy(Replacer *replacer) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        clock_replacer_destroy(&replacer->clock);
+        break;
+    case REPLACER_LRU_K:
+        lru_k_replacer_destroy(&replacer->lru_k);
+        break;
+    case REPLACER_2Q:
+        two_q_replacer_destroy(&replacer->two_q);
+        break;
+    }
+}
+
+void replacer_pin(Replacer *replacer, frame_id_t frame_id, page_key_t key) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        clock_replacer_pin(&frame_id, &replacer->clock);
+        break;
+    case REPLACER_LRU_K:
+        lru_k_replacer_pin(&replacer->lru_k, frame_id);
+        break;
+    case REPLACER_2Q:
+        two_q_replacer_pin(&replacer->two_q, frame_id, key);
+        break;
+    }
+}
+
+void replacer_unpin(Replacer *replacer, frame_id_t frame_id) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        clock_replacer_unpin(&frame_id, &replacer->clock);
+        break;
+    case REPLACER_LRU_K:
+        lru_k_replacer_unpin(&replacer->lru_k, frame_id);
+        break;
+    case REPLACER_2Q:
+        two_q_replacer_unpin(&replacer->two_q, frame_id);
+        break;
+    }
+}
+
+frame_id_t replacer_evict(Replacer *replacer) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        return evict(&replacer->clock);
+    case REPLACER_LRU_K:
+        return lru_k_replacer_evict(&replacer->lru_k);
+    case REPLACER_2Q:
+        return two_q_replacer_evict(&replacer->two_q);
+    }
+    return UINT32_MAX;
+}
+
+void replacer_remove(Replacer *replacer, frame_id_t frame_id) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        // A pinned frame is not in the clock at all
+        clock_replacer_pin(&frame_id, &replacer->clock);
+        break;
+    case REPLACER_LRU_K:
+        lru_k_replacer_remove(&replacer->lru_k, frame_id);
+        break;
+    case REPLACER_2Q:
+        two_q_replacer_remove(&replacer->two_q, frame_id);
+        break;
+    }
+}
+
+size_t replacer_frames_ahead(Replacer *replacer, frame_id_t *out, size_t max) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        return clock_replacer_frames_ahead(&replacer->clock, out, max);
+    case REPLACER_LRU_K:
+        return lru_k_replacer_frames_ahead(&replacer->lru_k, out, max);
+    case REPLACER_2Q:
+        return two_q_replacer_frames_ahead(&replacer->two_q, out, max);
+    }
+    return 0;
+}
+
+size_t replacer_size(Replacer *replacer) {
+    switch (replacer->policy) {
+    case REPLACER_CLOCK:
+        return clock_replacer_size(&replacer->clock);
+    case REPLACER_LRU_K:
+        return lru_k_replacer_size(&replacer->lru_k);
+    case REPLACER_2Q:
+        return two_q_replacer_size(&replacer->two_q);
+    }
+    return 0;
+}
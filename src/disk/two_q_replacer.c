@@ -0,0 +1,212 @@
+#include "../../include/disk/two_q_replacer.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NO_LINK UINT32_MAX
+
+bool two_q_replacer_init(TwoQReplacer *replacer, frame_id_t first_frame, size_t capacity) {
+    size_t frames = capacity > 0 ? capacity : 1;
+    replacer->pages = (page_key_t *)malloc(sizeof(page_key_t) * frames);
+    replacer->prev = (u32 *)malloc(sizeof(u32) * frames);
+    replacer->next = (u32 *)malloc(sizeof(u32) * frames);
+    replacer->flags = (u8 *)calloc(frames, sizeof(u8));
+    replacer->ghost_capacity = frames / 2 > 0 ? frames / 2 : 1;
+    replacer->ghosts = (page_key_t *)malloc(sizeof(page_key_t) * replacer->ghost_capacity);
+    bool ok = page_table_init(&replacer->ghost_slots, replacer->ghost_capacity);
+    if (!ok || replacer->pages == NULL || replacer->prev == NULL || replacer->next == NULL || replacer->flags == NULL ||
+        replacer->ghosts == NULL) {
+        if (ok)
+            page_table_destroy(&replacer->ghost_slots);
+        replacer->ghost_slots.slots = NULL;
+        two_q_replacer_destroy(replacer);
+        return false;
+    }
+
+    replacer->first_frame = first_frame;
+    replacer->num_pages = capacity;
+    replacer->a1in_head = replacer->a1in_tail = NO_LINK;
+    replacer->am_head = replacer->am_tail = NO_LINK;
+    replacer->a1in_size = 0;
+    replacer->a1in_max = frames / 4 > 0 ? frames / 4 : 1;
+    replacer->size = 0;
+    replacer->ghost_start = 0;
+    replacer->ghost_count = 0;
+    RWLOCK_INIT(&replacer->latch);
+    return true;
+}
+
+void two_q_replacer_destroy(TwoQReplacer *replacer) {
+    free(replacer->pages);
+    free(replacer->prev);
+    free(replacer->next);
+    free(replacer->flags);
+    free(replacer->ghosts);
+    if (replacer->ghost_slots.slots != NULL)
+        page_table_destroy(&replacer->ghost_slots);
+    replacer->pages = NULL;
+    replacer->prev = replacer->next = NULL;
+    replacer->flags = NULL;
+    replacer->ghosts = NULL;
+    replacer->ghost_slots.slots = NULL;
+}
+
+// Index of FRAME_ID in REPLACER's arrays, or the replacer's capacity if it does not track the frame
+static size_t frame_index(frame_id_t frame_id, TwoQReplacer *replacer) {
+    size_t idx = (size_t)frame_id - replacer->first_frame;
+    return frame_id >= replacer->first_frame && idx < replacer->num_pages ? idx : replacer->num_pages;
+}
+
+static void push_front(TwoQReplacer *replacer, u32 *head, u32 *tail, u32 idx) {
+    replacer->prev[idx] = NO_LINK;
+    replacer->next[idx] = *head;
+    if (*head != NO_LINK)
+        replacer->prev[*head] = idx;
+    *head = idx;
+    if (*tail == NO_LINK)
+        *tail = idx;
+}
+
+static void unlink_frame(TwoQReplacer *replacer, u32 *head, u32 *tail, u32 idx) {
+    if (replacer->prev[idx] != NO_LINK)
+        replacer->next[replacer->prev[idx]] = replacer->next[idx];
+    else
+        *head = replacer->next[idx];
+    if (replacer->next[idx] != NO_LINK)
+        replacer->prev[replacer->next[idx]] = replacer->prev[idx];
+    else
+        *tail = replacer->prev[idx];
+}
+
+// Takes frame IDX off the queue it is on
+static void dequeue(TwoQReplacer *replacer, u32 idx) {
+    if (replacer->flags[idx] & TWO_Q_A1IN) {
+        unlink_frame(replacer, &replacer->a1in_head, &replacer->a1in_tail, idx);
+        replacer->a1in_size--;
+    } else if (replacer->flags[idx] & TWO_Q_AM) {
+        unlink_frame(replacer, &replacer->am_head, &replacer->am_tail, idx);
+    }
+    replacer->size -= (replacer->flags[idx] & TWO_Q_EVICTABLE) != 0;
+    replacer->flags[idx] = 0;
+}
+
+// Puts the page with KEY on A1out, forgetting the oldest page there if it is full
+static void remember(TwoQReplacer *replacer, page_key_t key) {
+    if (replacer->ghost_count == replacer->ghost_capacity) {
+        // The oldest slot may be stale: its page was referenced again, or remembered once more in a newer slot
+        page_key_t oldest = replacer->ghosts[replacer->ghost_start];
+        if (page_table_find(&replacer->ghost_slots, oldest) == replacer->ghost_start)
+            page_table_remove(&replacer->ghost_slots, oldest);
+        replacer->ghost_start = (replacer->ghost_start + 1) % replacer->ghost_capacity;
+        replacer->ghost_count--;
+    }
+    size_t slot = (replacer->ghost_start + replacer->ghost_count) % replacer->ghost_capacity;
+    replacer->ghosts[slot] = key;
+    page_table_insert(&replacer->ghost_slots, key, (u32)slot);
+    replacer->ghost_count++;
+}
+
+void two_q_replacer_pin(TwoQReplacer *replacer, frame_id_t frame_id, page_key_t key) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx == replacer->num_pages) {
+        RWLOCK_UNLOCK(&replacer->latch);
+        return;
+    }
+
+    u8 flags = replacer->flags[idx];
+    if (!(flags & (TWO_Q_A1IN | TWO_Q_AM))) {
+        replacer->pages[idx] = key;
+        if (page_table_remove(&replacer->ghost_slots, key)) {
+            push_front(replacer, &replacer->am_head, &replacer->am_tail, idx);
+            replacer->flags[idx] = TWO_Q_AM;
+        } else {
+            push_front(replacer, &replacer->a1in_head, &replacer->a1in_tail, idx);
+            replacer->a1in_size++;
+            replacer->flags[idx] = TWO_Q_A1IN;
+        }
+    } else {
+        // References to a page on A1in are taken as correlated with the one that brought it in, and leave it in place
+        if (flags & TWO_Q_AM) {
+            unlink_frame(replacer, &replacer->am_head, &replacer->am_tail, idx);
+            push_front(replacer, &replacer->am_head, &replacer->am_tail, idx);
+        }
+        if (flags & TWO_Q_EVICTABLE) {
+            replacer->flags[idx] &= ~TWO_Q_EVICTABLE;
+            replacer->size--;
+        }
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+void two_q_replacer_unpin(TwoQReplacer *replacer, frame_id_t frame_id) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx < replacer->num_pages && (replacer->flags[idx] & (TWO_Q_A1IN | TWO_Q_AM)) &&
+        !(replacer->flags[idx] & TWO_Q_EVICTABLE)) {
+        replacer->flags[idx] |= TWO_Q_EVICTABLE;
+        replacer->size++;
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+// Returns the evictable frame closest to the back of a queue, starting the search at frame FROM, or NO_LINK
+static u32 last_evictable(TwoQReplacer *replacer, u32 from) {
+    while (from != NO_LINK && !(replacer->flags[from] & TWO_Q_EVICTABLE))
+        from = replacer->prev[from];
+    return from;
+}
+
+frame_id_t two_q_replacer_evict(TwoQReplacer *replacer) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    u32 victim = NO_LINK;
+    if (replacer->size > 0) {
+        u32 a1in = last_evictable(replacer, replacer->a1in_tail);
+        u32 am = last_evictable(replacer, replacer->am_tail);
+        victim = (replacer->a1in_size > replacer->a1in_max && a1in != NO_LINK) || am == NO_LINK ? a1in : am;
+    }
+    if (victim == NO_LINK) {
+        RWLOCK_UNLOCK(&replacer->latch);
+        return UINT32_MAX;
+    }
+
+    if (replacer->flags[victim] & TWO_Q_A1IN)
+        remember(replacer, replacer->pages[victim]);
+    dequeue(replacer, victim);
+    RWLOCK_UNLOCK(&replacer->latch);
+    return replacer->first_frame + victim;
+}
+
+void two_q_replacer_remove(TwoQReplacer *replacer, frame_id_t frame_id) {
+    RWLOCK_WRLOCK(&replacer->latch);
+    size_t idx = frame_index(frame_id, replacer);
+    if (idx < replacer->num_pages)
+        dequeue(replacer, idx);
+    RWLOCK_UNLOCK(&replacer->latch);
+}
+
+size_t two_q_replacer_frames_ahead(TwoQReplacer *replacer, frame_id_t *out, size_t max) {
+    RWLOCK_RDLOCK(&replacer->latch);
+    u32 a1in = last_evictable(replacer, replacer->a1in_tail);
+    u32 am = last_evictable(replacer, replacer->am_tail);
+    size_t a1in_size = replacer->a1in_size;
+    size_t count = 0;
+    while (count < max && (a1in != NO_LINK || am != NO_LINK)) {
+        if ((a1in_size > replacer->a1in_max && a1in != NO_LINK) || am == NO_LINK) {
+            out[count++] = replacer->first_frame + a1in;
+            a1in = last_evictable(replacer, replacer->prev[a1in]);
+            a1in_size--;
+        } else {
+            out[count++] = replacer->first_frame + am;
+            am = last_evictable(replacer, replacer->prev[am]);
+        }
+    }
+    RWLOCK_UNLOCK(&replacer->latch);
+    return count;
+}
+
+size_t two_q_replacer_size(TwoQReplacer *replacer) {
+    RWLOCK_RDLOCK(&replacer->latch);
+    size_t size = replacer->size;
+    RWLOCK_UNLOCK(&replacer->latch);
+    return size;
+}
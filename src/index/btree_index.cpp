@@ -29,7 +29,8 @@ u8 *BTree::serialize() const {
 }
 
 void BTree::deserialize() {
-    u8 *metadata = read_page(BTREE_METADATA_PAGE_ID, bpm->disk_manager);
+    u8 metadata[PAGE_SIZE];
+    read_page_into(BTREE_METADATA_PAGE_ID, bpm->disk_manager, metadata);
 
     magic_num = decode_uint32(metadata + MAGIC_NUMBER_OFFSET);
     assert(magic_num == BTREE_INDEX);
@@ -86,7 +87,7 @@ TREE_NODE_FUNC_TYPE void BTree::splitNonRootNode(std::unique_ptr<BTreePage> &old
 
     // update parent
     auto parent_pid = getPrevBreadcrumbPid(breadcrumbs);
-    auto parent = std::make_unique<BTreePage>(fetch_bpm_page(parent_pid, bpm)->data);
+    auto parent = getBtreePage(parent_pid);
     parent->insertIntoNode(mid_key, old_node_pid);
     if (parent->keys.at(parent->keys.size() - 1) == mid_key)
         parent->rightmost_ptr = new_node_id;
@@ -100,11 +101,11 @@ TREE_NODE_FUNC_TYPE void BTree::splitNonRootNode(std::unique_ptr<BTreePage> &old
     // call for other ascendants if necessary
     if (parent->keys.size() > max_size) {
         if (breadcrumbs.empty()) {
-            std::unique_ptr<BTreePage> root_page = std::make_unique<BTreePage>(fetch_bpm_page(root_pid, bpm)->data);
+            std::unique_ptr<BTreePage> root_page = getBtreePage(root_pid);
             splitRootNode<u32>(root_page);
         } else {
             auto top_pid = getPrevBreadcrumbPid(breadcrumbs);
-            auto top_node = std::make_unique<BTreePage>(fetch_bpm_page(top_pid, bpm)->data);
+            auto top_node = getBtreePage(top_pid);
             splitNonRootNode<u32>(top_node, top_pid, breadcrumbs);
         }
     }
@@ -194,38 +195,43 @@ void BTree::merge(const page_id_t node_pid, std::stack<BREADCRUMB_TYPE> &breadcr
 
 std::unique_ptr<BTreePage> BTree::findLeaf(const BTreeKey &key, std::stack<BREADCRUMB_TYPE> &breadcrumbs,
                                            page_id_t &found_pid) {
-    auto *curr_bpm_page = fetch_bpm_page(root_pid, bpm);
-    auto temp = std::make_unique<BTreePage>(curr_bpm_page->data);
+    // Assigning the child's guard releases the parent only once the child is latched
+    ReadPageGuard guard = fetchRead(bpm, root_pid);
+    checkFetched(guard, root_pid);
+    auto temp = std::make_unique<BTreePage>(guard.data());
 
     while (!temp->is_leaf) {
         auto first_key = temp->keys.at(0);
         // provided key is smaller than first existing key
         if (BTreePage::cmpKeys(first_key, key) > 0) {
-            breadcrumbs.push(BREADCRUMB_TYPE(curr_bpm_page->id, 0));
+            breadcrumbs.push(BREADCRUMB_TYPE(guard.pid(), 0));
             auto next_ptr = std::get<internal_pointers>(temp->values).at(0);
-            curr_bpm_page = fetch_bpm_page(next_ptr, bpm);
-            temp = std::make_unique<BTreePage>(curr_bpm_page->data);
+            guard = fetchRead(bpm, next_ptr);
+            checkFetched(guard, next_ptr);
+            temp = std::make_unique<BTreePage>(guard.data());
             continue;
         }
         for (u16 i = 1; i < temp->keys.size(); i++) {
             auto prev_key = temp->keys.at(i - 1);
             auto curr_key = temp->keys.at(i);
             if (BTreePage::cmpKeys(prev_key, key) > 0 && BTreePage::cmpKeys(curr_key, key) <= 0) {
-                breadcrumbs.push(BREADCRUMB_TYPE(curr_bpm_page->id, i));
+                breadcrumbs.push(BREADCRUMB_TYPE(guard.pid(), i));
                 auto next_ptr = std::get<internal_pointers>(temp->values).at(i);
-                curr_bpm_page = fetch_bpm_page(next_ptr, bpm);
-                temp = std::make_unique<BTreePage>(curr_bpm_page->data);
+                guard = fetchRead(bpm, next_ptr);
+                checkFetched(guard, next_ptr);
+                temp = std::make_unique<BTreePage>(guard.data());
                 continue;
             }
         }
 
         // provided key is bigger than rightmost pointer
-        breadcrumbs.push(BREADCRUMB_TYPE(curr_bpm_page->id, -1));
-        curr_bpm_page = fetch_bpm_page(temp->rightmost_ptr, bpm);
-        temp = std::make_unique<BTreePage>(curr_bpm_page->data);
+        breadcrumbs.push(BREADCRUMB_TYPE(guard.pid(), -1));
+        guard = fetchRead(bpm, temp->rightmost_ptr);
+        checkFetched(guard, temp->rightmost_ptr);
+        temp = std::make_unique<BTreePage>(guard.data());
     }
 
-    found_pid = curr_bpm_page->id;
+    found_pid = guard.pid();
     return temp;
 }
 
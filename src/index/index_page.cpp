@@ -66,7 +66,7 @@ u8 *BTreePage::serialize() const {
     return data;
 }
 
-BTreePage::BTreePage(u8 data[PAGE_SIZE]) {
+BTreePage::BTreePage(const u8 data[PAGE_SIZE]) {
     next = decode_uint32(data + NEXT_PID_OFFSET);
     rightmost_ptr = decode_uint32(data + RIGHTMOST_PID_OFFSET);
     memcpy(&flags, data + TREE_FLAGS_OFFSET, TREE_FLAGS_SIZE);
@@ -12,10 +12,13 @@ Table HeapfileAccess::schema() const {
     // Not an actual disk manager instance, just an adapter around the table name since read_page() accepts DiskManager
     DiskManager mgr{};
     mgr.table_name = const_cast<char *>(path.data());
-    u8 *page_data = read_page(TABLE_SCHEMA_PAGE, &mgr);
-
-    if (page_data == nullptr)
+    mgr.fd = acquire_table_fd(path.data());
+    mgr.direct_fd = -1;
+    if (mgr.fd == -1)
         throw std::runtime_error("Heapfile of provided name does not exist");
+    u8 page_data[PAGE_SIZE];
+    read_page_into(TABLE_SCHEMA_PAGE, &mgr, page_data);
+    release_table_fd(mgr.fd);
 
     // Decode table schema
     std::vector<Column> table_cols;
@@ -68,10 +68,12 @@ bool circular_list_remove(void *node_val, CircularList *cl) {
     CircularListNode *curr = cl->head->next;
     CircularListNode *prev = cl->head;
 
-    while (curr != NULL && are_equal(cl->head->value, node_val)) {
+    while (curr != NULL && !are_equal(curr->value, node_val)) {
         prev = curr;
         curr = curr->next;
     }
+    if (curr == NULL)
+        return false;
     prev->next = curr->next;
     free_cl_node(&curr);
     cl->size--;
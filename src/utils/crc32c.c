@@ -0,0 +1,178 @@
+#include "../../include/utils/crc32c.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+#define CRC32C_POLY 0x82F63B78 // reflected Castagnoli polynomial
+
+/*
+ * The hardware path checksums three lanes of LANE_BYTES independently, so that the crc32 instructions of different
+ * lanes overlap instead of waiting on each other's latency, and then merges them. A 4KiB page is (almost) exactly
+ * three lanes
+ */
+#define LANE_BYTES 1360
+
+static u32 sw_table[8][256];
+static u32 lane_shift_table[4][256]; // CRC register after feeding LANE_BYTES zero bytes, one table per register byte
+static bool hw_available;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+static u32 sw_update(u32 reg, const u8 *p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        reg = sw_table[0][(reg ^ *p++) & 0xFF] ^ (reg >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        u32 lo, hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        lo ^= reg;
+        reg = sw_table[7][lo & 0xFF] ^ sw_table[6][(lo >> 8) & 0xFF] ^ sw_table[5][(lo >> 16) & 0xFF] ^
+              sw_table[4][lo >> 24] ^ sw_table[3][hi & 0xFF] ^ sw_table[2][(hi >> 8) & 0xFF] ^
+              sw_table[1][(hi >> 16) & 0xFF] ^ sw_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        reg = sw_table[0][(reg ^ *p++) & 0xFF] ^ (reg >> 8);
+    return reg;
+}
+
+// Moves REG over LANE_BYTES zero bytes, which is linear in REG and thus a XOR of per byte lookups
+static inline u32 shift_lane(u32 reg) {
+    return lane_shift_table[0][reg & 0xFF] ^ lane_shift_table[1][(reg >> 8) & 0xFF] ^
+           lane_shift_table[2][(reg >> 16) & 0xFF] ^ lane_shift_table[3][reg >> 24];
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static u32 hw_update(u32 reg, const u8 *p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        reg = _mm_crc32_u8(reg, *p++);
+        len--;
+    }
+    while (len >= 3 * LANE_BYTES) {
+        u64 r0 = reg, r1 = 0, r2 = 0;
+        for (size_t i = 0; i < LANE_BYTES; i += 8) {
+            u64 w0, w1, w2;
+            memcpy(&w0, p + i, sizeof(w0));
+            memcpy(&w1, p + LANE_BYTES + i, sizeof(w1));
+            memcpy(&w2, p + 2 * LANE_BYTES + i, sizeof(w2));
+            r0 = _mm_crc32_u64(r0, w0);
+            r1 = _mm_crc32_u64(r1, w1);
+            r2 = _mm_crc32_u64(r2, w2);
+        }
+        reg = shift_lane(shift_lane((u32)r0) ^ (u32)r1) ^ (u32)r2;
+        p += 3 * LANE_BYTES;
+        len -= 3 * LANE_BYTES;
+    }
+    u64 reg64 = reg;
+    while (len >= 8) {
+        u64 w;
+        memcpy(&w, p, sizeof(w));
+        reg64 = _mm_crc32_u64(reg64, w);
+        p += 8;
+        len -= 8;
+    }
+    reg = (u32)reg64;
+    while (len-- > 0)
+        reg = _mm_crc32_u8(reg, *p++);
+    return reg;
+}
+
+static bool detect_hw(void) { return __builtin_cpu_supports("sse4.2"); }
+#elif defined(__aarch64__)
+__attribute__((target("+crc"))) static u32 hw_update(u32 reg, const u8 *p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        reg = __crc32cb(reg, *p++);
+        len--;
+    }
+    while (len >= 3 * LANE_BYTES) {
+        u32 r0 = reg, r1 = 0, r2 = 0;
+        for (size_t i = 0; i < LANE_BYTES; i += 8) {
+            u64 w0, w1, w2;
+            memcpy(&w0, p + i, sizeof(w0));
+            memcpy(&w1, p + LANE_BYTES + i, sizeof(w1));
+            memcpy(&w2, p + 2 * LANE_BYTES + i, sizeof(w2));
+            r0 = __crc32cd(r0, w0);
+            r1 = __crc32cd(r1, w1);
+            r2 = __crc32cd(r2, w2);
+        }
+        reg = shift_lane(shift_lane(r0) ^ r1) ^ r2;
+        p += 3 * LANE_BYTES;
+        len -= 3 * LANE_BYTES;
+    }
+    while (len >= 8) {
+        u64 w;
+        memcpy(&w, p, sizeof(w));
+        reg = __crc32cd(reg, w);
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        reg = __crc32cb(reg, *p++);
+    return reg;
+}
+
+static bool detect_hw(void) { return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0; }
+#else
+static u32 hw_update(u32 reg, const u8 *p, size_t len) { return sw_update(reg, p, len); }
+
+static bool detect_hw(void) { return false; }
+#endif
+
+static void init_tables(void) {
+    for (u32 b = 0; b < 256; b++) {
+        u32 reg = b;
+        for (int k = 0; k < 8; k++)
+            reg = (reg >> 1) ^ (CRC32C_POLY & (0 - (reg & 1)));
+        sw_table[0][b] = reg;
+    }
+    for (u32 b = 0; b < 256; b++)
+        for (int t = 1; t < 8; t++)
+            sw_table[t][b] = sw_table[0][sw_table[t - 1][b] & 0xFF] ^ (sw_table[t - 1][b] >> 8);
+
+    // Image of every single register bit after LANE_BYTES zero bytes, combined into the per byte tables
+    static const u8 zeros[LANE_BYTES] = {0};
+    u32 bit_image[32];
+    for (int bit = 0; bit < 32; bit++)
+        bit_image[bit] = sw_update(1u << bit, zeros, LANE_BYTES);
+    for (int byte = 0; byte < 4; byte++) {
+        for (u32 v = 0; v < 256; v++) {
+            u32 image = 0;
+            for (int bit = 0; bit < 8; bit++)
+                if (v & (1u << bit))
+                    image ^= bit_image[byte * 8 + bit];
+            lane_shift_table[byte][v] = image;
+        }
+    }
+
+    hw_available = detect_hw();
+}
+
+u32 crc32c_update(u32 crc, const void *data, size_t len) {
+    pthread_once(&init_once, init_tables);
+    u32 reg = ~crc;
+    reg = hw_available ? hw_update(reg, (const u8 *)data, len) : sw_update(reg, (const u8 *)data, len);
+    return ~reg;
+}
+
+u32 crc32c(const void *data, size_t len) { return crc32c_update(0, data, len); }
+
+u32 crc32c_update_sw(u32 crc, const void *data, size_t len) {
+    pthread_once(&init_once, init_tables);
+    return ~sw_update(~crc, (const u8 *)data, len);
+}
+
+bool crc32c_hw_available(void) {
+    pthread_once(&init_once, init_tables);
+    return hw_available;
+}
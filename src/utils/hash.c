@@ -109,22 +109,23 @@ void *hash_remove(void *hash_remove_args) {
         temp = temp->next;
     }
 
-    if (temp == NULL) {
+    if (temp == NULL || temp->key == NULL) {
         RWLOCK_UNLOCK(&ht->latch);
         if (args->success_out)
             *args->success_out = false;
         return NULL;
     }
 
-    if (prev == NULL) {           // if its first el. in LL
+    if (prev == NULL) { // if its first el. in LL
+        free((void *)temp->key);
+        free(temp->data);
         if (temp->next == NULL) { // if its the only el. in LL
             ht->arr[idx] = (HashEl){.key = NULL, .data = NULL, .next = NULL};
         } else {
             HashEl *next = temp->next;
             ht->arr[idx] = *next;
+            free(next);
         }
-        free((void *)ht->arr[idx].key);
-        free(ht->arr[idx].data);
     } else {
         prev->next = temp->next;
         free_hash_el(&temp);
@@ -0,0 +1,103 @@
+#include "../include/disk/async_io.h"
+#include "../include/disk/disk_manager.h"
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_PAGES 8
+
+static const char table_name[20] = "async_io_test";
+
+void teardown(void) { remove_table(table_name); }
+
+// Writes TEST_PAGES pages through the provided backend, reads them back into separate buffers and checks contents
+static void write_read_pages(bool use_uring) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    AsyncIo *aio = async_io_init(TEST_PAGES, use_uring);
+    ck_assert_int_eq(aio->depth, TEST_PAGES);
+
+    static u8 out_pages[TEST_PAGES][PAGE_SIZE];
+    static u8 in_pages[TEST_PAGES][PAGE_SIZE];
+    for (page_id_t pid = 0; pid < TEST_PAGES; pid++) {
+        memset(out_pages[pid], pid + 1, PAGE_SIZE);
+        ck_assert(async_io_write_page(aio, disk_mgr, pid, out_pages[pid], pid));
+    }
+    ck_assert(!async_io_write_page(aio, disk_mgr, TEST_PAGES, out_pages[0], TEST_PAGES)); // queue is full
+
+    IoCompletion completions[TEST_PAGES];
+    u32 done = 0;
+    while (done < TEST_PAGES) {
+        u32 n = async_io_complete(aio, completions, TEST_PAGES, 1);
+        for (u32 i = 0; i < n; i++)
+            ck_assert_int_eq(completions[i].result, PAGE_SIZE);
+        done += n;
+    }
+    ck_assert_uint_eq(aio->in_flight, 0);
+
+    for (page_id_t pid = 0; pid < TEST_PAGES; pid++)
+        ck_assert(async_io_read_page(aio, disk_mgr, pid, in_pages[pid], 100 + pid));
+    async_io_submit(aio);
+
+    bool seen[TEST_PAGES] = {false};
+    done = 0;
+    while (done < TEST_PAGES) {
+        u32 n = async_io_complete(aio, completions, TEST_PAGES, 1);
+        for (u32 i = 0; i < n; i++) {
+            page_id_t pid = completions[i].user_data - 100;
+            ck_assert_uint_lt(pid, TEST_PAGES);
+            ck_assert_int_eq(completions[i].result, PAGE_SIZE);
+            seen[pid] = true;
+        }
+        done += n;
+    }
+
+    for (page_id_t pid = 0; pid < TEST_PAGES; pid++) {
+        ck_assert(seen[pid]);
+        ck_assert_int_eq(memcmp(in_pages[pid], out_pages[pid], PAGE_SIZE), 0);
+    }
+
+    async_io_destroy(&aio);
+    ck_assert_ptr_null(aio);
+    close_table_file(disk_mgr);
+}
+
+START_TEST(blocking_backend) { write_read_pages(false); }
+
+END_TEST
+
+// Falls back to the blocking backend where io_uring is not available, so this passes either way
+START_TEST(uring_backend) { write_read_pages(true); }
+
+END_TEST
+
+Suite *page_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("AsyncIo");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, blocking_backend);
+    tcase_add_test(tc_core, uring_backend);
+    tcase_add_checked_fixture(tc_core, NULL, teardown);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = page_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
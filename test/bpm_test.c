@@ -2,11 +2,14 @@
 #include "../include/disk/heapfile.h"
 #include <check.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <search.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 static BufferPoolManager *bpm;
 static page_id_t pid;
@@ -15,17 +18,23 @@ static const char table_name[15] = "bpm_test";
 
 void teardown(void) { remove_table(table_name); }
 
-START_TEST(initialize) {
+// Creates the table the tests work on, with a single string column
+static DiskManager *new_test_table(void) {
     char col_n[4] = "bpm";
     Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
-    disk_manager = create_table("bpm_test", cols, 1);
+    return create_table(table_name, cols, 1);
+}
+
+START_TEST(initialize) {
+    disk_manager = new_test_table();
 
     const size_t pool_size = 3;
 
     bpm = new_bpm(pool_size, disk_manager);
-    ck_assert_int_eq(bpm->pool_size, pool_size);
-    for (size_t i = 0; i < bpm->pool_size; i++) {
-        ck_assert_int_eq(bpm->free_list[i], true);
+    ck_assert_int_eq(bpm->pool->pool_size, pool_size);
+    for (size_t i = 0; i < bpm->pool->pool_size; i++) {
+        ck_assert_int_eq(bpm->pool->free_list[i], true);
+        ck_assert(IS_PAGE_ALIGNED(bpm->pool->pages[i].data));
     }
 }
 
@@ -52,31 +61,601 @@ START_TEST(unpin) {
     bool ok2 = unpin_page(pid, false, bpm); // once for newpage once for fetchpage
     ck_assert_int_eq(ok2, false);
 
-    char pid_str[11];
-    sprintf(pid_str, "%d", pid);
-    HashEl *el = hash_find(pid_str, bpm->page_table);
-    ck_assert_int_eq(*(bool *)el->data, false); // dirty bit unset
+    frame_id_t fid = find_frame(pid, bpm);
+    ck_assert_uint_ne(fid, NO_FRAME);
+    ck_assert_int_eq(bpm->pool->pages[fid].is_dirty, false); // dirty bit unset
 }
 
 END_TEST
 
 START_TEST(flush_page_test) {
-    char pid_str[11];
-    sprintf(pid_str, "%d", pid);
-    HashEl *entry_before_flush = hash_find(pid_str, bpm->page_table);
-    frame_id_t fid = *(frame_id_t *)entry_before_flush->data;
-    sprintf(pid_str, "%d", fid);
-    ck_assert_int_eq(bpm->free_list[fid], false);
+    frame_id_t fid = find_frame(pid, bpm);
+    ck_assert_int_eq(bpm->pool->free_list[fid], false);
+    bpm->pool->pages[fid].is_dirty = true;
 
     bool ok1 = flush_page(pid, bpm);
     ck_assert_int_eq(ok1, true);
 
-    HashEl *entry_after_flush = hash_find(pid_str, bpm->page_table);
-    ck_assert_ptr_null(entry_after_flush);
-    ck_assert_int_eq(bpm->free_list[fid], true);
+    // Flushing leaves the page cached, evicting it frees its frame
+    ck_assert_uint_eq(find_frame(pid, bpm), fid);
+    ck_assert_int_eq(bpm->pool->pages[fid].is_dirty, false);
+    ck_assert_int_eq(bpm->pool->free_list[fid], false);
+
+    ck_assert_ptr_nonnull(fetch_bpm_page(pid, bpm, NULL));
+    ck_assert_int_eq(evict_page(pid, bpm), false); // pinned
+    unpin_page(pid, false, bpm);
+    ck_assert_int_eq(evict_page(pid, bpm), true);
+    ck_assert_uint_eq(find_frame(pid, bpm), NO_FRAME);
+    ck_assert_int_eq(bpm->pool->free_list[fid], true);
 
     bool ok2 = flush_page(pid, bpm);
     ck_assert_int_eq(ok2, false);
+    ck_assert_int_eq(evict_page(pid, bpm), false);
+}
+
+END_TEST
+
+// A page damaged on disk (e.g. by a torn write) is caught when it is read into the buffer pool
+START_TEST(checksum_mismatch) {
+    DiskManager *dm = new_test_table();
+    page_id_t heap_pid = new_heap_page(dm);
+
+    BufferPoolManager *pool = new_bpm(2, dm);
+    ck_assert_ptr_nonnull(fetch_bpm_page(heap_pid, pool, NULL));
+    ck_assert_uint_eq(pool->pool->checksum_failures, 0);
+
+    u8 garbage = 0xAB;
+    write_bytes((off_t)heap_pid * PAGE_SIZE + PAGE_SIZE / 2, dm, &garbage, 1);
+    BufferPoolManager *other_pool = new_bpm(2, dm);
+    ck_assert_ptr_null(fetch_bpm_page(heap_pid, other_pool, NULL));
+    ck_assert_uint_eq(other_pool->pool->checksum_failures, 1);
+    for (size_t i = 0; i < other_pool->pool->pool_size; i++)
+        ck_assert(other_pool->pool->free_list[i]); // the damaged page is not cached
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+#define SHARDS 4
+#define PAGES_PER_THREAD 3
+
+typedef struct {
+    BufferPoolManager *pool;
+    page_id_t first_pid; // pages [first_pid, first_pid + PAGES_PER_THREAD * SHARDS) step SHARDS, all in one shard
+    bool ok;
+} ShardWorker;
+
+static void *fetch_in_shard(void *arg) {
+    ShardWorker *worker = (ShardWorker *)arg;
+    BpmShard *shard = BPM_SHARD(worker->pool->pool, worker->pool->file_id, worker->first_pid);
+    worker->ok = true;
+    for (u32 i = 0; i < PAGES_PER_THREAD; i++) {
+        BpmPage *page = fetch_bpm_page(worker->first_pid + i * SHARDS, worker->pool, NULL);
+        frame_id_t fid = page - worker->pool->pool->pages;
+        worker->ok &= fid >= shard->first_frame && fid < shard->first_frame + shard->num_frames;
+    }
+    for (u32 round = 0; round < 1000; round++) {
+        for (u32 i = 0; i < PAGES_PER_THREAD; i++) {
+            page_id_t pid = worker->first_pid + i * SHARDS;
+            worker->ok &= fetch_bpm_page(pid, worker->pool, NULL)->pin_count >= 2;
+            worker->ok &= unpin_page(pid, false, worker->pool);
+        }
+    }
+    return NULL;
+}
+
+// Threads each working on the pages of their own shard
+START_TEST(sharded_pool) {
+    DiskManager *dm = new_test_table();
+    BufferPoolManager *pool = new_sharded_bpm(SHARDS * PAGES_PER_THREAD + 1, SHARDS, dm);
+    ck_assert_uint_eq(pool->pool->num_shards, SHARDS);
+    ck_assert_uint_eq(pool->pool->shards[0].num_frames, PAGES_PER_THREAD + 1);
+    BpmShard *last_shard = pool->pool->shards + SHARDS - 1;
+    ck_assert_uint_eq(last_shard->first_frame + last_shard->num_frames, pool->pool->pool_size);
+
+    pthread_t threads[SHARDS];
+    ShardWorker workers[SHARDS];
+    for (u32 i = 0; i < SHARDS; i++) {
+        workers[i] = (ShardWorker){.pool = pool, .first_pid = 8 + i, .ok = false};
+        pthread_create(threads + i, NULL, fetch_in_shard, workers + i);
+    }
+    for (u32 i = 0; i < SHARDS; i++) {
+        pthread_join(threads[i], NULL);
+        ck_assert(workers[i].ok);
+    }
+    ck_assert_uint_ne(find_frame(8 + SHARDS, pool), NO_FRAME);
+    ck_assert_uint_eq(find_frame(7, pool), NO_FRAME);
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+#define MISS_THREADS 4
+#define MISS_PAGES 16
+#define MISS_ROUNDS 500
+
+typedef struct {
+    BufferPoolManager *pool;
+    page_id_t first_pid;
+    unsigned int seed;
+} MissWorker;
+
+// Increments a counter on pages picked at random among more than the pool holds, so that most fetches miss and evict
+// a dirty page, which may be fetched again while it is written back
+static void *increment_counters(void *arg) {
+    MissWorker *worker = (MissWorker *)arg;
+    for (int i = 0; i < MISS_ROUNDS; i++) {
+        page_id_t pid = worker->first_pid + rand_r(&worker->seed) % MISS_PAGES;
+        BpmPage *page = fetch_bpm_page(pid, worker->pool, NULL);
+        RWLOCK_WRLOCK(&page->latch);
+        u32 count;
+        memcpy(&count, page->data + PAGE_SIZE - 8, sizeof(u32));
+        count++;
+        memcpy(page->data + PAGE_SIZE - 8, &count, sizeof(u32));
+        RWLOCK_UNLOCK(&page->latch);
+        unpin_page(pid, true, worker->pool);
+    }
+    return NULL;
+}
+
+// Fetches read pages and write back dirty victims without the shard latched, yet no update is lost
+START_TEST(concurrent_misses) {
+    DiskManager *dm = new_test_table();
+    page_id_t first_pid = table_num_pages(dm);
+    allocate_table_pages(dm, first_pid, MISS_PAGES);
+    BufferPoolManager *pool = new_bpm(MISS_THREADS + 2, dm);
+
+    pthread_t threads[MISS_THREADS];
+    MissWorker workers[MISS_THREADS];
+    for (u32 i = 0; i < MISS_THREADS; i++) {
+        workers[i] = (MissWorker){.pool = pool, .first_pid = first_pid, .seed = i + 1};
+        pthread_create(threads + i, NULL, increment_counters, workers + i);
+    }
+    for (u32 i = 0; i < MISS_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    ck_assert_uint_gt(pool->pool->fetch_misses, MISS_PAGES);
+    flush_all(pool);
+
+    u32 total = 0;
+    for (page_id_t pid = first_pid; pid < first_pid + MISS_PAGES; pid++) {
+        u8 *page = read_page(pid, dm);
+        u32 count;
+        memcpy(&count, page + PAGE_SIZE - 8, sizeof(u32));
+        total += count;
+        free(page);
+    }
+    ck_assert_uint_eq(total, MISS_THREADS * MISS_ROUNDS);
+    ck_assert_uint_eq(pool->pool->checksum_failures, 0);
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+// Dirty pages are written in the background, so fetches evicting them afterwards do not have to
+START_TEST(background_writer) {
+    DiskManager *dm = new_test_table();
+    BufferPoolManager *pool = new_sharded_bpm(8, 2, dm);
+
+    for (page_id_t pid = 10; pid < 18; pid++) {
+        fetch_bpm_page(pid, pool, NULL)->data[PAGE_SIZE - 1] = pid;
+        unpin_page(pid, true, pool);
+    }
+    ck_assert(bg_writer_stats(pool).clean_ratio == 0);
+
+    set_bg_writer(pool, 100, 1);
+    BgWriterStats stats = bg_writer_stats(pool);
+    for (int i = 0; i < 2000 && stats.clean_ratio < 1; i++) {
+        usleep(1000);
+        stats = bg_writer_stats(pool);
+    }
+    ck_assert(stats.clean_ratio == 1);
+    ck_assert_uint_eq(stats.pages_written, 8);
+    ck_assert(stats.pages_per_sec > 0);
+    set_bg_writer(pool, 0, 0);
+    ck_assert_ptr_null(pool->pool->bg_writer);
+
+    for (page_id_t pid = 20; pid < 28; pid++) {
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, pool, NULL));
+        unpin_page(pid, false, pool);
+    }
+    ck_assert_uint_eq(bg_writer_stats(pool).dirty_evictions, 0);
+
+    u8 *page = read_page(13, dm);
+    ck_assert_uint_eq(page[PAGE_SIZE - 1], 13);
+    free(page);
+    close_table_file(dm);
+}
+
+END_TEST
+
+// Pools using each replacement policy keep working with more pages than frames
+START_TEST(replacement_policies) {
+    DiskManager *dm = new_test_table();
+    ReplacerPolicy policies[] = {REPLACER_CLOCK, REPLACER_LRU_K, REPLACER_2Q};
+
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        BufferPoolManager *pool = new_bpm_with_policy(4, 2, policies[i], dm);
+        for (page_id_t pid = 10; pid < 30; pid++) {
+            BpmPage *page = fetch_bpm_page(pid, pool, NULL);
+            ck_assert_ptr_nonnull(page);
+            page->data[PAGE_SIZE - 1] = pid + i;
+            unpin_page(pid, true, pool);
+        }
+        for (page_id_t pid = 10; pid < 30; pid++) {
+            BpmPage *page = fetch_bpm_page(pid, pool, NULL);
+            ck_assert_ptr_nonnull(page);
+            ck_assert_uint_eq(page->data[PAGE_SIZE - 1], pid + i);
+            unpin_page(pid, false, pool);
+        }
+        ck_assert_uint_gt(pool->pool->dirty_evictions, 0);
+    }
+    close_table_file(dm);
+}
+
+END_TEST
+
+// A scan under a bulk scan strategy recycles the frames of its ring, leaving the pages used before it in the pool
+START_TEST(bulk_scan_strategy) {
+    DiskManager *dm = new_test_table();
+    ck_assert(allocate_table_pages(dm, table_num_pages(dm), 240 - table_num_pages(dm)));
+    BufferPoolManager *pool = new_bpm(16, dm);
+    AccessStrategy *strategy = new_bulk_scan_strategy(pool, 4);
+    ck_assert_uint_eq(strategy->frames_per_shard, 4);
+
+    for (page_id_t pid = 10; pid < 18; pid++) {
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, pool, NULL));
+        unpin_page(pid, false, pool);
+    }
+    for (page_id_t pid = 100; pid < 140; pid++) {
+        BpmPage *page = fetch_bpm_page(pid, pool, strategy);
+        ck_assert_ptr_nonnull(page);
+        page->data[PAGE_SIZE - 1] = pid;
+        unpin_page(pid, true, pool);
+    }
+    for (page_id_t pid = 10; pid < 18; pid++)
+        ck_assert_uint_ne(find_frame(pid, pool), NO_FRAME);
+    ck_assert_uint_eq(pool->pool->shards[0].num_free, 4);
+    ck_assert_uint_eq(find_frame(135, pool), NO_FRAME);
+    ck_assert_uint_ne(find_frame(136, pool), NO_FRAME);
+
+    // Recycled pages were written back
+    u8 *page = read_page(120, dm);
+    ck_assert_uint_eq(page[PAGE_SIZE - 1], 120);
+    free(page);
+
+    // A ring page the scan still holds is not recycled, the next page takes another frame instead
+    ck_assert_ptr_nonnull(fetch_bpm_page(140, pool, strategy));
+    for (page_id_t pid = 141; pid < 145; pid++) {
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, pool, strategy));
+        unpin_page(pid, false, pool);
+    }
+    ck_assert_uint_ne(find_frame(140, pool), NO_FRAME);
+    ck_assert_uint_eq(pool->pool->shards[0].num_free, 3);
+
+    // Without the strategy, the scan goes through the whole pool
+    for (page_id_t pid = 200; pid < 240; pid++) {
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, pool, NULL));
+        unpin_page(pid, false, pool);
+    }
+    for (page_id_t pid = 10; pid < 18; pid++)
+        ck_assert_uint_eq(find_frame(pid, pool), NO_FRAME);
+
+    free_access_strategy(strategy);
+    close_table_file(dm);
+}
+
+END_TEST
+
+// Tables attached to one buffer pool share its frames, each page being written back to its own table
+START_TEST(shared_pool) {
+    DiskManager *dm = new_test_table();
+    char col_n[4] = "bpm";
+    Column cols[1] = {{.name_len = 3, .name = col_n, .type = STRING}};
+    DiskManager *other_dm = create_table("bpm_test_other", cols, 1);
+    BufferPool *shared = new_buffer_pool(8, 2, REPLACER_CLOCK);
+    BufferPoolManager *first = attach_bpm(shared, dm);
+    BufferPoolManager *second = attach_bpm(shared, other_dm);
+    ck_assert_uint_ne(first->file_id, second->file_id);
+    BufferPoolManager *again = attach_bpm(shared, dm);
+    ck_assert_uint_eq(again->file_id, first->file_id);
+
+    // Same page ids in both tables, different pages
+    for (page_id_t pid = 10; pid < 14; pid++) {
+        fetch_bpm_page(pid, first, NULL)->data[PAGE_SIZE - 1] = pid;
+        unpin_page(pid, true, first);
+        fetch_bpm_page(pid, second, NULL)->data[PAGE_SIZE - 1] = pid + 100;
+        unpin_page(pid, true, second);
+    }
+    ck_assert_uint_eq(fetch_bpm_page(12, again, NULL)->data[PAGE_SIZE - 1], 12);
+    unpin_page(12, false, again);
+
+    // The hot table takes over the whole pool, evicting the other table's pages through its own disk manager
+    for (page_id_t pid = 20; pid < 36; pid++) {
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, second, NULL));
+        unpin_page(pid, false, second);
+    }
+    for (page_id_t pid = 10; pid < 14; pid++) {
+        ck_assert_uint_eq(find_frame(pid, first), NO_FRAME);
+        ck_assert_uint_eq(find_frame(pid, second), NO_FRAME);
+        u8 *page = read_page(pid, dm);
+        ck_assert_uint_eq(page[PAGE_SIZE - 1], pid);
+        free(page);
+        page = read_page(pid, other_dm);
+        ck_assert_uint_eq(page[PAGE_SIZE - 1], pid + 100);
+        free(page);
+    }
+
+    // A detached table leaves no page behind
+    for (page_id_t pid = 10; pid < 14; pid++) {
+        fetch_bpm_page(pid, first, NULL)->data[0] = 1;
+        unpin_page(pid, true, first);
+    }
+    fetch_bpm_page(10, first, NULL);
+    ck_assert(!detach_bpm(first));
+    unpin_page(10, false, first);
+    ck_assert(detach_bpm(first));
+    ck_assert_uint_eq(find_frame(10, again), NO_FRAME);
+    ck_assert_uint_eq(shared->shards[0].num_free + shared->shards[1].num_free, 4);
+    u8 *page = read_page(11, dm);
+    ck_assert_uint_eq(page[0], 1);
+    free(page);
+    detach_bpm(again);
+    detach_bpm(second);
+    // Both file ids were given back
+    BufferPoolManager *reattached = attach_bpm(shared, other_dm);
+    ck_assert_uint_eq(shared->num_files, 2);
+    ck_assert_ptr_eq(shared->files[reattached->file_id], other_dm);
+    detach_bpm(reattached);
+    free_buffer_pool(shared);
+
+    close_table_file(dm);
+    close_table_file(other_dm);
+    remove_table("bpm_test_other");
+}
+
+END_TEST
+
+START_TEST(prefetch) {
+    DiskManager *dm = new_test_table();
+    page_id_t pids[6];
+    page_id_t first_pid = table_num_pages(dm);
+    allocate_table_pages(dm, first_pid, 6);
+    BufferPoolManager *writer = new_bpm(8, dm);
+    for (int i = 0; i < 6; i++) {
+        pids[i] = first_pid + i;
+        fetch_bpm_page(pids[i], writer, NULL)->data[PAGE_SIZE - 1] = i + 1;
+        unpin_page(pids[i], true, writer);
+    }
+    flush_all(writer);
+
+    // Each prefetched page holds its frame until its read is reaped, so only 4 reads fit
+    BufferPoolManager *pool = new_bpm(4, dm);
+    ck_assert_uint_eq(prefetch_bpm_pages(pids, 6, pool), 4);
+    ck_assert_uint_eq(prefetch_bpm_pages(pids, 4, pool), 0);
+    for (int i = 0; i < 4; i++) {
+        BpmPage *page = fetch_bpm_page(pids[i], pool, NULL);
+        ck_assert_ptr_nonnull(page);
+        ck_assert_uint_eq(page->data[PAGE_SIZE - 1], i + 1);
+        ck_assert_int_eq(page->pin_count, 1); // the caller's pin only
+        unpin_page(pids[i], false, pool);
+    }
+    ck_assert_uint_eq(pool->pool->prefetch_reads, 4);
+    ck_assert_uint_eq(pool->pool->fetch_misses, 0);
+
+    // Completed prefetches give their frames up to fetches of other pages
+    ck_assert_uint_eq(prefetch_bpm_pages(pids + 2, 4, pool), 2);
+    BpmPage *page = fetch_bpm_page(pids[0], pool, NULL);
+    ck_assert_ptr_nonnull(page);
+    ck_assert_uint_eq(page->data[PAGE_SIZE - 1], 1);
+    unpin_page(pids[0], false, pool);
+
+    // A damaged page is dropped once its read is reaped
+    u8 garbage = 0xAB;
+    write_bytes((off_t)pids[1] * PAGE_SIZE + PAGE_SIZE / 2, dm, &garbage, 1);
+    BufferPoolManager *other_pool = new_bpm(2, dm);
+    ck_assert_uint_eq(prefetch_bpm_pages(pids + 1, 1, other_pool), 1);
+    ck_assert_ptr_null(fetch_bpm_page(pids[1], other_pool, NULL));
+    ck_assert_uint_eq(other_pool->pool->checksum_failures, 1);
+    ck_assert_uint_eq(find_frame(pids[1], other_pool), NO_FRAME);
+    ck_assert_uint_eq(other_pool->pool->shards[0].num_free, 2);
+
+    // A read that fails is counted apart from damaged pages
+    page_id_t past_end = first_pid + 6;
+    ck_assert_uint_eq(prefetch_bpm_pages(&past_end, 1, other_pool), 1);
+    ck_assert_ptr_null(fetch_bpm_page(past_end, other_pool, NULL));
+    ck_assert_uint_eq(other_pool->pool->prefetch_failures, 1);
+    ck_assert_uint_eq(other_pool->pool->checksum_failures, 1);
+    ck_assert_uint_eq(other_pool->pool->shards[0].num_free, 2);
+
+    // Reads still in flight are waited for before the pool is freed
+    BufferPool *freed = pool->pool;
+    prefetch_bpm_pages(pids, 6, pool);
+    detach_bpm(pool);
+    free_buffer_pool(freed);
+    freed = other_pool->pool;
+    detach_bpm(other_pool);
+    free_buffer_pool(freed);
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+typedef struct {
+    BufferPoolManager *bpm;
+    page_id_t first_pid;
+    bool ok;
+} ResizeWorker;
+
+static void *fetch_while_resizing(void *arg) {
+    ResizeWorker *worker = (ResizeWorker *)arg;
+    worker->ok = true;
+    for (u32 i = 0; i < 2000; i++) {
+        page_id_t pid = worker->first_pid + i % 24;
+        BpmPage *page = fetch_bpm_page(pid, worker->bpm, NULL);
+        worker->ok &= page != NULL && page->id == pid;
+        worker->ok &= unpin_page(pid, false, worker->bpm);
+    }
+    return NULL;
+}
+
+START_TEST(resize) {
+    DiskManager *dm = new_test_table();
+    page_id_t first_pid = table_num_pages(dm);
+    allocate_table_pages(dm, first_pid, 32);
+    BufferPool *pool = new_resizable_buffer_pool(8, 16, 2, REPLACER_CLOCK);
+    BufferPoolManager *resized = attach_bpm(pool, dm);
+    ck_assert_uint_eq(pool->max_pool_size, 16);
+    ck_assert_uint_eq(pool->shards[1].first_frame, 8);
+
+    for (page_id_t pid = first_pid; pid < first_pid + 8; pid++) {
+        fetch_bpm_page(pid, resized, NULL)->data[PAGE_SIZE - 1] = pid - first_pid + 1;
+        unpin_page(pid, true, resized);
+    }
+    // Keep a page pinned in a frame the shrink cuts off
+    page_id_t pinned_pid = first_pid;
+    while (find_frame(pinned_pid, resized) - BPM_SHARD(pool, 0, pinned_pid)->first_frame < 2)
+        pinned_pid++;
+    fetch_bpm_page(pinned_pid, resized, NULL);
+
+    ck_assert(resize_buffer_pool(pool, 4));
+    ck_assert_uint_eq(pool->pool_size, 4);
+    u32 cached = 0;
+    // Pages still cached were not written, those of the frames retired were
+    for (page_id_t pid = first_pid; pid < first_pid + 8; pid++) {
+        bool is_cached = find_frame(pid, resized) != NO_FRAME;
+        cached += is_cached;
+        u8 *page = read_page(pid, dm);
+        ck_assert_uint_eq(page[PAGE_SIZE - 1], is_cached ? 0 : pid - first_pid + 1);
+        free(page);
+    }
+    ck_assert_uint_eq(cached, 5); // the pages of the frames kept, and the pinned one
+    for (page_id_t pid = first_pid + 8; pid < first_pid + 16; pid++) {
+        BpmPage *page = fetch_bpm_page(pid, resized, NULL);
+        BpmShard *shard = BPM_SHARD(pool, 0, pid);
+        ck_assert_uint_lt(page - pool->pages, shard->first_frame + shard->num_frames);
+        unpin_page(pid, false, resized);
+    }
+    // The cut off frame retires with the last unpin of its page
+    ck_assert_uint_ne(find_frame(pinned_pid, resized), NO_FRAME);
+    unpin_page(pinned_pid, true, resized);
+    ck_assert_uint_eq(find_frame(pinned_pid, resized), NO_FRAME);
+    u8 *page = read_page(pinned_pid, dm);
+    ck_assert_uint_eq(page[PAGE_SIZE - 1], pinned_pid - first_pid + 1);
+    free(page);
+
+    ck_assert(!resize_buffer_pool(pool, 17));
+    ck_assert(!resize_buffer_pool(pool, 1));
+    ck_assert(resize_buffer_pool(pool, 16));
+    for (page_id_t pid = first_pid + 16; pid < first_pid + 32; pid++)
+        ck_assert_ptr_nonnull(fetch_bpm_page(pid, resized, NULL));
+    for (page_id_t pid = first_pid + 16; pid < first_pid + 32; pid++)
+        unpin_page(pid, false, resized);
+
+    // Fetches go on while the pool shrinks and grows
+    ResizeWorker worker = {.bpm = resized, .first_pid = first_pid, .ok = false};
+    pthread_t thread;
+    pthread_create(&thread, NULL, fetch_while_resizing, &worker);
+    for (int i = 0; i < 50; i++)
+        ck_assert(resize_buffer_pool(pool, i % 2 ? 16 : 2));
+    pthread_join(thread, NULL);
+    ck_assert(worker.ok);
+    detach_bpm(resized);
+    free_buffer_pool(pool);
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+START_TEST(checkpoint_test) {
+    DiskManager *dm = new_test_table();
+    page_id_t first_pid = table_num_pages(dm);
+    allocate_table_pages(dm, first_pid, 64);
+    BufferPoolManager *pool = new_sharded_bpm(64, 4, dm);
+
+    // Every other page dirty, in no particular order
+    for (page_id_t i = 0; i < 64; i++) {
+        page_id_t pid = first_pid + (i * 37) % 64;
+        fetch_bpm_page(pid, pool, NULL)->data[PAGE_SIZE - 1] = pid % 2 ? 0 : pid % 251 + 1;
+        unpin_page(pid, pid % 2 == 0, pool);
+    }
+    ck_assert_uint_eq(checkpoint(pool, 0), 32);
+    for (page_id_t pid = first_pid; pid < first_pid + 64; pid++) {
+        frame_id_t fid = find_frame(pid, pool);
+        ck_assert_uint_ne(fid, NO_FRAME);
+        ck_assert(!pool->pool->pages[fid].is_dirty);
+        u8 *page = read_page(pid, dm);
+        ck_assert_uint_eq(page[PAGE_SIZE - 1], pid % 2 ? 0 : pid % 251 + 1);
+        free(page);
+    }
+    ck_assert_uint_eq(checkpoint(pool, 0), 0);
+
+    // 40 pages at 200 pages per second go in two batches a tenth of a second apart
+    for (page_id_t pid = first_pid; pid < first_pid + 40; pid++) {
+        fetch_bpm_page(pid, pool, NULL)->data[0] = 1;
+        unpin_page(pid, true, pool);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ck_assert_uint_eq(checkpoint(pool, 200), 40);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ck_assert_int_ge((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000, 90);
+
+    close_table_file(dm);
+}
+
+END_TEST
+
+typedef struct {
+    BufferPoolManager *bpm;
+    page_id_t pid;
+    bool stop;
+} LatchedWriter;
+
+// Rewrites the second half of a page with a new byte in two steps, holding its frame's latch like a WritePageGuard
+static void *rewrite_latched(void *arg) {
+    LatchedWriter *writer = (LatchedWriter *)arg;
+    for (u8 round = 1; !__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE); round = round % 250 + 1) {
+        BpmPage *page = fetch_bpm_page(writer->pid, writer->bpm, NULL);
+        RWLOCK_WRLOCK(&page->latch);
+        memset(page->data + PAGE_SIZE / 2, round, PAGE_SIZE / 4);
+        sched_yield();
+        memset(page->data + 3 * PAGE_SIZE / 4, round, PAGE_SIZE / 4);
+        RWLOCK_UNLOCK(&page->latch);
+        unpin_page(writer->pid, true, writer->bpm);
+    }
+    return NULL;
+}
+
+// Checkpoints, flush_all and flush_page never write a page a writer is halfway through modifying, nor starve behind it
+START_TEST(checkpoint_latched_pages) {
+    DiskManager *dm = new_test_table();
+    page_id_t first_pid = table_num_pages(dm);
+    allocate_table_pages(dm, first_pid, 1);
+    BufferPoolManager *pool = new_bpm(4, dm);
+
+    LatchedWriter writer = {.bpm = pool, .pid = first_pid, .stop = false};
+    pthread_t thread;
+    pthread_create(&thread, NULL, rewrite_latched, &writer);
+    for (int i = 0; i < 50; i++) {
+        if (i % 3 == 0)
+            checkpoint(pool, 0);
+        else if (i % 3 == 1)
+            flush_all(pool);
+        else
+            ck_assert(flush_page(first_pid, pool));
+        u8 *page = read_page(first_pid, dm);
+        ck_assert_uint_eq(page[PAGE_SIZE / 2], page[PAGE_SIZE - 1]);
+        free(page);
+    }
+    __atomic_store_n(&writer.stop, true, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    close_table_file(dm);
 }
 
 END_TEST
@@ -93,6 +672,17 @@ Suite *page_suite(void) {
     tcase_add_test(tc_core, pin);
     tcase_add_test(tc_core, unpin);
     tcase_add_test(tc_core, flush_page_test);
+    tcase_add_test(tc_core, checksum_mismatch);
+    tcase_add_test(tc_core, sharded_pool);
+    tcase_add_test(tc_core, concurrent_misses);
+    tcase_add_test(tc_core, background_writer);
+    tcase_add_test(tc_core, replacement_policies);
+    tcase_add_test(tc_core, bulk_scan_strategy);
+    tcase_add_test(tc_core, shared_pool);
+    tcase_add_test(tc_core, prefetch);
+    tcase_add_test(tc_core, resize);
+    tcase_add_test(tc_core, checkpoint_test);
+    tcase_add_test(tc_core, checkpoint_latched_pages);
 
     tcase_add_checked_fixture(tc_core, NULL, teardown);
 
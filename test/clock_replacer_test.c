@@ -4,20 +4,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static char *frame_to_str(frame_id_t frame_id) {
-    char *str = (char *)malloc(sizeof(char) * 11);
-    snprintf(str, 11, "%d", frame_id);
-    return str;
-}
-
 static ClockReplacer *replacer;
 
 START_TEST(initialize) {
     size_t size = 10;
     replacer = clock_replacer_init(size);
-    ck_assert_ptr_null(replacer->hand);
+    ck_assert_uint_eq(replacer->hand, 0);
     ck_assert_int_eq(replacer->num_pages, size);
-    ck_assert_ptr_nonnull(replacer->frame_table);
+    ck_assert_uint_eq(clock_replacer_size(replacer), 0);
     ck_assert_ptr_nonnull(replacer->frames);
 }
 
@@ -26,47 +20,60 @@ START_TEST(pin_unpin) {
         /**
          * UNPIN
          */
-        frame_id_t *fid_ptr = (frame_id_t *)malloc(sizeof(frame_id_t));
-        *fid_ptr = fid;
-        clock_replacer_unpin(fid_ptr, replacer);
-
-        char *fid_str = (char *)malloc(sizeof(char) * 11);
-        snprintf(fid_str, 11, "%d", fid);
-        HashEl *found = hash_find(fid_str, replacer->frame_table);
-        ck_assert_ptr_nonnull(found);
-        ck_assert_str_eq(found->key, fid_str);
-        ck_assert_int_eq(*(bool *)found->data, 1);
+        clock_replacer_unpin(&fid, replacer);
+        ck_assert_uint_eq(clock_replacer_size(replacer), 1);
+        ck_assert_uint_eq(replacer->frames[fid], CLOCK_EVICTABLE | CLOCK_REFERENCED);
 
         /**
          * PIN
          */
-        clock_replacer_pin(fid_ptr, replacer);
-        HashEl *found_fid = hash_find(frame_to_str(fid), replacer->frame_table);
-        ck_assert_ptr_null(found_fid);
+        clock_replacer_pin(&fid, replacer);
+        ck_assert_uint_eq(clock_replacer_size(replacer), 0);
+        ck_assert_uint_eq(replacer->frames[fid], 0);
     }
+
+    // Frames the replacer does not track are ignored
+    frame_id_t outside = 10;
+    clock_replacer_unpin(&outside, replacer);
+    ck_assert_uint_eq(clock_replacer_size(replacer), 0);
 }
 
 START_TEST(victim) {
-    for (frame_id_t fid = 0; fid < 3; fid++) {
-        frame_id_t *fid_ptr = (frame_id_t *)malloc(sizeof(frame_id_t));
-        *fid_ptr = fid;
-        clock_replacer_unpin(fid_ptr, replacer);
-    }
+    for (frame_id_t fid = 0; fid < 3; fid++)
+        clock_replacer_unpin(&fid, replacer);
+
+    /**
+     * Every frame was referenced: the first sweep clears the reference bits and the second evicts the frame under the
+     * hand, frame 0
+     */
     frame_id_t vic_full_fid = evict(replacer);
-    ck_assert_uint_eq(vic_full_fid, UINT32_MAX);
+    ck_assert_uint_eq(vic_full_fid, 0);
 
     /**
-     * Unpin frames 0 and 1. Leave frame 2 pinned
+     * Reference frame 1 again, so it gets a second chance and frame 2 is evicted
      */
-    for (frame_id_t fid = 0; fid < 2; fid++) {
-        frame_id_t *fid_ptr = (frame_id_t *)malloc(sizeof(frame_id_t));
-        *fid_ptr = fid;
-        clock_replacer_unpin(fid_ptr, replacer);
-    }
-    frame_id_t *fid_ptr = (frame_id_t *)malloc(sizeof(frame_id_t));
-    *fid_ptr = 2;
+    frame_id_t fid = 1;
+    clock_replacer_unpin(&fid, replacer);
     frame_id_t vic_nonfull_fid = evict(replacer);
-    ck_assert_uint_eq(vic_nonfull_fid, *fid_ptr);
+    ck_assert_uint_eq(vic_nonfull_fid, 2);
+    ck_assert_uint_eq(evict(replacer), 1);
+    ck_assert_uint_eq(evict(replacer), UINT32_MAX);
+}
+
+// A replacer of a buffer pool shard tracks a range of frames not starting at 0
+START_TEST(frame_range) {
+    ClockReplacer shard_replacer;
+    ck_assert(clock_replacer_init_frames(&shard_replacer, 100, 4));
+    for (frame_id_t fid = 99; fid < 105; fid++)
+        clock_replacer_unpin(&fid, &shard_replacer);
+    ck_assert_uint_eq(clock_replacer_size(&shard_replacer), 4);
+
+    frame_id_t ahead[4];
+    ck_assert_uint_eq(evict(&shard_replacer), 100);
+    ck_assert_uint_eq(clock_replacer_frames_ahead(&shard_replacer, ahead, 4), 3);
+    ck_assert_uint_eq(ahead[0], 101);
+    ck_assert_uint_eq(ahead[2], 103);
+    clock_replacer_destroy(&shard_replacer);
 }
 
 END_TEST
@@ -82,6 +89,7 @@ Suite *page_suite(void) {
     tcase_add_test(tc_core, initialize);
     tcase_add_test(tc_core, pin_unpin);
     tcase_add_test(tc_core, victim);
+    tcase_add_test(tc_core, frame_range);
     suite_add_tcase(s, tc_core);
 
     return s;
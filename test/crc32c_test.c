@@ -0,0 +1,83 @@
+#include "../include/utils/crc32c.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUF_SIZE 8192
+
+START_TEST(known_values) {
+    ck_assert_uint_eq(crc32c("", 0), 0);
+    ck_assert_uint_eq(crc32c("123456789", 9), 0xE3069283);
+    ck_assert_uint_eq(crc32c_update_sw(0, "123456789", 9), 0xE3069283);
+
+    // 32 zero bytes and 32 0xFF bytes (RFC 3720, B.4)
+    uint8_t buf[32];
+    memset(buf, 0, sizeof(buf));
+    ck_assert_uint_eq(crc32c(buf, sizeof(buf)), 0x8A9136AA);
+    memset(buf, 0xFF, sizeof(buf));
+    ck_assert_uint_eq(crc32c(buf, sizeof(buf)), 0x62A8AB43);
+}
+
+END_TEST
+
+// Hardware and table-driven checksums agree for any length and alignment, page-sized buffers included
+START_TEST(hardware_matches_table) {
+    static uint8_t buf[BUF_SIZE + 8];
+    srand(42);
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = rand();
+
+    size_t lengths[] = {1, 7, 8, 9, 63, 1000, 4079, 4080, 4087, 4096, 4100, BUF_SIZE};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (size_t align = 0; align < 8; align++) {
+            uint32_t expected = crc32c_update_sw(0, buf + align, lengths[l]);
+            ck_assert_uint_eq(crc32c(buf + align, lengths[l]), expected);
+        }
+    }
+}
+
+END_TEST
+
+START_TEST(update_chains) {
+    static uint8_t buf[BUF_SIZE];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = i * 31;
+
+    uint32_t whole = crc32c(buf, sizeof(buf));
+    for (size_t split = 0; split <= sizeof(buf); split += 1021)
+        ck_assert_uint_eq(crc32c_update(crc32c(buf, split), buf + split, sizeof(buf) - split), whole);
+}
+
+END_TEST
+
+Suite *crc32c_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Crc32c");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, known_values);
+    tcase_add_test(tc_core, hardware_matches_table);
+    tcase_add_test(tc_core, update_chains);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = crc32c_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
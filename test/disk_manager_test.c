@@ -0,0 +1,218 @@
+#include "../include/disk/disk_manager.h"
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUN_PAGES 300 // more than a single preadv/pwritev batch
+
+static const char table_name[20] = "disk_manager_test";
+static u8 out_pages[RUN_PAGES][PAGE_SIZE];
+static u8 in_pages[RUN_PAGES][PAGE_SIZE];
+
+void teardown(void) { remove_table(table_name); }
+
+static void page_iovecs(u8 pages[][PAGE_SIZE], u32 count, struct iovec *iovecs) {
+    for (u32 i = 0; i < count; i++)
+        iovecs[i] = (struct iovec){.iov_base = pages[i], .iov_len = PAGE_SIZE};
+}
+
+START_TEST(write_read_page_run) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    struct iovec iovecs[RUN_PAGES];
+
+    for (u32 i = 0; i < RUN_PAGES; i++)
+        memset(out_pages[i], i % 251 + 1, PAGE_SIZE);
+    page_iovecs(out_pages, RUN_PAGES, iovecs);
+    write_pages(2, RUN_PAGES, disk_mgr, iovecs);
+
+    page_iovecs(in_pages, RUN_PAGES, iovecs);
+    ck_assert_uint_eq(read_pages(2, RUN_PAGES, disk_mgr, iovecs), RUN_PAGES);
+    for (u32 i = 0; i < RUN_PAGES; i++)
+        ck_assert_int_eq(memcmp(in_pages[i], out_pages[i], PAGE_SIZE), 0);
+
+    // Single page API sees the same layout
+    u8 *page = read_page(2 + RUN_PAGES - 1, disk_mgr);
+    ck_assert_int_eq(memcmp(page, out_pages[RUN_PAGES - 1], PAGE_SIZE), 0);
+    free(page);
+
+    close_table_file(disk_mgr);
+}
+
+END_TEST
+
+START_TEST(read_run_past_eof) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    struct iovec iovecs[RUN_PAGES];
+
+    page_iovecs(out_pages, 10, iovecs);
+    write_pages(0, 10, disk_mgr, iovecs);
+
+    page_iovecs(in_pages, RUN_PAGES, iovecs);
+    ck_assert_uint_eq(read_pages(4, 20, disk_mgr, iovecs), 6);
+    ck_assert_uint_eq(read_pages(10, 5, disk_mgr, iovecs), 0);
+
+    close_table_file(disk_mgr);
+}
+
+END_TEST
+
+// Passes on filesystems without O_DIRECT support as well, since pages then keep going through the page cache
+START_TEST(direct_io_page_transfers) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    struct iovec iovecs[RUN_PAGES];
+    u8 *aligned = NULL;
+    ck_assert_int_eq(posix_memalign((void **)&aligned, PAGE_SIZE, PAGE_SIZE), 0);
+
+    page_iovecs(out_pages, 4, iovecs);
+    write_pages(0, 4, disk_mgr, iovecs);
+    bool direct = set_direct_io(disk_mgr, true);
+    ck_assert(disk_mgr->direct_io == direct);
+
+    // Aligned buffer
+    read_page_into(1, disk_mgr, aligned);
+    ck_assert_int_eq(memcmp(aligned, out_pages[1], PAGE_SIZE), 0);
+    memset(aligned, 0x5A, PAGE_SIZE);
+    write_page(2, disk_mgr, aligned);
+
+    // Unaligned buffer
+    u8 unaligned_buf[PAGE_SIZE + 1];
+    read_page_into(2, disk_mgr, unaligned_buf + 1);
+    ck_assert_int_eq(memcmp(unaligned_buf + 1, aligned, PAGE_SIZE), 0);
+    write_page(3, disk_mgr, unaligned_buf + 1);
+
+    ck_assert(set_direct_io(disk_mgr, false) == false);
+    ck_assert_int_eq(disk_mgr->direct_fd, -1);
+    page_iovecs(in_pages, 4, iovecs);
+    ck_assert_uint_eq(read_pages(0, 4, disk_mgr, iovecs), 4);
+    ck_assert_int_eq(memcmp(in_pages[0], out_pages[0], PAGE_SIZE), 0);
+    ck_assert_int_eq(memcmp(in_pages[3], aligned, PAGE_SIZE), 0);
+
+    free(aligned);
+    close_table_file(disk_mgr);
+}
+
+END_TEST
+
+START_TEST(sequential_read_detection) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    ReadAhead *ra = &disk_mgr->readahead;
+    struct iovec iovecs[RUN_PAGES];
+    page_iovecs(out_pages, RUN_PAGES, iovecs);
+    write_pages(0, RUN_PAGES, disk_mgr, iovecs);
+
+    // Nothing is hinted before the run is long enough
+    u8 page[PAGE_SIZE];
+    for (page_id_t pid = 0; pid < READAHEAD_TRIGGER - 1; pid++)
+        read_page_into(pid, disk_mgr, page);
+    ck_assert_uint_eq(ra->run_length, READAHEAD_TRIGGER - 1);
+    ck_assert_uint_eq(ra->window_end, 0);
+
+    // Windows double as the run goes on and always stay ahead of the reader
+    for (page_id_t pid = READAHEAD_TRIGGER - 1; pid < 200; pid++) {
+        read_page_into(pid, disk_mgr, page);
+        ck_assert_uint_gt(ra->window_end, pid + 1);
+    }
+    ck_assert_uint_eq(ra->window, READAHEAD_MAX_PAGES);
+    ck_assert(!ra->sequential);
+
+    // Vectored reads continue the run
+    page_iovecs(in_pages, RUN_PAGES - 200, iovecs);
+    read_pages(200, RUN_PAGES - 200, disk_mgr, iovecs);
+    ck_assert_uint_eq(ra->run_length, RUN_PAGES);
+    ck_assert_uint_eq(ra->next_pid, RUN_PAGES);
+
+    // A jump ends the run
+    read_page_into(5, disk_mgr, page);
+    ck_assert_uint_eq(ra->run_length, 1);
+    ck_assert_uint_eq(ra->window_end, 0);
+    ck_assert_uint_eq(ra->window, READAHEAD_MIN_PAGES);
+
+    // Disabled detection leaves the state alone
+    disk_mgr->readahead_max_pages = 0;
+    read_page_into(6, disk_mgr, page);
+    ck_assert_uint_eq(ra->run_length, 1);
+
+    close_table_file(disk_mgr);
+}
+
+END_TEST
+
+// Segment files are sparse, so this only writes a few pages on either side of the first boundary
+START_TEST(pages_across_segments) {
+    DiskManager *disk_mgr = new_disk_manager(table_name);
+    struct iovec iovecs[RUN_PAGES];
+    page_id_t first = TABLE_SEGMENT_PAGES - 3;
+    for (u32 i = 0; i < 6; i++)
+        memset(out_pages[i], i + 1, PAGE_SIZE);
+
+    // Only allocating pages creates a segment, looking a page of a missing one up doesn't
+    off_t offset;
+    ck_assert_int_eq(page_fd(disk_mgr, first + 3, NULL, &offset), -1);
+    ck_assert_int_ne(access("db_files/disk_manager_test.db.1", F_OK), 0);
+    ck_assert(allocate_table_pages(disk_mgr, first, 6));
+
+    page_iovecs(out_pages, 4, iovecs);
+    write_pages(first, 4, disk_mgr, iovecs);
+    write_page(first + 4, disk_mgr, out_pages[4]);
+    write_page(first + 5, disk_mgr, out_pages[5]);
+    ck_assert_uint_eq(disk_mgr->num_segments, 2);
+    ck_assert_uint_eq(table_num_pages(disk_mgr), (u64)first + 6);
+    ck_assert_int_eq(access("db_files/disk_manager_test.db.1", F_OK), 0);
+
+    page_iovecs(in_pages, RUN_PAGES, iovecs);
+    ck_assert_uint_eq(read_pages(first, RUN_PAGES, disk_mgr, iovecs), 6);
+    for (u32 i = 0; i < 6; i++)
+        ck_assert_int_eq(memcmp(in_pages[i], out_pages[i], PAGE_SIZE), 0);
+
+    // A second disk manager opens the segment on its first access
+    DiskManager *other = new_disk_manager(table_name);
+    u8 page[PAGE_SIZE];
+    read_page_into(TABLE_SEGMENT_PAGES + 1, other, page);
+    ck_assert_int_eq(memcmp(page, out_pages[4], PAGE_SIZE), 0);
+    close_table_file(other);
+
+    ck_assert(allocate_table_pages(disk_mgr, TABLE_SEGMENT_PAGES + 3, 8));
+    ck_assert_uint_eq(table_num_pages(disk_mgr), TABLE_SEGMENT_PAGES + 11);
+
+    close_table_file(disk_mgr);
+    remove_table(table_name);
+    ck_assert_int_ne(access("db_files/disk_manager_test.db.1", F_OK), 0);
+}
+
+END_TEST
+
+Suite *page_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("DiskManager");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, write_read_page_run);
+    tcase_add_test(tc_core, read_run_past_eof);
+    tcase_add_test(tc_core, direct_io_page_transfers);
+    tcase_add_test(tc_core, sequential_read_detection);
+    tcase_add_test(tc_core, pages_across_segments);
+    tcase_add_checked_fixture(tc_core, NULL, teardown);
+
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = page_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
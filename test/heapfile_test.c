@@ -1,5 +1,6 @@
 #include "../include/disk/disk_manager.h"
 #include "../include/disk/heapfile.h"
+#include "../include/disk/page_directory.h"
 #include "../include/utils/serialize.h"
 #include <check.h>
 #include <dirent.h>
@@ -21,6 +22,7 @@ static const char add_tab2[15] = "test_table2";
 static const char add_tab3[15] = "test_table3";
 static const char add_page_tab[15] = "add_page_test";
 static const char add_tuple_tab[25] = "add_tuple_to_page_test";
+static const char grow_tab[20] = "grow_table_test";
 static TuplePtr *t_ptr1, *t_ptr2, *t_ptr3;
 
 void add_table_teardown(void) {
@@ -31,10 +33,13 @@ void add_table_teardown(void) {
 
 void add_page_teardown(void) { remove_table(add_page_tab); }
 
+void grow_table_teardown(void) { remove_table(grow_tab); }
+
 void add_tuple_teardown(void) {
     remove_table(add_tuple_tab);
     free(t_ptr1);
     free(t_ptr2);
+    t_ptr1 = t_ptr2 = NULL;
 }
 
 START_TEST(add_table) {
@@ -65,12 +70,16 @@ START_TEST(add_table) {
         int fd = open(path, O_RDONLY);
         uint8_t header_buf[PAGE_SIZE];
         read(fd, header_buf, PAGE_SIZE);
-        for (uint16_t i = 0; i < MAX_PAGES; i++) {
-            uint16_t pid = decode_uint16(header_buf + (i * 4));
-            uint16_t free_space = decode_uint16(header_buf + (i * 4) + 2);
-            ck_assert_int_eq(pid, i);
-            ck_assert_int_eq(free_space, PAGE_SIZE);
+        for (uint16_t i = 0; i < DIR_GROUP_PAGES; i++) {
+            uint8_t bucket = header_buf[DIR_GROUP_PAGES + i];
+            if (i < START_USER_PAGE || i >= TABLE_EXTENT_PAGES)
+                ck_assert_int_eq(bucket, 0); // system pages and pages past the first extent
+            else
+                ck_assert_int_eq(bucket, FSM_UNUSED);
         }
+        ck_assert_int_eq(header_buf[1], FSM_UNUSED); // root of the directory page's max-tree
+        ck_assert_int_eq(lseek(fd, 0, SEEK_END), TABLE_EXTENT_PAGES * PAGE_SIZE);
+        close(fd);
 
         dir_file_count++;
     }
@@ -163,7 +172,8 @@ START_TEST(add_tuple_to_page) {
 
     // assert correctness of tuple retreival from disk
     RID rid = {.pid = pid, .slot_num = 0};
-    uint8_t *tuple_data = get_tuple(rid, disk_mgr);
+    uint8_t tuple_page[PAGE_SIZE];
+    uint8_t *tuple_data = get_tuple(rid, disk_mgr, tuple_page);
     uint8_t tuple_data_buf[t_ptr1->size];
     memcpy(tuple_data_buf, tuple_data, sizeof(uint16_t)); // tuple's "name" string length
     ck_assert_uint_eq(decode_uint16(tuple_data_buf), name_len);
@@ -273,6 +283,97 @@ START_TEST(remove_tuple_and_defragment) {
 
 END_TEST
 
+START_TEST(grow_table) {
+    char cname[5] = "name";
+    Column cols[1] = {{.name_len = 4, .name = cname, .type = STRING}};
+    DiskManager *disk_mgr = create_table(grow_tab, cols, 1);
+    set_sync_policy(disk_mgr, SYNC_ON_CHECKPOINT, 0);
+    PageDirectory *dir = disk_mgr->page_directory;
+    ck_assert_uint_eq(dir->num_pages, TABLE_EXTENT_PAGES);
+
+    // Tuples big enough to fill a page each, so the table grows past the first directory group
+    static char name[2100];
+    memset(name, 'a', sizeof(name) - 1);
+    const char *col_names[1] = {"name"};
+    ColumnType col_types[1] = {STRING};
+    ColumnValue col_vals[1] = {{.string = name}};
+    TuplePtr tup_ptr;
+    AddTupleArgs args = {.disk_manager = disk_mgr,
+                         .column_names = col_names,
+                         .column_values = col_vals,
+                         .column_types = col_types,
+                         .num_columns = 1,
+                         .tup_ptr_out = &tup_ptr};
+    const u32 num_tuples = DIR_GROUP_PAGES + 10;
+    for (u32 i = 0; i < num_tuples; i++)
+        add_tuple(&args);
+
+    ck_assert_uint_gt(dir->num_pages, DIR_GROUP_PAGES + START_USER_PAGE);
+    ck_assert_uint_eq(dir->num_pages % TABLE_EXTENT_PAGES, 0);
+    ck_assert_int_eq(lseek(disk_mgr->fd, 0, SEEK_END), (off_t)dir->num_pages * PAGE_SIZE);
+
+    // The second directory page is never handed out, tuples continue right after it
+    ck_assert_uint_eq(page_free_bucket(dir, DIR_GROUP_PAGES), 0);
+    ck_assert_uint_lt(page_free_bucket(dir, DIR_GROUP_PAGES - 1), FSM_UNUSED);
+    ck_assert_uint_lt(page_free_bucket(dir, DIR_GROUP_PAGES + 1), FSM_UNUSED);
+
+    // Every full page still has room for a small tuple, which goes to the first page
+    page_id_t pid;
+    ck_assert(find_free_page(disk_mgr, 100, &pid));
+    ck_assert_uint_eq(pid, START_USER_PAGE);
+    ck_assert(find_free_page(disk_mgr, PAGE_UNUSED, &pid));
+    ck_assert_uint_eq(pid, DIR_GROUP_PAGES + 1 + num_tuples - (DIR_GROUP_PAGES - START_USER_PAGE));
+
+    // Buckets are persisted in the directory page of their group, with their max-tree above them
+    uint8_t dir_page[PAGE_SIZE];
+    read_page_into(DIR_GROUP_PAGES, disk_mgr, dir_page);
+    ck_assert_uint_eq(dir_page[DIR_GROUP_PAGES], 0);
+    ck_assert_uint_eq(dir_page[DIR_GROUP_PAGES + 1], page_free_bucket(dir, DIR_GROUP_PAGES + 1));
+    ck_assert_uint_eq(dir_page[DIR_GROUP_PAGES + dir->num_pages - 1 - DIR_GROUP_PAGES], FSM_UNUSED);
+    ck_assert_uint_eq(dir_page[1], FSM_UNUSED);
+
+    // Freeing space on a page makes it the first candidate again
+    set_page_free_space(disk_mgr, START_USER_PAGE + 5, 3000);
+    ck_assert(find_free_page(disk_mgr, 2500, &pid));
+    ck_assert_uint_eq(pid, START_USER_PAGE + 5);
+
+    // Reopening the table restores the same directory, both groups included, and the cached schema
+    u32 num_pages = dir->num_pages;
+    u8 buckets[DIR_GROUP_PAGES + 10];
+    for (page_id_t p = 0; p < sizeof(buckets); p++)
+        buckets[p] = page_free_bucket(dir, p);
+    close_table_file(disk_mgr);
+
+    disk_mgr = open_table(grow_tab);
+    ck_assert_ptr_nonnull(disk_mgr);
+    dir = disk_mgr->page_directory;
+    ck_assert_uint_eq(dir->num_pages, num_pages);
+    for (page_id_t p = 0; p < sizeof(buckets); p++)
+        ck_assert_uint_eq(page_free_bucket(dir, p), buckets[p]);
+    ck_assert(find_free_page(disk_mgr, 2500, &pid));
+    ck_assert_uint_eq(pid, START_USER_PAGE + 5);
+    ck_assert_uint_eq(disk_mgr->schema_page[0], 1);
+
+    // A small tuple lands on the first page, right below its big one
+    col_vals[0].string = "bob";
+    args.disk_manager = disk_mgr;
+    add_tuple(&args);
+    ck_assert_uint_eq(tup_ptr.size, sizeof(uint16_t) + 3);
+    ck_assert_uint_eq(tup_ptr.start_offset, PAGE_SIZE - 1 - (sizeof(uint16_t) + strlen(name)) - tup_ptr.size);
+
+    close_table_file(disk_mgr);
+    ck_assert_ptr_null(open_table("missing_table_test"));
+
+    // Files of other kinds are not opened as tables
+    DiskManager *index_mgr = create_btree_index("open_table_index_test", 4);
+    new_btree_index_page(index_mgr, true);
+    close_table_file(index_mgr);
+    ck_assert_ptr_null(open_table("open_table_index_test"));
+    remove_table("open_table_index_test");
+}
+
+END_TEST
+
 // for some reason there is a segfault in srunner_run_all() when running with tsan if this doesnt exist??
 START_TEST(x) { return; }
 
@@ -291,10 +392,12 @@ Suite *page_suite(void) {
     tcase_add_test(tc_core, add_page);
     tcase_add_test(tc_core, add_tuple_to_page);
     tcase_add_test(tc_core, remove_tuple_and_defragment);
+    tcase_add_test(tc_core, grow_table);
 
     tcase_add_checked_fixture(tc_core, NULL, add_table_teardown);
     tcase_add_checked_fixture(tc_core, NULL, add_page_teardown);
     tcase_add_checked_fixture(tc_core, NULL, add_tuple_teardown);
+    tcase_add_checked_fixture(tc_core, NULL, grow_table_teardown);
 
     suite_add_tcase(s, tc_core);
 
@@ -87,7 +87,7 @@ class IndexTestFixture : public testing::Test {
     }
 
     // Fetches the btree page/node of provided pid from the buffer pool and forms a BTreePage object out of it
-    BTreePage GetNode(page_id_t pid, BTree tree) { return BTreePage(fetch_bpm_page(pid, tree.bpm)->data); };
+    BTreePage GetNode(page_id_t pid, BTree tree) { return BTreePage(fetchRead(tree.bpm, pid).data()); };
 };
 
 TEST_F(IndexTestFixture, CreateIndex_SerializeAndDeserializeTree) {
@@ -116,14 +116,18 @@ TEST_F(IndexTestFixture, CreateIndex_SerializeAndDeserializeNode) {
     u8 num_pairs = page.keys.size();
 
     // write to disk
-    auto bpm_page = allocate_new_page(bpm, BTREE_INDEX_PAGE);
-    frame_id_t *frame_id =
-        static_cast<frame_id_t *>(hash_find(std::to_string(bpm_page->id).data(), bpm->page_table)->data);
-    write_to_frame(*frame_id, page.serialize(), bpm);
-    flush_page(bpm_page->id, bpm);
+    page_id_t pid;
+    {
+        u8 *page_data = page.serialize();
+        WritePageGuard guard = newPage(bpm, BTREE_INDEX_PAGE);
+        pid = guard.pid();
+        memcpy(guard.data(), page_data, PAGE_SIZE);
+        delete[] page_data;
+    }
+    flush_page(pid, bpm);
 
     // check if its correctly written to disk
-    u8 *serialized = read_page(bpm_page->id, disk_mgr);
+    u8 *serialized = read_page(pid, disk_mgr);
     EXPECT_EQ(decode_uint16(serialized + AVAILABLE_SPACE_START_OFFSET),
               INDEX_PAGE_HEADER_SIZE + (TREE_KV_PTR_SIZE * num_pairs));
     EXPECT_EQ(decode_uint16(serialized + AVAILABLE_SPACE_END_SIZE), PAGE_SIZE - (24 + 3 + 12));
@@ -161,21 +165,19 @@ TEST_F(IndexTestFixture, InsertTest_RootWithEnoughSpace) {
     RID val1 = {.pid = 4, .slot_num = 5}; // doesn't need to be actual rid
     page_id_t leaf_pid = tree.insert(key1, val1);
 
-    auto bpm_page = fetch_bpm_page(leaf_pid, tree.bpm);
-    BTreePage leaf(bpm_page->data);
+    BTreePage leaf(fetchRead(tree.bpm, leaf_pid).data());
 
     EXPECT_EQ(leaf.is_leaf, true);
-    EXPECT_EQ((char *)leaf.keys.at(0).data == data1, true);
+    EXPECT_EQ(std::string((char *)leaf.keys.at(0).data, leaf.keys.at(0).length), data1);
     EXPECT_EQ(LEAF_RECORDS(leaf.values).at(0).pid, val1.pid);
 
     // insert another and check sorting
     std::string data2 = "0";
     BTreeKey key2 = {reinterpret_cast<u8 *>(data2.data()), static_cast<u8>(data2.length())};
     leaf_pid = tree.insert(key2, val1);
-    bpm_page = fetch_bpm_page(leaf_pid, tree.bpm);
-    leaf = BTreePage(bpm_page->data);
-    EXPECT_EQ((char *)leaf.keys.at(0).data == data2, true);
-    EXPECT_EQ((char *)leaf.keys.at(1).data == data1, true);
+    leaf = BTreePage(fetchRead(tree.bpm, leaf_pid).data());
+    EXPECT_EQ(std::string((char *)leaf.keys.at(0).data, leaf.keys.at(0).length), data2);
+    EXPECT_EQ(std::string((char *)leaf.keys.at(1).data, leaf.keys.at(1).length), data1);
     EXPECT_EQ(LEAF_RECORDS(leaf.values).at(0).pid, val1.pid);
     EXPECT_EQ(LEAF_RECORDS(leaf.values).at(1).pid, val1.pid);
 }
@@ -237,6 +239,81 @@ TEST_F(IndexTestFixture, InsertTest_Splits) {
     TestEqualNode<RID>(GetNode(right_internal.rightmost_ptr, tree), {"K", "L", "M"});
 }
 
+// Nodes written by the tree stay in the buffer pool, so inserting into a tree that fits in it reads each page of the
+// index (its nodes and metadata page) from disk at most once
+TEST_F(IndexTestFixture, InsertTest_NodesStayResident) {
+    BTree tree(bpm);
+    tree.deserialize();
+    Insert(tree, {"A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M"});
+    EXPECT_LE(bpm->pool->fetch_misses, table_num_pages(disk_mgr));
+    EXPECT_GT(bpm->pool->fetch_hits, bpm->pool->fetch_misses);
+}
+
+// A node that can't be fetched fails the operation instead of being used
+TEST_F(IndexTestFixture, InsertTest_DamagedNode) {
+    BTree tree(bpm);
+    tree.deserialize();
+    Insert(tree, {"A", "B", "C", "D", "E", "F", "G", "H"});
+
+    u8 garbage = 0xAB;
+    write_bytes((off_t)tree.root_pid * PAGE_SIZE + PAGE_SIZE / 2, disk_mgr, &garbage, 1);
+    BTree cold_tree(new_bpm(100, disk_mgr));
+    cold_tree.deserialize();
+    auto idx = key_to_idx.at("I");
+    EXPECT_THROW(cold_tree.insert(keys[idx], vals[idx]), std::runtime_error);
+    EXPECT_EQ(cold_tree.bpm->pool->checksum_failures, 1);
+}
+
+// Tree operations give back every page they fetch, so the tree can grow past the size of the buffer pool
+TEST_F(IndexTestFixture, InsertTest_PoolSmallerThanTree) {
+    BufferPoolManager *small_bpm = new_bpm(4, disk_mgr);
+    BTree tree(small_bpm);
+    tree.deserialize();
+    Insert(tree, {"A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M"});
+    EXPECT_GT(tree.node_count, small_bpm->pool->pool_size);
+
+    for (size_t fid = 0; fid < small_bpm->pool->pool_size; fid++)
+        EXPECT_EQ(small_bpm->pool->pages[fid].pin_count, 0);
+
+    auto curr_root = GetNode(tree.root_pid, tree);
+    auto right_internal = GetNode(curr_root.rightmost_ptr, tree);
+    TestEqualNode<u32>(right_internal, {"I", "K"});
+    TestEqualNode<RID>(GetNode(right_internal.rightmost_ptr, tree), {"K", "L", "M"});
+}
+
+// Two indexes whose nodes have the same page ids share a buffer pool smaller than either tree without mixing them up
+TEST_F(IndexTestFixture, InsertTest_SharedPool) {
+    std::string other_index_name = index_name + "_other";
+    DiskManager *other_disk_mgr = create_btree_index(other_index_name.data(), tree_max_size);
+    other_disk_mgr->page_type = BTREE_INDEX_PAGE;
+    BufferPool *pool = new_buffer_pool(6, 1, REPLACER_CLOCK);
+    BufferPoolManager *tree_bpm = attach_bpm(pool, disk_mgr);
+    BufferPoolManager *other_tree_bpm = attach_bpm(pool, other_disk_mgr);
+    BTree tree(tree_bpm);
+    BTree other_tree(other_tree_bpm);
+    tree.deserialize();
+    other_tree.deserialize();
+
+    std::vector<std::string> inserted = {"A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M"};
+    for (size_t i = 0; i < inserted.size(); i++) {
+        Insert(tree, {inserted[i]});
+        Insert(other_tree, {inserted[inserted.size() - 1 - i]});
+    }
+    EXPECT_GT(tree.node_count + other_tree.node_count, pool->pool_size);
+
+    auto right_internal = GetNode(GetNode(tree.root_pid, tree).rightmost_ptr, tree);
+    TestEqualNode<u32>(right_internal, {"I", "K"});
+    TestEqualNode<RID>(GetNode(right_internal.rightmost_ptr, tree), {"K", "L", "M"});
+    auto other_root = GetNode(other_tree.root_pid, other_tree);
+    TestEqualNode<RID>(GetNode(other_root.rightmost_ptr, other_tree), {"K", "L", "M"});
+
+    EXPECT_TRUE(detach_bpm(tree_bpm));
+    EXPECT_TRUE(detach_bpm(other_tree_bpm));
+    free_buffer_pool(pool);
+    close_table_file(other_disk_mgr);
+    remove_table(other_index_name.data());
+}
+
 TEST_F(IndexTestFixture, RemoveTest_NoMerges) {
     BTree tree(bpm);
     tree.deserialize();
@@ -265,7 +342,7 @@ TEST_F(IndexTestFixture, RemoveTest_Merges) {
     // node left. Now we should have a tree of 1 less level
     tree.remove(keys[12]);
     BTreePage curr_root = GetNode(tree.root_pid, tree);
-    BTreePage root_rightmost(fetch_bpm_page(curr_root.rightmost_ptr, tree.bpm)->data);
+    BTreePage root_rightmost(fetchRead(tree.bpm, curr_root.rightmost_ptr).data());
     TestEqualNode<RID>(GetNode(INTERNAL_CHILDREN(curr_root.values).at(0), tree), {"A", "B"});
     TestEqualNode<RID>(GetNode(INTERNAL_CHILDREN(curr_root.values).at(1), tree), {"C", "D"});
     TestEqualNode<RID>(GetNode(INTERNAL_CHILDREN(curr_root.values).at(2), tree), {"E", "F"});
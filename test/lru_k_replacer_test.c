@@ -0,0 +1,185 @@
+#include "../include/disk/lru_k_replacer.h"
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Pins and unpins frame FID, a single reference to its page
+static void reference(LruKReplacer *replacer, frame_id_t fid) {
+    lru_k_replacer_pin(replacer, fid);
+    lru_k_replacer_unpin(replacer, fid);
+}
+
+START_TEST(backward_k_distance) {
+    LruKReplacer replacer;
+    ck_assert(lru_k_replacer_init(&replacer, 0, 4, 2, 0));
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), UINT32_MAX);
+
+    for (frame_id_t fid = 0; fid < 4; fid++)
+        reference(&replacer, fid);
+    reference(&replacer, 3);
+    reference(&replacer, 2);
+    ck_assert_uint_eq(lru_k_replacer_size(&replacer), 4);
+
+    /**
+     * Frames referenced once go first, least recently referenced first. Of the others, frame 2's second most recent
+     * reference is older, even though LRU would evict frame 3 first
+     */
+    frame_id_t ahead[4];
+    ck_assert_uint_eq(lru_k_replacer_frames_ahead(&replacer, ahead, 4), 4);
+    ck_assert_uint_eq(ahead[0], 0);
+    ck_assert_uint_eq(ahead[1], 1);
+    ck_assert_uint_eq(ahead[2], 2);
+    ck_assert_uint_eq(ahead[3], 3);
+    for (int i = 0; i < 4; i++)
+        ck_assert_uint_eq(lru_k_replacer_evict(&replacer), ahead[i]);
+    ck_assert_uint_eq(lru_k_replacer_size(&replacer), 0);
+
+    lru_k_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+START_TEST(correlated_references) {
+    LruKReplacer replacer;
+    ck_assert(lru_k_replacer_init(&replacer, 10, 4, 2, 2));
+
+    reference(&replacer, 10);
+    reference(&replacer, 10); // within the period, so the same reference
+    ck_assert_uint_eq(replacer.history[1], 0);
+
+    reference(&replacer, 11);
+    reference(&replacer, 12);
+    reference(&replacer, 13);
+    reference(&replacer, 11); // past the period
+    ck_assert_uint_ne(replacer.history[1 * 2 + 1], 0);
+
+    // Frames referenced within the period stay while others can go, even with a shorter history
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 10);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 12);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 13);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 11);
+
+    lru_k_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+START_TEST(pin_remove) {
+    LruKReplacer replacer;
+    ck_assert(lru_k_replacer_init(&replacer, 0, 3, 2, 0));
+    for (frame_id_t fid = 0; fid < 3; fid++)
+        reference(&replacer, fid);
+
+    lru_k_replacer_pin(&replacer, 0);
+    lru_k_replacer_remove(&replacer, 1);
+    ck_assert_uint_eq(lru_k_replacer_size(&replacer), 1);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 2);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), UINT32_MAX);
+
+    // A removed frame starts over with its next page
+    lru_k_replacer_pin(&replacer, 1);
+    ck_assert_uint_eq(replacer.history[1 * 2 + 1], 0);
+    lru_k_replacer_unpin(&replacer, 0);
+    lru_k_replacer_unpin(&replacer, 1);
+    ck_assert_uint_eq(lru_k_replacer_evict(&replacer), 1);
+
+    lru_k_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+// Whether REPLACER evicts frame index A before B, from the definition of the eviction order
+static bool goes_before(LruKReplacer *replacer, size_t a, size_t b) {
+    bool correlated_a = replacer->now - replacer->last_access[a] < replacer->correlated_period;
+    bool correlated_b = replacer->now - replacer->last_access[b] < replacer->correlated_period;
+    if (correlated_a != correlated_b)
+        return correlated_b;
+    u64 *history_a = replacer->history + a * replacer->k;
+    u64 *history_b = replacer->history + b * replacer->k;
+    if (history_a[replacer->k - 1] != history_b[replacer->k - 1])
+        return history_a[replacer->k - 1] < history_b[replacer->k - 1];
+    return history_a[0] < history_b[0];
+}
+
+// Evictable frame of REPLACER to be evicted first, found by comparing all of them
+static frame_id_t first_evictable(LruKReplacer *replacer) {
+    size_t first = replacer->num_pages;
+    for (size_t idx = 0; idx < replacer->num_pages; idx++) {
+        if (!(replacer->flags[idx] & LRU_K_EVICTABLE))
+            continue;
+        if (first == replacer->num_pages || goes_before(replacer, idx, first))
+            first = idx;
+    }
+    return first == replacer->num_pages ? UINT32_MAX : replacer->first_frame + (frame_id_t)first;
+}
+
+// Evictions and frames_ahead follow the eviction order through random references, removals and evictions
+START_TEST(random_references) {
+    LruKReplacer replacer;
+    ck_assert(lru_k_replacer_init(&replacer, 100, 32, 2, 3));
+    frame_id_t ahead[32];
+    srand(7);
+    for (int i = 0; i < 20000; i++) {
+        frame_id_t fid = 100 + rand() % 32;
+        switch (rand() % 8) {
+        case 0:
+            lru_k_replacer_pin(&replacer, fid);
+            break;
+        case 1:
+            lru_k_replacer_remove(&replacer, fid);
+            break;
+        case 2: {
+            frame_id_t expected = first_evictable(&replacer);
+            ck_assert_uint_eq(lru_k_replacer_evict(&replacer), expected);
+            break;
+        }
+        case 3: {
+            size_t n = lru_k_replacer_frames_ahead(&replacer, ahead, 32);
+            ck_assert_uint_eq(n, lru_k_replacer_size(&replacer));
+            for (size_t j = 1; j < n; j++)
+                ck_assert(goes_before(&replacer, ahead[j - 1] - 100, ahead[j] - 100));
+            if (n > 0)
+                ck_assert_uint_eq(ahead[0], first_evictable(&replacer));
+            break;
+        }
+        default:
+            reference(&replacer, fid);
+        }
+    }
+
+    lru_k_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+Suite *lru_k_replacer_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("LruKReplacer");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, backward_k_distance);
+    tcase_add_test(tc_core, correlated_references);
+    tcase_add_test(tc_core, pin_remove);
+    tcase_add_test(tc_core, random_references);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = lru_k_replacer_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
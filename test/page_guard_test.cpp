@@ -0,0 +1,105 @@
+#include "../include/disk/bpm.h"
+#include "../include/disk/heapfile.h"
+#include "../include/disk/page_guard.hpp"
+#include <cerrno>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace somedb {
+
+class PageGuardTestFixture : public testing::Test {
+  protected:
+    std::string table_name = "page_guard_test";
+    DiskManager *disk_mgr;
+    BufferPoolManager *bpm;
+
+    void SetUp() override {
+        char cname[4] = "col";
+        Column cols[1] = {{.name_len = 3, .name = cname, .type = STRING}};
+        disk_mgr = create_table(table_name.data(), cols, 1);
+        bpm = new_bpm(4, disk_mgr);
+    }
+
+    void TearDown() override {
+        close_table_file(disk_mgr);
+        remove_table(table_name.data());
+    }
+
+    BpmPage *Frame(page_id_t pid) { return bpm->pool->pages + find_frame(pid, bpm); }
+};
+
+TEST_F(PageGuardTestFixture, ReadGuardsShareThePage) {
+    {
+        ReadPageGuard first = fetchRead(bpm, 2);
+        ReadPageGuard second = fetchRead(bpm, 2);
+        ASSERT_TRUE(first && second);
+        EXPECT_EQ(first.data(), second.data());
+        EXPECT_EQ(Frame(2)->pin_count, 2);
+
+        // Writers wait for the readers
+        EXPECT_EQ(pthread_rwlock_trywrlock(&Frame(2)->latch), EBUSY);
+    }
+    EXPECT_EQ(Frame(2)->pin_count, 0);
+    EXPECT_FALSE(Frame(2)->is_dirty);
+}
+
+TEST_F(PageGuardTestFixture, WriteGuardMarksDirty) {
+    {
+        WritePageGuard guard = fetchWrite(bpm, 2);
+        ASSERT_TRUE(guard);
+        guard.data()[PAGE_SIZE - 1] = 0x42;
+        EXPECT_EQ(pthread_rwlock_tryrdlock(&Frame(2)->latch), EBUSY);
+    }
+    EXPECT_EQ(Frame(2)->pin_count, 0);
+    EXPECT_TRUE(Frame(2)->is_dirty);
+
+    // Reading the page afterwards leaves it dirty
+    fetchRead(bpm, 2).release();
+    EXPECT_TRUE(Frame(2)->is_dirty);
+    EXPECT_EQ(fetchRead(bpm, 2).data()[PAGE_SIZE - 1], 0x42);
+}
+
+TEST_F(PageGuardTestFixture, MovingReleasesThePreviousPage) {
+    ReadPageGuard guard = fetchRead(bpm, 2);
+    ReadPageGuard moved = std::move(guard);
+    EXPECT_FALSE(guard);
+    EXPECT_EQ(moved.pid(), 2);
+    EXPECT_EQ(Frame(2)->pin_count, 1);
+
+    moved = fetchRead(bpm, 3);
+    EXPECT_EQ(Frame(2)->pin_count, 0);
+    EXPECT_EQ(Frame(3)->pin_count, 1);
+
+    moved.release();
+    moved.release(); // no-op
+    EXPECT_EQ(Frame(3)->pin_count, 0);
+}
+
+TEST_F(PageGuardTestFixture, NewPageIsLatchedForWriting) {
+    page_id_t pid;
+    {
+        WritePageGuard guard = newPage(bpm, HEAP_PAGE);
+        ASSERT_TRUE(guard);
+        pid = guard.pid();
+        EXPECT_EQ(Frame(pid)->pin_count, 1);
+    }
+    EXPECT_EQ(Frame(pid)->pin_count, 0);
+    EXPECT_TRUE(Frame(pid)->is_dirty);
+}
+
+// Released pages can be evicted, so a pool smaller than the pages used keeps working
+TEST_F(PageGuardTestFixture, GuardsLetThePoolEvict) {
+    for (page_id_t pid = 2; pid < 12; pid++) {
+        WritePageGuard guard = fetchWrite(bpm, pid);
+        ASSERT_TRUE(guard);
+        guard.data()[PAGE_SIZE - 1] = pid;
+    }
+    for (page_id_t pid = 2; pid < 12; pid++) {
+        ReadPageGuard guard = fetchRead(bpm, pid);
+        ASSERT_TRUE(guard);
+        EXPECT_EQ(guard.data()[PAGE_SIZE - 1], pid);
+    }
+}
+
+} // namespace somedb
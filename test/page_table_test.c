@@ -0,0 +1,106 @@
+#include "../include/disk/page_table.h"
+#include <check.h>
+#include <stdlib.h>
+
+#define MAX_PAGES 100
+
+START_TEST(insert_find_remove) {
+    PageTable table;
+    ck_assert(page_table_init(&table, MAX_PAGES));
+    ck_assert_uint_eq(page_table_find(&table, 0), NO_FRAME);
+
+    for (page_id_t pid = 0; pid < MAX_PAGES; pid++)
+        ck_assert(page_table_insert(&table, pid * 7, pid));
+    ck_assert_uint_eq(table.size, MAX_PAGES);
+    ck_assert(!page_table_insert(&table, UINT32_MAX - 1, 0)); // full
+    ck_assert(page_table_insert(&table, 7, 42));              // but existing pages can be remapped
+    ck_assert_uint_eq(page_table_find(&table, 7), 42);
+
+    for (page_id_t pid = 0; pid < MAX_PAGES; pid += 2)
+        ck_assert(page_table_remove(&table, pid * 7));
+    ck_assert(!page_table_remove(&table, 0));
+    ck_assert_uint_eq(table.size, MAX_PAGES / 2);
+    for (page_id_t pid = 2; pid < MAX_PAGES; pid++)
+        ck_assert_uint_eq(page_table_find(&table, pid * 7), pid % 2 == 0 ? NO_FRAME : pid);
+
+    page_table_destroy(&table);
+}
+
+END_TEST
+
+// Pages of different files with the same page id are different pages
+START_TEST(file_keys) {
+    PageTable table;
+    ck_assert(page_table_init(&table, MAX_PAGES));
+    for (u32 file_id = 0; file_id < 4; file_id++)
+        ck_assert(page_table_insert(&table, PAGE_KEY(file_id, 7), file_id));
+    ck_assert_uint_eq(table.size, 4);
+    ck_assert_uint_eq(page_table_find(&table, 7), 0);
+    ck_assert_uint_eq(page_table_find(&table, PAGE_KEY(3, 7)), 3);
+    ck_assert(page_table_remove(&table, PAGE_KEY(2, 7)));
+    ck_assert_uint_eq(page_table_find(&table, PAGE_KEY(2, 7)), NO_FRAME);
+    ck_assert_uint_eq(page_table_find(&table, PAGE_KEY(1, 7)), 1);
+    page_table_destroy(&table);
+}
+
+END_TEST
+
+// Random inserts and removes with the table up to full, which builds long probe clusters, checked against an array
+START_TEST(matches_reference) {
+    PageTable table;
+    ck_assert(page_table_init(&table, MAX_PAGES));
+    frame_id_t reference[4 * MAX_PAGES];
+    for (u32 i = 0; i < 4 * MAX_PAGES; i++)
+        reference[i] = NO_FRAME;
+
+    srand(7);
+    for (u32 op = 0; op < 100000; op++) {
+        page_id_t pid = rand() % (4 * MAX_PAGES);
+        page_id_t key = pid * 4096;
+        if (reference[pid] == NO_FRAME && table.size < MAX_PAGES) {
+            ck_assert(page_table_insert(&table, key, op));
+            reference[pid] = op;
+        } else if (reference[pid] != NO_FRAME) {
+            ck_assert(page_table_remove(&table, key));
+            reference[pid] = NO_FRAME;
+        }
+        if (op % 1000 == 0)
+            for (u32 i = 0; i < 4 * MAX_PAGES; i++)
+                ck_assert_uint_eq(page_table_find(&table, i * 4096), reference[i]);
+    }
+
+    page_table_destroy(&table);
+}
+
+END_TEST
+
+Suite *page_table_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("PageTable");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, insert_find_remove);
+    tcase_add_test(tc_core, file_keys);
+    tcase_add_test(tc_core, matches_reference);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = page_table_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
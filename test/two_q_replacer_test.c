@@ -0,0 +1,110 @@
+#include "../include/disk/two_q_replacer.h"
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define FRAMES 8 // A1in holds 2 of them, A1out remembers 4 pages
+
+// Brings page PID into frame FID and gives it back
+static void bring_in(TwoQReplacer *replacer, frame_id_t fid, page_id_t pid) {
+    two_q_replacer_pin(replacer, fid, pid);
+    two_q_replacer_unpin(replacer, fid);
+}
+
+START_TEST(reference_after_eviction) {
+    TwoQReplacer replacer;
+    ck_assert(two_q_replacer_init(&replacer, 0, FRAMES));
+    ck_assert_uint_eq(two_q_replacer_evict(&replacer), UINT32_MAX);
+
+    for (frame_id_t fid = 0; fid < FRAMES; fid++)
+        bring_in(&replacer, fid, 100 + fid);
+    ck_assert_uint_eq(replacer.a1in_size, FRAMES);
+
+    // First in, first out of A1in, and onto Am once referenced again
+    ck_assert_uint_eq(two_q_replacer_evict(&replacer), 0);
+    bring_in(&replacer, 0, 100);
+    ck_assert(replacer.flags[0] & TWO_Q_AM);
+
+    // A scan of new pages passes through A1in and leaves the page on Am alone
+    for (page_id_t pid = 200; pid < 240; pid++) {
+        frame_id_t fid = two_q_replacer_evict(&replacer);
+        ck_assert_uint_ne(fid, 0);
+        bring_in(&replacer, fid, pid);
+    }
+    ck_assert(replacer.flags[0] & TWO_Q_AM);
+
+    two_q_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+START_TEST(ghosts_are_forgotten) {
+    TwoQReplacer replacer;
+    ck_assert(two_q_replacer_init(&replacer, 0, FRAMES));
+    for (frame_id_t fid = 0; fid < FRAMES; fid++)
+        bring_in(&replacer, fid, 100 + fid);
+
+    // A1out remembers the 4 pages evicted last, so page 100 is new again
+    for (int i = 0; i < 5; i++)
+        ck_assert_uint_eq(two_q_replacer_evict(&replacer), i);
+    two_q_replacer_pin(&replacer, 0, 100);
+    ck_assert(replacer.flags[0] & TWO_Q_A1IN);
+    two_q_replacer_pin(&replacer, 1, 101);
+    ck_assert(replacer.flags[1] & TWO_Q_AM);
+
+    two_q_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+START_TEST(pin_remove) {
+    TwoQReplacer replacer;
+    ck_assert(two_q_replacer_init(&replacer, 100, FRAMES));
+    for (frame_id_t fid = 100; fid < 100 + FRAMES; fid++)
+        bring_in(&replacer, fid, fid);
+
+    two_q_replacer_pin(&replacer, 100, 100);
+    two_q_replacer_remove(&replacer, 101);
+    ck_assert_uint_eq(two_q_replacer_size(&replacer), FRAMES - 2);
+
+    frame_id_t ahead[FRAMES];
+    ck_assert_uint_eq(two_q_replacer_frames_ahead(&replacer, ahead, FRAMES), FRAMES - 2);
+    ck_assert_uint_eq(ahead[0], 102);
+    ck_assert_uint_eq(two_q_replacer_evict(&replacer), 102);
+    ck_assert_uint_eq(replacer.ghost_count, 1); // removed pages are not remembered
+
+    two_q_replacer_destroy(&replacer);
+}
+
+END_TEST
+
+Suite *two_q_replacer_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("TwoQReplacer");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, reference_after_eviction);
+    tcase_add_test(tc_core, ghosts_are_forgotten);
+    tcase_add_test(tc_core, pin_remove);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = two_q_replacer_suite();
+    sr = srunner_create(s);
+
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}